@@ -2,8 +2,15 @@
 
 //others are not included
 
+//GPU engines are only available when compiled by nvcc
+#ifdef __CUDACC__
 #include "snig/snig.hpp"
 #include "gpipe/gpipe.hpp"
 #include "bf/bf.hpp"
+#endif
 
+#include "cpu_snig/cpu_snig.hpp"
+#include "tiled_snig/tiled_snig.hpp"
+#include "sparse_snig/sparse_snig.hpp"
+#include "cpu_gpipe/cpu_gpipe.hpp"
 
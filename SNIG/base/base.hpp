@@ -1,10 +1,42 @@
 #pragma once
 
 #include <SNIG/utility/utility.hpp>
+#include <SNIG/utility/reader.hpp>
+#include <SNIG/utility/mapped_file.hpp>
+#include <SNIG/utility/layer_window.hpp>
+#include <experimental/filesystem>
 #include <chrono>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include <memory>
+
+namespace std {
+  namespace fs = experimental::filesystem;
+}
 
 namespace snig {
 
+//Base<T> does not touch any GPU API
+//weight loading, logging, and timing are shared by GPU and CPU engines
+
+//how an engine wants its weights to be packed
+struct WeightOptions {
+  //ELL weights wider than max_ell_width are expanded to CSR (prepacked models are rejected)
+  size_t max_ell_width{0};
+  //do not pack values of uniform layers
+  bool skip_uniform_values{false};
+  //use a prepacked model in place through mmap instead of copying it
+  bool map_in_place{false};
+  //take the section size recorded in a prepacked model instead of the requested one
+  bool any_sec_size{false};
+  //check layer checksums of a prepacked model if it carries them
+  bool verify_checksums{true};
+  //keep at most max_resident_layers layers in memory and stream the others from disk,
+  //0 (or at least num_layers) keeps the whole model resident
+  size_t max_resident_layers{0};
+};
+
 template <typename T>
 class Base {
 
@@ -24,27 +56,52 @@ class Base {
     size_t _sec_size;
 
     //weights
-    int* _host_pinned_weight;
-    size_t _max_nnz;
-    size_t _pad {0};
-    size_t _p_w_index_len;
-    size_t _pp_w_index_len;
-    size_t _pp_wlen;
-    size_t _pp_wsize;
-
-    //kernel configuration
-    dim3 _threads{32, 32, 1};
-
+    //layer i is packed at _host_weight + _layers[i].offset with its own length,
+    //_max_nnz and _pp_wlen (_pp_wsize in bytes) describe the largest layer
+    //if _layer_window is set, _host_weight is nullptr and layers are acquired from the window instead
+    int* _host_weight{nullptr};
+    std::unique_ptr<LayerWindow> _layer_window;
+    std::vector<PackedLayer> _layers;
+    size_t _host_wlen{0};
+    size_t _max_nnz{0};
+    size_t _pp_wlen{0};
+    size_t _pp_wsize{0};
+
+    //0 if weights are packed as CSR
+    //otherwise weights are packed as ELL with _ell_width slots per row
+    size_t _ell_width{0};
+
+    //only set if the engine skips values of uniform layers,
+    //values of such layers are not packed, all weights equal _uniform_values[layer]
+    std::vector<bool> _uniform_layers;
+    std::vector<T> _uniform_values;
+
+    //weight_path is either a directory of layer files or a prepacked model file
+    //sec_size must match the one used to convert the weight files,
+    //unless options.any_sec_size is set and the model records its own
     Base(
-      const dim3& threads,
       const std::fs::path& weight_path,
       const T bias,
       const size_t num_neurons,
-      const size_t num_layers
+      const size_t num_layers,
+      const size_t sec_size,
+      const WeightOptions& options = WeightOptions{}
     );
 
     virtual ~Base();
 
+    //re-pack the first num_layers layers as CSR with sec_size columns per section into weight,
+    //the returned layout is relative to weight
+    //uniform layers keep no values, as engines take their fast path anyway
+    std::vector<PackedLayer> _resection_layers(
+      const size_t sec_size,
+      const size_t num_layers,
+      std::unique_ptr<int[]>& weight
+    ) const;
+
+    //replace the loaded model with its layers re-packed with sec_size columns per section
+    void _resection_weight(const size_t sec_size);
+
   
     //  API: cout("my ", string, " is ", a, b, '\n');
     //       -> cout << "my" << string << " is " << a << b << '\n';
@@ -65,7 +122,18 @@ class Base {
     bool _enable_counter{false};
     bool _enable_toc{false};
 
-    void _load_weight(const std::fs::path& weight_path); 
+    //set if weights come from a prepacked model mapped in place
+    std::unique_ptr<MappedFile> _weight_map;
+
+    void _load_weight(
+      const std::fs::path& weight_path,
+      const WeightOptions& options
+    );
+
+    void _load_packed_weight(
+      const std::fs::path& model_path,
+      const WeightOptions& options
+    );
 
     template <typename L>
     void _cout(L&& last) const;
@@ -96,83 +164,372 @@ class Base {
 
 template <typename T>
 Base<T>::Base(
-  const dim3& threads,
   const std::fs::path& weight_path,
   const T bias,
   const size_t num_neurons,
-  const size_t num_layers
+  const size_t num_layers,
+  const size_t sec_size,
+  const WeightOptions& options
 ) : 
   _bias{bias},
   _num_neurons{num_neurons},
   _num_layers{num_layers},
-  _threads{threads}
+  _sec_size{sec_size}
 {
-  _sec_size = get_sec_size<T>(Base<T>::_num_neurons);
   _num_secs = (Base<T>::_num_neurons) / _sec_size;
-  _load_weight(weight_path);
+  _load_weight(weight_path, options);
 }
 
 template <typename T>
 Base<T>::~Base() {
-  checkCuda(cudaFreeHost(_host_pinned_weight));
+  //the loader of the window reads _layers
+  _layer_window.reset();
+  if(_weight_map == nullptr) {
+    delete[] _host_weight;
+  }
 }
 
 template <typename T>
-void Base<T>::_load_weight(const std::fs::path& weight_path) {
+void Base<T>::_load_weight(
+  const std::fs::path& weight_path,
+  const WeightOptions& options
+) {
+  if(std::fs::is_regular_file(weight_path)) {
+    _load_packed_weight(weight_path, options);
+    return;
+  }
+
   log("Loading the weight......");
 
   tic();
 
-  _max_nnz = find_max_nnz_binary(
-               weight_path,
-               _num_layers,
-               _num_neurons
-             );
+  auto headers = read_weight_headers(weight_path, _num_layers, _num_neurons);
 
-  // total length of row and col index
-  // value index should consider sizeof(T)
-  _p_w_index_len  = _num_neurons * _num_secs + _max_nnz + 1;
+  _uniform_layers.assign(_num_layers, false);
+  _uniform_values.assign(_num_layers, T(0));
+  if(options.skip_uniform_values) {
+    for(size_t i = 0; i < _num_layers; ++i) {
+      _uniform_layers[i] = headers[i].uniform;
+      _uniform_values[i] = T(headers[i].value);
+    }
+  }
 
-  //handle aligned
-  if((sizeof(int) * _p_w_index_len) % sizeof(T) != 0) {
-    ++_pad;
+  //files with other sections are re-sectioned at load time as CSR
+  _ell_width = find_ell_width_binary(
+                 weight_path,
+                 _num_layers,
+                 _num_neurons,
+                 _num_secs
+               );
+  if(_ell_width > options.max_ell_width) {
+    _ell_width = 0;
   }
 
-  _pp_w_index_len = _p_w_index_len + _pad;
-  
+  //every layer only takes the space its own nnz needs
+  _layers = packed_layers<T>(
+              headers,
+              _num_neurons,
+              _num_secs,
+              _ell_width,
+              options.skip_uniform_values
+            );
+
+  _max_nnz = 0;
+  _pp_wlen = 0;
+  for(size_t i = 0; i < _num_layers; ++i) {
+    _max_nnz = std::max(_max_nnz, headers[i].nnz);
+    _pp_wlen = std::max(_pp_wlen, _layers[i].length);
+  }
+  if(_ell_width != 0) {
+    _max_nnz = _num_neurons * _num_secs * _ell_width;
+  }
+  _pp_wsize = sizeof(int) * _pp_wlen;
+  _host_wlen = _layers.empty() ? 0 : _layers.back().offset + _layers.back().length;
+
+  if(options.max_resident_layers != 0 && options.max_resident_layers < _num_layers) {
+    const bool skip_uniform_values = options.skip_uniform_values;
+    _layer_window = std::make_unique<LayerWindow>(
+      _num_layers,
+      _pp_wlen,
+      options.max_resident_layers,
+      [this, weight_path, skip_uniform_values](const size_t layer, int* dst) {
+        std::memset(dst, 0, sizeof(int) * _layers[layer].length);
+        read_weight_layer_binary<T>(
+          weight_path,
+          _num_neurons,
+          layer,
+          _num_secs,
+          _layers[layer],
+          dst,
+          _ell_width,
+          skip_uniform_values
+        );
+      }
+    );
 
-  //pad packed weight length
-  //max_nnz should be even, otherwis it needs to be padded
-  _pp_wlen = _pp_w_index_len + (sizeof(T) / sizeof(int)) * _max_nnz;
+    toc();
+    log(
+      "Finish preparing DNN layers with ", duration(), " ms, streaming them through a window of ",
+      _layer_window->num_slots(), " layers", "\n"
+    );
+    return;
+  }
 
-  //pad packed weight size
-  _pp_wsize = sizeof(int) * (_pp_w_index_len) + sizeof(T) * _max_nnz;
-  
-  checkCuda(cudaMallocHost(
-    (void**)&_host_pinned_weight,
-    _pp_wsize * _num_layers
-  ));
+  _host_weight = new int[_host_wlen];
 
   std::memset(
-    _host_pinned_weight,
+    _host_weight,
     0,
-    _pp_wsize * _num_layers
+    sizeof(int) * _host_wlen
   );
 
   read_weight_binary<T>(
     weight_path,
     _num_neurons,
-    _max_nnz,
     _num_layers,
     _num_secs,
-    _pad,
-    _host_pinned_weight
+    _layers,
+    _host_weight,
+    _ell_width,
+    options.skip_uniform_values
   );
 
   toc();
   log("Finish reading DNN layers with ", duration(), " ms", "\n");
 }
 
+template <typename T>
+void Base<T>::_load_packed_weight(
+  const std::fs::path& model_path,
+  const WeightOptions& options
+) {
+  using namespace std::literals::string_literals;
+
+  log("Mapping the prepacked weight......");
+
+  tic();
+
+  //a streamed model only maps its header and layer table
+  const bool streamed = options.max_resident_layers != 0 && options.max_resident_layers < _num_layers;
+  auto map = std::make_unique<MappedFile>(model_path, !streamed);
+
+  ModelHeader header;
+  if(map->size() < sizeof(ModelHeader)) {
+    throw std::runtime_error("Invalid prepacked model "s + model_path.c_str());
+  }
+  std::memcpy(&header, map->data(), sizeof(ModelHeader));
+
+  if(header.magic != MODEL_MAGIC) {
+    throw std::runtime_error("Invalid prepacked model "s + model_path.c_str());
+  }
+  if(header.version != MODEL_VERSION) {
+    throw std::runtime_error(
+      "Prepacked model "s + model_path.c_str() + " has version " + std::to_string(header.version)
+      + ", repack it with to_binary"
+    );
+  }
+  if(header.num_neurons != _num_neurons || header.num_layers < _num_layers
+     || header.value_type != static_cast<int>(value_type_of<T>())) {
+    throw std::runtime_error("Prepacked model "s + model_path.c_str() + " does not match the engine");
+  }
+  if(header.sec_size * header.num_secs != _num_neurons) {
+    throw std::runtime_error("Invalid prepacked model "s + model_path.c_str());
+  }
+  if(header.sec_size != _sec_size) {
+    if(!options.any_sec_size) {
+      throw std::runtime_error(
+        "Prepacked model "s + model_path.c_str() + " is packed with section size "
+        + std::to_string(header.sec_size) + ", but " + std::to_string(_sec_size) + " is used"
+      );
+    }
+    _sec_size = header.sec_size;
+    _num_secs = header.num_secs;
+  }
+  if(header.ell_width > options.max_ell_width) {
+    throw std::runtime_error("Prepacked model "s + model_path.c_str() + " is ELL, repack it as CSR");
+  }
+
+  if(header.table_offset % MODEL_TABLE_ALIGNMENT != 0
+     || map->size() < header.table_offset + sizeof(LayerEntry) * header.num_layers) {
+    throw std::runtime_error("Invalid prepacked model "s + model_path.c_str());
+  }
+  const LayerEntry* table = reinterpret_cast<const LayerEntry*>(
+    map->data() + header.table_offset
+  );
+
+  //layers are fetched through the table,
+  //each entry must at least hold the index and values its nnz requires
+  _ell_width = header.ell_width;
+  std::vector<WeightHeader> headers(_num_layers);
+  for(size_t i = 0; i < _num_layers; ++i) {
+    headers[i].nnz = table[i].nnz;
+  }
+  auto required = packed_layers<T>(headers, _num_neurons, _num_secs, _ell_width, false);
+
+  _layers.resize(_num_layers);
+  _max_nnz = 0;
+  _pp_wlen = 0;
+  _host_wlen = 0;
+  for(size_t i = 0; i < _num_layers; ++i) {
+    if(table[i].offset % PACKED_LAYER_ALIGNMENT != 0
+       || table[i].length < sizeof(int) * required[i].length
+       || map->size() < header.data_offset + table[i].offset + table[i].length) {
+      throw std::runtime_error(
+        "Invalid layer entry in prepacked model "s + model_path.c_str() + " at layer " + std::to_string(i + 1)
+      );
+    }
+    _layers[i].offset = table[i].offset / sizeof(int);
+    _layers[i].length = table[i].length / sizeof(int);
+    _layers[i].index_len = required[i].index_len;
+    _max_nnz = std::max(_max_nnz, size_t(table[i].nnz));
+    _pp_wlen = std::max(_pp_wlen, _layers[i].length);
+    _host_wlen = std::max(_host_wlen, _layers[i].offset + _layers[i].length);
+  }
+  if(_ell_width != 0) {
+    _max_nnz = _num_neurons * _num_secs * _ell_width;
+  }
+  _pp_wsize = sizeof(int) * _pp_wlen;
+
+  const bool verify = (header.flags & MODEL_CHECKSUM) && options.verify_checksums;
+  if(verify && !streamed) {
+    for(size_t i = 0; i < _num_layers; ++i) {
+      if(layer_checksum(map->data() + header.data_offset + table[i].offset, table[i].length)
+         != table[i].checksum) {
+        throw std::runtime_error(
+          "Checksum mismatch in prepacked model "s + model_path.c_str()
+          + " at layer " + std::to_string(i + 1)
+        );
+      }
+    }
+  }
+
+  //values of uniform layers are packed anyway, skipping them only picks the fast path,
+  //which older models may flag for values it does not scale exactly
+  _uniform_layers.assign(_num_layers, false);
+  _uniform_values.assign(_num_layers, T(0));
+  if(options.skip_uniform_values) {
+    for(size_t i = 0; i < _num_layers; ++i) {
+      _uniform_layers[i] = table[i].uniform && is_exact_scaling(table[i].value);
+      _uniform_values[i] = T(table[i].value);
+    }
+  }
+
+  const int* packed = reinterpret_cast<const int*>(map->data() + header.data_offset);
+  if(streamed) {
+    //streamed layers are read and verified by the window, one at a time
+    const std::vector<LayerEntry> entries(table, table + _num_layers);
+    const size_t data_offset = header.data_offset;
+    auto in = std::make_shared<std::ifstream>(model_path, std::ios::in | std::ios::binary);
+    _layer_window = std::make_unique<LayerWindow>(
+      _num_layers,
+      _pp_wlen,
+      options.max_resident_layers,
+      [entries, data_offset, verify, in, model_path](const size_t layer, int* dst) {
+        in->seekg(data_offset + entries[layer].offset);
+        in->read((char*)dst, entries[layer].length);
+        if(!*in) {
+          throw std::runtime_error(
+            "Truncated prepacked model "s + model_path.c_str() + " at layer " + std::to_string(layer + 1)
+          );
+        }
+        if(verify && layer_checksum(dst, entries[layer].length) != entries[layer].checksum) {
+          throw std::runtime_error(
+            "Checksum mismatch in prepacked model "s + model_path.c_str()
+            + " at layer " + std::to_string(layer + 1)
+          );
+        }
+      }
+    );
+
+    toc();
+    log(
+      "Finish preparing DNN layers with ", duration(), " ms, streaming them through a window of ",
+      _layer_window->num_slots(), " layers", "\n"
+    );
+    return;
+  }
+  else if(options.map_in_place) {
+    //read-only mapping, engines never write weights
+    _host_weight = const_cast<int*>(packed);
+    _weight_map = std::move(map);
+  }
+  else {
+    _host_weight = new int[_host_wlen];
+    std::memcpy(_host_weight, packed, sizeof(int) * _host_wlen);
+  }
+
+  toc();
+  log("Finish mapping DNN layers with ", duration(), " ms", "\n");
+}
+
+template <typename T>
+std::vector<PackedLayer> Base<T>::_resection_layers(
+  const size_t sec_size,
+  const size_t num_layers,
+  std::unique_ptr<int[]>& weight
+) const {
+  using namespace std::literals::string_literals;
+
+  if(_host_weight == nullptr) {
+    throw std::runtime_error("Cannot re-section layers which are not resident"s);
+  }
+  if(sec_size == 0 || _num_neurons % sec_size != 0) {
+    throw std::runtime_error(
+      "Section size "s + std::to_string(sec_size) + " does not divide " + std::to_string(_num_neurons) + " neurons"
+    );
+  }
+  const size_t num_secs = _num_neurons / sec_size;
+
+  std::vector<WeightHeader> headers(num_layers);
+  for(size_t i = 0; i < num_layers; ++i) {
+    headers[i].nnz = packed_nnz(_host_weight + _layers[i].offset, _num_neurons, _num_secs, _ell_width);
+    headers[i].uniform = _uniform_layers[i];
+  }
+  auto layers = packed_layers<T>(headers, _num_neurons, num_secs, 0, true);
+
+  const size_t wlen = layers.empty() ? 0 : layers.back().offset + layers.back().length;
+  weight = std::make_unique<int[]>(wlen);
+  for(size_t i = 0; i < num_layers; ++i) {
+    resection_layer<T>(
+      _host_weight + _layers[i].offset,
+      _layers[i],
+      _num_neurons,
+      _num_secs,
+      _ell_width,
+      weight.get() + layers[i].offset,
+      layers[i],
+      num_secs,
+      !_uniform_layers[i]
+    );
+  }
+  return layers;
+}
+
+template <typename T>
+void Base<T>::_resection_weight(const size_t sec_size) {
+  std::unique_ptr<int[]> weight;
+  auto layers = _resection_layers(sec_size, _num_layers, weight);
+
+  if(_weight_map == nullptr) {
+    delete[] _host_weight;
+  }
+  _weight_map.reset();
+  _host_weight = weight.release();
+
+  _sec_size = sec_size;
+  _num_secs = _num_neurons / sec_size;
+  _ell_width = 0;
+  _layers = std::move(layers);
+  _max_nnz = 0;
+  _pp_wlen = 0;
+  for(size_t i = 0; i < _num_layers; ++i) {
+    _max_nnz = std::max(_max_nnz, packed_nnz(_host_weight + _layers[i].offset, _num_neurons, _num_secs, 0));
+    _pp_wlen = std::max(_pp_wlen, _layers[i].length);
+  }
+  _pp_wsize = sizeof(int) * _pp_wlen;
+  _host_wlen = _layers.empty() ? 0 : _layers.back().offset + _layers.back().length;
+}
+
 template <typename T>
 template <typename... ArgsT>
 void Base<T>::log(ArgsT&&... args) const {
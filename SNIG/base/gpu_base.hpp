@@ -0,0 +1,57 @@
+#pragma once
+
+#include <SNIG/base/base.hpp>
+#include <SNIG/utility/cuda_error.hpp>
+#include <SNIG/utility/cuda_utility.hpp>
+
+namespace snig {
+
+template <typename T>
+class GPUBase : public Base<T> {
+
+  protected:
+
+    //kernel configuration
+    dim3 _threads{32, 32, 1};
+
+    GPUBase(
+      const dim3& threads,
+      const std::fs::path& weight_path,
+      const T bias,
+      const size_t num_neurons,
+      const size_t num_layers
+    );
+
+    virtual ~GPUBase();
+
+};
+
+// ----------------------------------------------------------------------------
+// Definition of GPUBase
+// ----------------------------------------------------------------------------
+
+template <typename T>
+GPUBase<T>::GPUBase(
+  const dim3& threads,
+  const std::fs::path& weight_path,
+  const T bias,
+  const size_t num_neurons,
+  const size_t num_layers
+) :
+  Base<T>(weight_path, bias, num_neurons, num_layers, get_device_sec_size<T>(num_neurons)),
+  _threads{threads}
+{
+  //pin the packed weight for asynchronous copies to GPUs
+  checkCuda(cudaHostRegister(
+    Base<T>::_host_weight,
+    sizeof(int) * Base<T>::_host_wlen,
+    cudaHostRegisterPortable
+  ));
+}
+
+template <typename T>
+GPUBase<T>::~GPUBase() {
+  checkCuda(cudaHostUnregister(Base<T>::_host_weight));
+}
+
+}  // end of namespace snig
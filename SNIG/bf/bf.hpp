@@ -6,7 +6,7 @@
 #include <SNIG/utility/scoring.hpp>
 #include <SNIG/bf/kernel.hpp>
 #include <SNIG/utility/utility.hpp>
-#include <SNIG/base/base.hpp>
+#include <SNIG/base/gpu_base.hpp>
 #include <omp.h>
 
 namespace std {
@@ -16,7 +16,7 @@ namespace std {
 namespace snig{
 
 template <typename T>  
-class BF : public Base<T> {
+class BF : public GPUBase<T> {
   //Since we don't have NVlink,
   //this implementation doesn't do load balancing at each iteration.
   //It actually let GPUs work in their own partitioned input data
@@ -97,7 +97,7 @@ BF<T>::BF(
   const size_t num_neurons,
   const size_t num_layers
 ):
-  Base<T>(threads, weight_path, bias, num_neurons, num_layers)
+  GPUBase<T>(threads, weight_path, bias, num_neurons, num_layers)
 {
   Base<T>::log("Constructing BF method......", "\n");
 }
@@ -208,8 +208,8 @@ void BF<T>::_infer() {
       if(cur_layer != Base<T>::_num_layers - 1) {
         checkCuda(cudaMemcpyAsync(
           _dev_W[dev][(cur_layer + 1) % 2],
-          Base<T>::_host_pinned_weight + (cur_layer + 1) * (Base<T>::_pp_wlen),
-          Base<T>::_pp_wsize,
+          Base<T>::_host_weight + Base<T>::_layers[cur_layer + 1].offset,
+          sizeof(int) * Base<T>::_layers[cur_layer + 1].length,
           cudaMemcpyHostToDevice,
           dev_stream[dev][0]
         ));
@@ -217,9 +217,28 @@ void BF<T>::_infer() {
 
       int* roffw = _dev_W[dev][cur_layer % 2];
       int* colsw = _dev_W[dev][cur_layer % 2] + Base<T>::_num_neurons * Base<T>::_num_secs + 1;
-      T* valsw = (T*)(_dev_W[dev][cur_layer % 2] + Base<T>::_p_w_index_len);
+      T* valsw = (T*)(_dev_W[dev][cur_layer % 2] + Base<T>::_layers[cur_layer].index_len);
+
+      //the last layer writes categories straight into the results, which start at 0
+      if(cur_layer + 1 == Base<T>::_num_layers) {
+        bf_identify_inference<T><<<_dev_nerowsY[dev], GPUBase<T>::_threads, sizeof(T) * Base<T>::_sec_size, dev_stream[dev][1]>>>(
+          _dev_Y[dev][cur_layer % 2],
+          _dev_nerowsY[dev],
+          _dev_rowsY[dev][cur_layer % 2],
+          Base<T>::_sec_size,
+          Base<T>::_num_secs,
+          Base<T>::_num_neurons,
+          roffw,
+          colsw,
+          valsw,
+          Base<T>::_bias,
+          dev_results[dev]
+        );
+        checkCuda(cudaStreamSynchronize(dev_stream[dev][1]));
+        break;
+      }
 
-      bf_inference<T><<<_dev_nerowsY[dev], Base<T>::_threads, sizeof(T) * Base<T>::_sec_size, dev_stream[dev][1]>>>(
+      bf_inference<T><<<_dev_nerowsY[dev], GPUBase<T>::_threads, sizeof(T) * Base<T>::_sec_size, dev_stream[dev][1]>>>(
         _dev_Y[dev][cur_layer % 2],
         _dev_nerowsY[dev],
         _dev_rowsY[dev][cur_layer % 2],
@@ -250,7 +269,6 @@ void BF<T>::_infer() {
       //simulate BF load balancing
       #pragma omp barrier
     }
-    identify<T><<<16, 512>>>(_dev_Y[dev][0], _dev_num_inputs[dev], Base<T>::_num_neurons, dev_results[dev]);
     checkCuda(cudaDeviceSynchronize());
     checkCuda(cudaStreamDestroy(dev_stream[dev][0]));
     checkCuda(cudaStreamDestroy(dev_stream[dev][1]));
@@ -286,8 +304,8 @@ void BF<T>::_weight_alloc() {
     ));
     checkCuda(cudaMemcpy(
       W[0],
-      Base<T>::_host_pinned_weight,
-      Base<T>::_pp_wsize,
+      Base<T>::_host_weight + Base<T>::_layers[0].offset,
+      sizeof(int) * Base<T>::_layers[0].length,
       cudaMemcpyHostToDevice
     ));
     _dev_W.emplace_back(W);
@@ -20,6 +20,25 @@ void bf_inference(
   int* rlenY1
 );
 
+//last layer of bf_inference fused with identify
+//outputs are not written, result_arr[rid] is set to 1 once one slab of the row has a positive output,
+//thus result_arr must be 0 before the launch, rows not listed in rowsY0 are all zero and keep 0
+template <typename T>
+__global__ 
+void bf_identify_inference(
+  const T* Y0,
+  const size_t nerowsY,
+  const int* rowsY0,
+  const size_t COL_BLK,
+  const size_t N_SLAB,
+  const size_t num_neurons_per_layer,
+  const int* roffW,
+  const int* colsW,
+  const T* valsW,
+  const T bias,
+  int* result_arr
+);
+
 //-----------------------------------------------------------------------------
 //Definition of task function
 //-----------------------------------------------------------------------------
@@ -90,4 +109,65 @@ void bf_inference(
   }
 }
 
+template <typename T>
+__global__ 
+void bf_identify_inference(
+  const T* Y0,
+  const size_t nerowsY,
+  const int* rowsY0,
+  const size_t COL_BLK,
+  const size_t N_SLAB,
+  const size_t num_neurons_per_layer,
+  const int* roffW,
+  const int* colsW,
+  const T* valsW,
+  const T bias,
+  int* result_arr
+) {
+
+  if(blockIdx.x >= nerowsY) {
+    return;
+  }
+
+  extern  __shared__ T shRow[];
+
+  int tid = threadIdx.y * blockDim.x + threadIdx.x;
+  int rid = rowsY0[blockIdx.x];
+
+  for(size_t i = 0; i < N_SLAB; i++) {
+    __syncthreads();
+    for(size_t j = threadIdx.x; j < COL_BLK; j++) {
+      shRow[j] = 0;  
+    }
+    __syncthreads();
+    for(size_t j = threadIdx.y; j < num_neurons_per_layer; j += blockDim.y) {
+      T valY = Y0[rid * num_neurons_per_layer + j];
+      if(valY == 0) {
+        continue;
+      }
+      int begOffW = roffW[i * num_neurons_per_layer + j] + threadIdx.x;
+      int endOffW = roffW[i * num_neurons_per_layer + j + 1];
+      for(int k = begOffW; k < endOffW; k += blockDim.x) {
+        int colW = colsW[k];
+        T valW = valsW[k];
+        atomicAdd(&shRow[colW - i * COL_BLK], valY * valW);
+      }
+    }
+    __syncthreads();
+    //an output survives ReLU/clip exactly when it is positive,
+    //every thread gets the same count, thus the whole block leaves together
+    int count = 0;
+    for(size_t j = 0; j < COL_BLK; j += blockDim.x * blockDim.y) {
+      T v = j + tid < COL_BLK ? shRow[j + tid] + bias : -1;
+      count += __syncthreads_count(v > 0);
+    }
+    if(count > 0) {
+      if(tid == 0) {
+        result_arr[rid] = 1;
+      }
+      return;
+    }
+  }
+}
+
 }// end of namespace snig ----------------------------------------------
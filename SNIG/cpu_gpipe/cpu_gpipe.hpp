@@ -0,0 +1,697 @@
+#pragma once
+
+#include <Eigen/Core>
+#include <SNIG/utility/reader.hpp>
+#include <SNIG/utility/input_stream.hpp>
+#include <SNIG/utility/spsc_queue.hpp>
+#include <SNIG/utility/numa.hpp>
+#include <SNIG/utility/matrix_format.h>
+#include <SNIG/cpu_snig/kernel.hpp>
+#include <SNIG/base/base.hpp>
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <mutex>
+
+namespace std {
+  namespace fs = experimental::filesystem;
+}
+
+namespace snig{
+
+//stage boundaries come from the time of every layer on the first PROFILE_SAMPLE_ROWS inputs
+constexpr size_t PROFILE_SAMPLE_ROWS = 256;
+
+//batches in flight in a lane beyond one per stage
+constexpr size_t PIPELINE_SLACK = 2;
+
+template <typename T>
+class CPUGPipe : public Base<T> {
+
+  //Same layer pipeline as GPipe, but all stages stay on host.
+  //A stage is a group of cores running a contiguous range of layers,
+  //its threads are bound to the group, thus the weights of its layers stay in the caches of the group.
+  //Later layers see fewer live neurons and cost less, so ranges are sized from the time
+  //of every layer on a sample of the inputs instead of holding as many layers each.
+  //Core i of every group forms lane i: a batch read by lane i goes through the stages of lane i,
+  //handed over by lock-free single-producer single-consumer rings,
+  //and its buffers go back to the first stage once the last stage identified it.
+
+  static_assert(
+    std::is_same<T, float>::value || std::is_same<T, double>::value,
+    "data type must be either float or double"
+  );
+
+  private:
+
+    //a batch in flight, computed in place on its ring buffer (Y[0]) and a buffer of its own (Y[1])
+    struct Packet {
+      typename InputStream<T>::Batch batch;
+      T* Y[2]{nullptr, nullptr};
+      bool* is_nonzero_row[2]{nullptr, nullptr};
+      //buffer holding the output of the last layer run
+      size_t cur{0};
+    };
+
+    size_t _batch_size;
+    size_t _num_threads;
+    size_t _num_stages;
+    size_t _num_lanes;
+
+    //stage s runs layers [_stage_layers[s], _stage_layers[s + 1])
+    std::vector<size_t> _stage_layers;
+
+    //milliseconds of every layer on the profiling sample
+    std::vector<double> _layer_ms;
+
+    //cpus the threads of stage s are bound to
+    std::vector<std::vector<int> > _stage_cpus;
+
+    //inputs are streamed through a ring of one slot per packet
+    std::unique_ptr<InputStream<T> > _input_stream;
+    std::vector<T*> _ring_Y;
+    std::vector<bool*> _ring_is_nonzero_row;
+
+    //packets of every lane
+    std::vector<std::vector<Packet> > _lane_packets;
+
+    //queue lane * _num_stages + s feeds stage s of lane,
+    //stage 0 takes back the packets the last stage is done with, nullptr ends the stream
+    std::vector<std::unique_ptr<SPSCQueue<Packet*> > > _queues;
+
+    //unit weights scattered for uniform layers
+    std::vector<T> _ones;
+
+    size_t _batch_ylen;
+    int* _results{nullptr};
+
+    void _set_parameters(
+      const size_t num_inputs,
+      const size_t batch_size,
+      const size_t num_threads,
+      const size_t num_stages
+    );
+
+    void _preprocess(const std::fs::path& input_path);
+
+    //time every layer on the first inputs of input_path
+    void _profile_layers(const std::fs::path& input_path);
+
+    //cut the layers into _num_stages contiguous ranges with the smallest largest time
+    void _partition_layers();
+
+    //give stage s the s-th block of _num_lanes cpus, cpus taken node by node
+    void _assign_cpus();
+
+    void _infer();
+
+    //stage of lane, until the end of the stream reaches it or another stage failed and set abort
+    void _run_stage(
+      const size_t lane,
+      const size_t stage,
+      const std::atomic<bool>& abort,
+      const CSRKernels<T>& csr,
+      const fixed_scatter_t<T> ell_scatter
+    );
+
+    //push num_rows rows of Y[cur] through layer cur_layer packed at weight into Y[1 - cur]
+    void _infer_layer(
+      T* const Y[2],
+      bool* const is_nonzero_row[2],
+      const size_t cur,
+      const size_t num_rows,
+      const size_t cur_layer,
+      const int* weight,
+      T* scratch,
+      const CSRKernels<T>& csr,
+      const fixed_scatter_t<T> ell_scatter
+    );
+
+    //push num_rows rows of Y through the last layer and identify them into results
+    void _identify_layer(
+      const T* Y,
+      const bool* is_nonzero_row,
+      const size_t num_rows,
+      int* results,
+      T* scratch,
+      const CSRKernels<T>& csr,
+      const fixed_scatter_t<T> ell_scatter
+    );
+
+    void _weight_alloc();
+
+    void _input_alloc();
+
+    void _result_alloc();
+
+  public:
+
+    CPUGPipe(
+      const std::fs::path& weight_path,
+      const T bias = -.3f,
+      const size_t num_neurons_per_layer = 1024,
+      const size_t num_layers = 120
+    );
+
+    ~CPUGPipe();
+
+    //num_threads / num_stages lanes of num_stages threads each, 0 stages gives every thread a stage
+    Eigen::Matrix<int, Eigen::Dynamic, 1> infer(
+      const std::fs::path& input_path,
+      const size_t num_inputs,
+      const size_t batch_size,
+      const size_t num_threads,
+      const size_t num_stages = 0
+    );
+
+};
+
+// ----------------------------------------------------------------------------
+// Definition of CPUGPipe
+// ----------------------------------------------------------------------------
+
+template <typename T>
+CPUGPipe<T>::CPUGPipe(
+  const std::fs::path& weight_path,
+  const T bias,
+  const size_t num_neurons_per_layer,
+  const size_t num_layers
+):
+  Base<T>(
+    weight_path,
+    bias,
+    num_neurons_per_layer,
+    num_layers,
+    get_sec_size<T>(num_neurons_per_layer),
+    WeightOptions{MAX_ELL_WIDTH, true, true, true}
+  )
+{
+  Base<T>::log("Constructing CPUGPipe engine......", "\n");
+}
+
+template <typename T>
+CPUGPipe<T>::~CPUGPipe() {
+  //stop the I/O thread before freeing its buffers
+  _input_stream.reset();
+
+  for(auto& Y_in_ring : _ring_Y) {
+    delete[] Y_in_ring;
+  }
+  for(auto& rowsY_in_ring : _ring_is_nonzero_row) {
+    delete[] rowsY_in_ring;
+  }
+  for(auto& packets_in_lane : _lane_packets) {
+    for(auto& packet : packets_in_lane) {
+      delete[] packet.Y[1];
+      delete[] packet.is_nonzero_row[1];
+    }
+  }
+
+  delete[] _results;
+}
+
+template <typename T>
+Eigen::Matrix<int, Eigen::Dynamic, 1> CPUGPipe<T>::infer(
+  const std::fs::path& input_path,
+  const size_t num_inputs,
+  const size_t batch_size,
+  const size_t num_threads,
+  const size_t num_stages
+) {
+
+  _set_parameters(
+    num_inputs,
+    batch_size,
+    num_threads,
+    num_stages
+  );
+
+  Base<T>::log("Using ", _num_lanes * _num_stages, " CPU threads", "\n");
+  Base<T>::log("Total input size : ", num_inputs, "\n");
+  Base<T>::log("Input batch size : ", batch_size, "\n");
+  Base<T>::log("Pipeline : ", _num_lanes, " lanes of ", _num_stages, " stages", "\n\n");
+
+  _preprocess(input_path);
+
+  _infer();
+
+  return arr_to_Eigen_int(_results, Base<T>::_num_inputs);
+}
+
+template <typename T>
+void CPUGPipe<T>::_set_parameters(
+  const size_t num_inputs,
+  const size_t batch_size,
+  const size_t num_threads,
+  const size_t num_stages
+) {
+  using namespace std::literals::string_literals;
+
+  _num_stages = num_stages == 0 ? num_threads : num_stages;
+  if(_num_stages == 0 || num_threads < _num_stages) {
+    throw std::runtime_error("CPUGPipe needs at least one thread per stage"s);
+  }
+  if(_num_stages > Base<T>::_num_layers) {
+    throw std::runtime_error("CPUGPipe needs at least one layer per stage"s);
+  }
+  if(batch_size == 0) {
+    throw std::runtime_error("Input batch size must be positive"s);
+  }
+
+  Base<T>::_num_inputs = num_inputs;
+  _num_threads = num_threads;
+  _num_lanes = num_threads / _num_stages;
+  _batch_size = batch_size;
+  _batch_ylen = _batch_size * Base<T>::_num_neurons;
+}
+
+template <typename T>
+void CPUGPipe<T>::_preprocess(const std::fs::path& input_path) {
+  //stage boundaries are needed before the buffers, they are timed on their own
+  _profile_layers(input_path);
+  _partition_layers();
+  _assign_cpus();
+
+  Base<T>::log("Preprocessing...... ");
+  Base<T>::tic();
+
+  //weight allocation
+  _weight_alloc();
+  //input allocation
+  _input_alloc();
+  //final results allocation
+  _result_alloc();
+
+  //start reading input, batches are consumed by the first stages while later ones are read
+  _input_stream = std::make_unique<InputStream<T> >(
+    input_path,
+    Base<T>::_num_inputs,
+    Base<T>::_num_neurons,
+    Base<T>::_sec_size,
+    _batch_size,
+    _ring_Y,
+    _ring_is_nonzero_row
+  );
+
+  Base<T>::toc();
+  Base<T>::log("Finish preprocessing with ", Base<T>::duration(), " ms", "\n");
+}
+
+template <typename T>
+void CPUGPipe<T>::_profile_layers(const std::fs::path& input_path) {
+  const size_t N = Base<T>::_num_neurons;
+  const size_t num_secs = Base<T>::_num_secs;
+  const size_t num_rows = std::max(std::min(PROFILE_SAMPLE_ROWS, Base<T>::_num_inputs), size_t(1));
+
+  std::vector<T> sample[2] = {std::vector<T>(num_rows * N), std::vector<T>(num_rows * N, T(0))};
+  std::unique_ptr<bool[]> is_nonzero_row[2] = {
+    std::make_unique<bool[]>(num_rows * num_secs),
+    std::make_unique<bool[]>(num_rows * num_secs)
+  };
+  {
+    InputStream<T> stream(
+      input_path,
+      num_rows,
+      N,
+      Base<T>::_sec_size,
+      num_rows,
+      {sample[0].data()},
+      {is_nonzero_row[0].get()}
+    );
+    typename InputStream<T>::Batch batch;
+    stream.acquire(batch);
+    stream.release(batch);
+  }
+
+  const ISA isa = detect_isa();
+  const CSRKernels<T> csr = get_csr_kernels<T>(N, Base<T>::_sec_size, isa);
+  const fixed_scatter_t<T> ell_scatter = Base<T>::_ell_width == 0 ?
+    nullptr : get_fixed_scatter<T>(Base<T>::_ell_width, isa);
+  _ones.assign(std::max(Base<T>::_sec_size, MAX_ELL_WIDTH), T(1));
+  std::vector<T> scratch(Base<T>::_sec_size + 1);
+  std::vector<int> results(num_rows);
+
+  T* Y[2] = {sample[0].data(), sample[1].data()};
+  bool* flags[2] = {is_nonzero_row[0].get(), is_nonzero_row[1].get()};
+
+  _layer_ms.assign(Base<T>::_num_layers, 0);
+  for(size_t cur_layer = 0; cur_layer < Base<T>::_num_layers; ++cur_layer) {
+    const size_t cur = cur_layer % 2;
+    const int* weight = Base<T>::_host_weight + Base<T>::_layers[cur_layer].offset;
+    const auto beg = std::chrono::steady_clock::now();
+    if(cur_layer + 1 == Base<T>::_num_layers) {
+      _identify_layer(Y[cur], flags[cur], num_rows, results.data(), scratch.data(), csr, ell_scatter);
+    }
+    else {
+      _infer_layer(Y, flags, cur, num_rows, cur_layer, weight, scratch.data(), csr, ell_scatter);
+    }
+    _layer_ms[cur_layer] = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - beg
+    ).count();
+  }
+}
+
+template <typename T>
+void CPUGPipe<T>::_partition_layers() {
+  const size_t num_layers = Base<T>::_num_layers;
+
+  //stages needed if none may take longer than bound
+  auto num_stages_within = [&](const double bound) {
+    size_t num_stages{1};
+    double ms{0};
+    for(const double layer_ms : _layer_ms) {
+      if(ms + layer_ms > bound && ms > 0) {
+        ++num_stages;
+        ms = 0;
+      }
+      ms += layer_ms;
+    }
+    return num_stages;
+  };
+
+  //the smallest bound reachable with _num_stages stages lies between the slowest layer and all layers
+  double lo = *std::max_element(_layer_ms.begin(), _layer_ms.end());
+  double hi = std::accumulate(_layer_ms.begin(), _layer_ms.end(), 0.0);
+  for(size_t iter = 0; iter < 64 && lo < hi; ++iter) {
+    const double mid = (lo + hi) / 2;
+    if(num_stages_within(mid) <= _num_stages) {
+      hi = mid;
+    }
+    else {
+      lo = mid;
+    }
+  }
+
+  //cut greedily within the bound, keeping at least one layer for every stage left
+  _stage_layers.assign(1, 0);
+  for(size_t stage = 0; stage < _num_stages; ++stage) {
+    const size_t beg = _stage_layers.back();
+    size_t end = beg + 1;
+    double ms = _layer_ms[beg];
+    if(stage + 1 == _num_stages) {
+      end = num_layers;
+    }
+    while(end < num_layers - (_num_stages - 1 - stage) && ms + _layer_ms[end] <= hi) {
+      ms += _layer_ms[end++];
+    }
+    _stage_layers.push_back(end);
+  }
+
+  for(size_t stage = 0; stage < _num_stages; ++stage) {
+    Base<T>::log(
+      "Stage ", stage, " : layers ", _stage_layers[stage], " to ", _stage_layers[stage + 1] - 1, ", ",
+      std::accumulate(_layer_ms.begin() + _stage_layers[stage], _layer_ms.begin() + _stage_layers[stage + 1], 0.0),
+      " ms on the first ", std::min(PROFILE_SAMPLE_ROWS, Base<T>::_num_inputs), " inputs", "\n"
+    );
+  }
+}
+
+template <typename T>
+void CPUGPipe<T>::_assign_cpus() {
+  //neighbouring cpus of a node tend to share caches, more threads than cpus wrap around
+  //only cpus this process may run on are used, all of them if the mask cannot be read
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  const bool has_mask = ::sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+  const NumaTopology topology = read_numa_topology();
+  std::vector<int> cpus;
+  for(const auto& node_cpus : topology.cpus) {
+    for(const int cpu : node_cpus) {
+      if(!has_mask || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  if(cpus.empty()) {
+    cpus = topology.cpus.front();
+  }
+
+  _stage_cpus.assign(_num_stages, {});
+  for(size_t stage = 0; stage < _num_stages; ++stage) {
+    for(size_t lane = 0; lane < _num_lanes; ++lane) {
+      _stage_cpus[stage].push_back(cpus[(stage * _num_lanes + lane) % cpus.size()]);
+    }
+    Base<T>::log(
+      "Stage ", stage, " : cpus ", _stage_cpus[stage].front(), " to ", _stage_cpus[stage].back(), "\n"
+    );
+  }
+}
+
+template <typename T>
+void CPUGPipe<T>::_infer() {
+  //pick the widest column scatter supported by this CPU
+  //and the CSR kernels specialized for the model sizes if there are
+  const ISA isa = detect_isa();
+  const CSRKernels<T> csr = get_csr_kernels<T>(Base<T>::_num_neurons, Base<T>::_sec_size, isa);
+  Base<T>::log("Using ", isa_name(isa), " column scatter", "\n");
+  if(Base<T>::_ell_width != 0) {
+    Base<T>::log("Using ELL weights with width ", Base<T>::_ell_width, "\n");
+  }
+  else {
+    Base<T>::log("Using ", csr.is_fixed ? "specialized" : "generic", " CSR kernels", "\n");
+  }
+  const fixed_scatter_t<T> ell_scatter = Base<T>::_ell_width == 0 ?
+    nullptr : get_fixed_scatter<T>(Base<T>::_ell_width, isa);
+
+  Base<T>::log("Start inference...... ", "\n");
+  Base<T>::tic();
+
+  //every stage blocks on its ring, thus each one gets a thread instead of a task
+  //a failed stage sets abort, so that stages waiting on a ring it no longer feeds or drains give up
+  std::vector<std::thread> threads;
+  std::vector<std::exception_ptr> errors(_num_lanes * _num_stages);
+  std::atomic<bool> abort{false};
+  threads.reserve(_num_lanes * _num_stages);
+  for(size_t lane = 0; lane < _num_lanes; ++lane) {
+    for(size_t stage = 0; stage < _num_stages; ++stage) {
+      threads.emplace_back([&, lane, stage](){
+        bind_thread(_stage_cpus[stage]);
+        try {
+          _run_stage(lane, stage, abort, csr, ell_scatter);
+        }
+        catch(...) {
+          errors[lane * _num_stages + stage] = std::current_exception();
+          abort = true;
+        }
+      });
+    }
+  }
+  for(auto& thread : threads) {
+    thread.join();
+  }
+  _input_stream.reset();
+
+  for(const auto& error : errors) {
+    if(error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  Base<T>::toc();
+  Base<T>::log("Finish inference with ", Base<T>::duration(), " ms", "\n");
+}
+
+template <typename T>
+void CPUGPipe<T>::_run_stage(
+  const size_t lane,
+  const size_t stage,
+  const std::atomic<bool>& abort,
+  const CSRKernels<T>& csr,
+  const fixed_scatter_t<T> ell_scatter
+) {
+  SPSCQueue<Packet*>& in = *_queues[lane * _num_stages + stage];
+  SPSCQueue<Packet*>* out = stage + 1 < _num_stages ?
+    _queues[lane * _num_stages + stage + 1].get() : _queues[lane * _num_stages].get();
+  const bool is_last = stage + 1 == _num_stages;
+  const size_t beg_layer = _stage_layers[stage];
+  const size_t end_layer = is_last ? Base<T>::_num_layers - 1 : _stage_layers[stage + 1];
+
+  //scratch accumulator of one section (plus an ELL padding slot)
+  std::vector<T> scratch(Base<T>::_sec_size + 1);
+
+  for(;;) {
+    Packet* packet{nullptr};
+    if(!in.pop(packet, abort)) {
+      return;
+    }
+
+    //the first stage takes back free packets and fills them from the input
+    if(stage == 0 && packet != nullptr) {
+      if(!_input_stream->acquire(packet->batch)) {
+        packet = nullptr;
+      }
+      else {
+        packet->Y[0] = packet->batch.Y;
+        packet->is_nonzero_row[0] = packet->batch.is_nonzero_row;
+        packet->cur = 0;
+      }
+    }
+
+    if(packet == nullptr) {
+      if(!is_last) {
+        out->push(nullptr, abort);
+      }
+      return;
+    }
+
+    for(size_t cur_layer = beg_layer; cur_layer < end_layer; ++cur_layer) {
+      _infer_layer(
+        packet->Y,
+        packet->is_nonzero_row,
+        packet->cur,
+        packet->batch.rows,
+        cur_layer,
+        Base<T>::_host_weight + Base<T>::_layers[cur_layer].offset,
+        scratch.data(),
+        csr,
+        ell_scatter
+      );
+      packet->cur = 1 - packet->cur;
+    }
+
+    if(is_last) {
+      //the last layer writes categories straight into the results
+      _identify_layer(
+        packet->Y[packet->cur],
+        packet->is_nonzero_row[packet->cur],
+        packet->batch.rows,
+        _results + packet->batch.beg,
+        scratch.data(),
+        csr,
+        ell_scatter
+      );
+      _input_stream->release(packet->batch);
+    }
+    if(!out->push(packet, abort)) {
+      return;
+    }
+  }
+}
+
+template <typename T>
+void CPUGPipe<T>::_infer_layer(
+  T* const Y[2],
+  bool* const is_nonzero_row[2],
+  const size_t cur,
+  const size_t num_rows,
+  const size_t cur_layer,
+  const int* weight,
+  T* scratch,
+  const CSRKernels<T>& csr,
+  const fixed_scatter_t<T> ell_scatter
+) {
+  const size_t nxt = 1 - cur;
+  const size_t N = Base<T>::_num_neurons;
+  const size_t num_secs = Base<T>::_num_secs;
+
+  //uniform layers do not stream any weight value
+  const bool is_uniform = Base<T>::_uniform_layers[cur_layer];
+  const T w_value = Base<T>::_uniform_values[cur_layer];
+  const T* val_w = is_uniform ? nullptr : (const T*)(weight + Base<T>::_layers[cur_layer].index_len);
+
+  for(size_t r = 0; r < num_rows; ++r) {
+    cpu_snig_packed_inference<T>(
+      Y[cur] + r * N,
+      is_nonzero_row[cur] + r * num_secs,
+      Base<T>::_sec_size,
+      num_secs,
+      N,
+      Base<T>::_ell_width,
+      weight,
+      val_w,
+      w_value,
+      _ones.data(),
+      Base<T>::_bias,
+      is_nonzero_row[nxt] + r * num_secs,
+      Y[nxt] + r * N,
+      scratch,
+      csr,
+      ell_scatter
+    );
+  }
+}
+
+template <typename T>
+void CPUGPipe<T>::_identify_layer(
+  const T* Y,
+  const bool* is_nonzero_row,
+  const size_t num_rows,
+  int* results,
+  T* scratch,
+  const CSRKernels<T>& csr,
+  const fixed_scatter_t<T> ell_scatter
+) {
+  const size_t last_layer = Base<T>::_num_layers - 1;
+  const size_t N = Base<T>::_num_neurons;
+  const size_t num_secs = Base<T>::_num_secs;
+  const int* weight = Base<T>::_host_weight + Base<T>::_layers[last_layer].offset;
+
+  const bool is_uniform = Base<T>::_uniform_layers[last_layer];
+  const T w_value = Base<T>::_uniform_values[last_layer];
+  const T* val_w = is_uniform ? nullptr : (const T*)(weight + Base<T>::_layers[last_layer].index_len);
+
+  for(size_t r = 0; r < num_rows; ++r) {
+    results[r] = cpu_snig_packed_identify_inference<T>(
+      Y + r * N,
+      is_nonzero_row + r * num_secs,
+      Base<T>::_sec_size,
+      num_secs,
+      N,
+      Base<T>::_ell_width,
+      weight,
+      val_w,
+      w_value,
+      _ones.data(),
+      Base<T>::_bias,
+      scratch,
+      csr,
+      ell_scatter
+    );
+  }
+}
+
+template <typename T>
+void CPUGPipe<T>::_weight_alloc() {
+  //all stages read the packed weight in place from Base<T>::_host_weight
+  _ones.assign(std::max(Base<T>::_sec_size, MAX_ELL_WIDTH), T(1));
+}
+
+template <typename T>
+void CPUGPipe<T>::_input_alloc() {
+  //every packet of a lane may hold a batch at once
+  const size_t num_packets = _num_stages + PIPELINE_SLACK;
+
+  for(size_t i = 0; i < _num_lanes * num_packets; ++i) {
+    _ring_Y.push_back(new T[_batch_ylen]);
+    _ring_is_nonzero_row.push_back(new bool[_batch_size * Base<T>::_num_secs]);
+  }
+
+  _lane_packets.resize(_num_lanes);
+  for(size_t lane = 0; lane < _num_lanes; ++lane) {
+    _lane_packets[lane].resize(num_packets);
+    for(auto& packet : _lane_packets[lane]) {
+      packet.Y[1] = new T[_batch_ylen]();
+      packet.is_nonzero_row[1] = new bool[_batch_size * Base<T>::_num_secs]();
+    }
+    //rings hold every packet and the end of the stream
+    for(size_t stage = 0; stage < _num_stages; ++stage) {
+      _queues.emplace_back(std::make_unique<SPSCQueue<Packet*> >(num_packets + 1));
+    }
+    for(auto& packet : _lane_packets[lane]) {
+      _queues[lane * _num_stages]->push(&packet);
+    }
+  }
+}
+
+template <typename T>
+void CPUGPipe<T>::_result_alloc() {
+  _results = new int[Base<T>::_num_inputs]();
+}
+
+}// end of namespace snig ----------------------------------------------
@@ -0,0 +1,1027 @@
+#pragma once
+
+#include <Eigen/Core>
+#include <taskflow/taskflow.hpp>
+#include <SNIG/utility/reader.hpp>
+#include <SNIG/utility/input_stream.hpp>
+#include <SNIG/utility/cache_info.hpp>
+#include <SNIG/utility/numa.hpp>
+#include <SNIG/utility/matrix_format.h>
+#include <SNIG/cpu_snig/kernel.hpp>
+#include <SNIG/base/base.hpp>
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <limits>
+
+namespace std {
+  namespace fs = experimental::filesystem;
+}
+
+namespace snig{
+
+//section size tuning times the first TUNE_SAMPLE_LAYERS layers on the first TUNE_SAMPLE_ROWS inputs
+constexpr size_t TUNE_SAMPLE_ROWS = 256;
+constexpr size_t TUNE_SAMPLE_LAYERS = 8;
+
+//rows left all zero are dropped from a batch every COMPACT_INTERVAL layers
+constexpr size_t COMPACT_INTERVAL = 8;
+
+template <typename T>
+class CPUSNIG : public Base<T> {
+
+  //Same section-skipping algorithm as SNIG, but all computation stays on host.
+  //Each worker of the executor owns one lane, which plays the role of one GPU in SNIG:
+  //a lane repeatedly fetches a batch and pushes it through all layers.
+
+  static_assert(
+    std::is_same<T, float>::value || std::is_same<T, double>::value,
+    "data type must be either float or double"
+  );
+
+  private:
+
+    //rows [beg, end) of the buffers of lane
+    struct RowRange {
+      size_t lane;
+      size_t beg;
+      size_t end;
+    };
+
+    size_t _batch_size;
+    size_t _min_batch_size;
+    size_t _num_threads;
+    size_t _compact_interval;
+    bool _tune{false};
+
+    //sizes batches from the time and live rows of finished ones
+    std::unique_ptr<BatchScheduler> _scheduler;
+
+    //inputs are streamed through a ring of two batches per lane,
+    //a lane computes in place on the ring buffer it fetched (_lane_Y[lane][0])
+    std::unique_ptr<InputStream<T> > _input_stream;
+    std::vector<T*> _ring_Y;
+    std::vector<bool*> _ring_is_nonzero_row;
+
+    std::vector<std::vector<T*> > _lane_Y;
+    std::vector<std::vector<bool*> > _lane_is_nonzero_row;
+
+    //live rows of the batch of each lane are compacted to the front of its buffers,
+    //row i of the buffers holds row _lane_rows[lane][i] of the batch
+    std::vector<std::vector<size_t> > _lane_rows;
+
+    //scratch accumulator of one section (plus an ELL padding slot) for each worker,
+    //the worker of lane i is worker i unless rows are balanced across lanes
+    std::vector<T*> _lane_results;
+
+    //unit weights scattered for uniform layers
+    std::vector<T> _ones;
+
+    //workers are bound to NUMA nodes in contiguous blocks unless _numa_mode is OFF,
+    //lane i keeps its buffers on the node of worker i
+    NumaMode _numa_mode;
+    NumaTopology _numa;
+
+    //packed weights read by the workers of node i are _node_weight[i], or _node_weight[0] if it is the only one
+    //copies are owned by _numa_weight, _host_weight is read in place otherwise
+    std::vector<const int*> _node_weight;
+    std::vector<std::unique_ptr<int[]> > _numa_weight;
+
+    size_t _batch_ylen;
+    int* _results{nullptr};
+
+    void _set_parameters(
+      const size_t num_inputs,
+      const size_t batch_size,
+      const size_t num_threads,
+      const size_t compact_interval,
+      const size_t min_batch_size
+    );
+
+    void _preprocess(const std::fs::path& input_path);
+
+    //pick the fastest section size among the ones whose accumulator fits in L1 or L2,
+    //and re-section the loaded model if it is not the current one
+    void _tune_sec_size(const std::fs::path& input_path);
+
+    //milliseconds of pushing sample through the first num_layers CSR layers packed at weight
+    double _time_sec_size(
+      const std::vector<T>& sample,
+      const size_t num_rows,
+      const size_t num_layers,
+      const size_t sec_size,
+      const int* weight,
+      const std::vector<PackedLayer>& layers
+    );
+
+    void  _infer();
+
+    void _log_scheduler();
+
+    //node index of the calling executor worker, bound to that node on its first call,
+    //0 if NUMA mode is off
+    size_t _worker_node(const tf::Executor& executor);
+
+    //per-node weight bandwidth and placement counters of an inference of duration ms,
+    //worker_batches and worker_remote_batches are indexed by executor worker (empty if not counted),
+    //stats are numastat counters read before the inference
+    void _log_numa(
+      const std::vector<size_t>& worker_batches,
+      const std::vector<size_t>& worker_remote_batches,
+      const std::vector<NumaStat>& stats,
+      const double ms
+    );
+
+    //push rows of range through layer cur_layer packed at weight,
+    //using the scratch accumulator of worker
+    void _infer_layer(
+      const size_t worker,
+      const RowRange& range,
+      const size_t cur_layer,
+      const int* weight,
+      const CSRKernels<T>& csr,
+      const fixed_scatter_t<T> ell_scatter
+    );
+
+    //drop rows of lane whose output in buffer buf is all zero,
+    //moving the live ones to the front in order
+    void _compact_rows(const size_t lane, const size_t buf);
+
+    //push rows of range through the last layer packed at weight,
+    //and identify them into results of the batch of range.lane without storing outputs
+    //rows dropped before are left untouched
+    void _identify_layer(
+      const size_t worker,
+      const RowRange& range,
+      const size_t cur_layer,
+      const int* weight,
+      int* results,
+      const CSRKernels<T>& csr,
+      const fixed_scatter_t<T> ell_scatter
+    );
+
+    //split the live rows of the first num_lanes lanes evenly among all workers,
+    //a worker keeps the rows of its own lane up to its share and takes the surplus of others,
+    //returns the number of rows handed to a worker other than their lane
+    size_t _balance_rows(
+      const size_t num_lanes,
+      std::vector<std::vector<RowRange> >& worker_ranges
+    );
+
+    void _input_alloc();
+
+    void _weight_alloc();
+
+    void _result_alloc();
+
+  public:
+
+    //num_resident_layers bounds the layers kept in memory, 0 keeps the whole model resident
+    //tune_sec_size picks the section size for the caches of this CPU before the first inference
+    //numa_mode places resident weights on the NUMA nodes and binds workers to nodes (see NumaMode)
+    CPUSNIG(
+      const std::fs::path& weight_path,
+      const T bias = -.3f,
+      const size_t num_neurons_per_layer = 1024,
+      const size_t num_layers = 120,
+      const size_t num_resident_layers = 0,
+      const bool tune_sec_size = false,
+      const NumaMode numa_mode = NumaMode::OFF
+    );
+
+    ~CPUSNIG();
+
+    //compact_interval == 0 never drops dead rows
+    //batches have between min_batch_size and batch_size rows (see BatchScheduler),
+    //min_batch_size >= batch_size keeps them all at batch_size
+    Eigen::Matrix<int, Eigen::Dynamic, 1> infer(
+      const std::fs::path& input_path,
+      const size_t num_inputs,
+      const size_t batch_size,
+      const size_t num_threads,
+      const size_t compact_interval = COMPACT_INTERVAL,
+      const size_t min_batch_size = MIN_BATCH_SIZE
+    );
+
+};
+
+// ----------------------------------------------------------------------------
+// Definition of CPUSNIG
+// ----------------------------------------------------------------------------
+
+template <typename T>
+CPUSNIG<T>::CPUSNIG(
+  const std::fs::path& weight_path,
+  const T bias,
+  const size_t num_neurons_per_layer,
+  const size_t num_layers,
+  const size_t num_resident_layers,
+  const bool tune_sec_size,
+  const NumaMode numa_mode
+):
+  Base<T>(
+    weight_path,
+    bias,
+    num_neurons_per_layer,
+    num_layers,
+    get_sec_size<T>(num_neurons_per_layer),
+    WeightOptions{MAX_ELL_WIDTH, true, true, true, true, num_resident_layers}
+  ),
+  _tune{tune_sec_size},
+  _numa_mode{numa_mode}
+{
+  Base<T>::log("Constructing CPUSNIG engine......", "\n");
+
+  if(_numa_mode != NumaMode::OFF) {
+    _numa = read_numa_topology();
+    Base<T>::log("NUMA mode ", to_string(_numa_mode), " on ", _numa.num_nodes(), " nodes", "\n");
+    if(Base<T>::_layer_window != nullptr || _numa.num_nodes() < 2) {
+      Base<T>::log(
+        Base<T>::_layer_window != nullptr ? "Streamed layers are" : "Weights on one node are",
+        " not placed, workers are still bound", "\n"
+      );
+    }
+  }
+}
+
+template <typename T>
+CPUSNIG<T>::~CPUSNIG() {
+  //stop the I/O thread before freeing its buffers
+  _input_stream.reset();
+
+  for(auto& Y_in_ring : _ring_Y) {
+    delete[] Y_in_ring;
+  }
+  for(auto& rowsY_in_ring : _ring_is_nonzero_row) {
+    delete[] rowsY_in_ring;
+  }
+  for(auto& Y_in_lane : _lane_Y) {
+    delete[] Y_in_lane[1];
+  }
+  for(auto& rowsY_in_lane : _lane_is_nonzero_row) {
+    delete[] rowsY_in_lane[1];
+  }
+  for(auto& results_in_lane : _lane_results) {
+    delete[] results_in_lane;
+  }
+
+  delete[] _results;
+}
+
+template <typename T>
+Eigen::Matrix<int, Eigen::Dynamic, 1> CPUSNIG<T>::infer(
+  const std::fs::path& input_path,
+  const size_t num_inputs,
+  const size_t batch_size,
+  const size_t num_threads,
+  const size_t compact_interval,
+  const size_t min_batch_size
+) {
+
+  Base<T>::log("Using ", num_threads, " CPU threads", "\n");
+  Base<T>::log("Total input size : ", num_inputs, "\n");
+  Base<T>::log("Input batch size : ", std::min(min_batch_size, batch_size), " to ", batch_size, "\n");
+  Base<T>::log("Row compaction interval : ", compact_interval, "\n\n");
+
+  _set_parameters(
+    num_inputs,
+    batch_size,
+    num_threads,
+    compact_interval,
+    min_batch_size
+  );
+
+  _preprocess(input_path);
+
+  _infer();
+
+  return arr_to_Eigen_int(_results, Base<T>::_num_inputs);
+}
+
+template <typename T>
+void CPUSNIG<T>::_set_parameters(
+  const size_t num_inputs,
+  const size_t batch_size,
+  const size_t num_threads,
+  const size_t compact_interval,
+  const size_t min_batch_size
+) {
+  Base<T>::_num_inputs = num_inputs;
+  _num_threads = num_threads;
+  _compact_interval = compact_interval;
+
+  _batch_size = batch_size;
+  _min_batch_size = min_batch_size;
+  _batch_ylen = _batch_size * Base<T>::_num_neurons;
+
+  _lane_Y.reserve(_num_threads);
+  _lane_is_nonzero_row.reserve(_num_threads);
+  _lane_results.reserve(_num_threads);
+  _lane_rows.resize(_num_threads);
+}
+
+template <typename T>
+void CPUSNIG<T>::_preprocess(const std::fs::path& input_path) {
+  //buffers below depend on the section size
+  if(_tune) {
+    _tune_sec_size(input_path);
+    _tune = false;
+  }
+
+  Base<T>::log("Preprocessing...... ");
+  Base<T>::tic();
+
+  //weight allocation
+  _weight_alloc();
+  //input allocation
+  _input_alloc();
+  //final results allocation
+  _result_alloc();
+
+  //start reading input, batches are consumed by lanes while later ones are read
+  _scheduler = std::make_unique<BatchScheduler>(
+    Base<T>::_num_inputs,
+    _batch_size,
+    _min_batch_size,
+    _num_threads
+  );
+  _input_stream = std::make_unique<InputStream<T> >(
+    input_path,
+    Base<T>::_num_inputs,
+    Base<T>::_num_neurons,
+    Base<T>::_sec_size,
+    _batch_size,
+    _ring_Y,
+    _ring_is_nonzero_row,
+    _scheduler.get()
+  );
+
+  Base<T>::toc();
+  Base<T>::log("Finish preprocessing with ", Base<T>::duration(), " ms", "\n");
+}
+
+template <typename T>
+void CPUSNIG<T>::_tune_sec_size(const std::fs::path& input_path) {
+  if(Base<T>::_layer_window != nullptr) {
+    Base<T>::log("Skip section size tuning for streamed layers", "\n");
+    return;
+  }
+
+  const CacheInfo cache = read_cache_info();
+  Base<T>::log(
+    "Tuning section size for L1d ", cache.l1d >> 10, " KB and L2 ", cache.l2 >> 10, " KB", "\n"
+  );
+
+  //the accumulator of one section should stay in L1 or L2
+  std::vector<size_t> candidates{Base<T>::_sec_size};
+  for(const size_t budget : {cache.l1d / 2, cache.l1d, cache.l2 / 2, cache.l2}) {
+    candidates.push_back(get_sec_size<T>(Base<T>::_num_neurons, budget));
+  }
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+  const size_t num_rows = std::min(TUNE_SAMPLE_ROWS, Base<T>::_num_inputs);
+  const size_t num_layers = std::min(TUNE_SAMPLE_LAYERS, Base<T>::_num_layers);
+  std::vector<T> sample(num_rows * Base<T>::_num_neurons);
+  {
+    //one section, flags are recomputed for every candidate
+    auto flags = std::make_unique<bool[]>(num_rows);
+    InputStream<T> stream(
+      input_path,
+      num_rows,
+      Base<T>::_num_neurons,
+      Base<T>::_num_neurons,
+      num_rows,
+      {sample.data()},
+      {flags.get()}
+    );
+    typename InputStream<T>::Batch batch;
+    stream.acquire(batch);
+    stream.release(batch);
+  }
+
+  size_t best_sec_size = Base<T>::_sec_size;
+  double best_ms = 0;
+  for(const size_t sec_size : candidates) {
+    //every candidate, the current one included, is re-packed as CSR
+    //so that an ELL model does not favour the section size it was loaded with
+    std::unique_ptr<int[]> weight;
+    const auto layers = Base<T>::_resection_layers(sec_size, num_layers, weight);
+
+    //the faster of two runs, the first one also warms up the caches
+    double ms = std::numeric_limits<double>::max();
+    for(size_t run = 0; run < 2; ++run) {
+      ms = std::min(ms, _time_sec_size(sample, num_rows, num_layers, sec_size, weight.get(), layers));
+    }
+    Base<T>::log("  section size ", sec_size, " : ", ms, " ms", "\n");
+
+    if(sec_size == candidates.front() || ms < best_ms) {
+      best_ms = ms;
+      best_sec_size = sec_size;
+    }
+  }
+
+  if(best_sec_size != Base<T>::_sec_size) {
+    Base<T>::log("Re-sectioning the model with section size ", best_sec_size, "\n");
+    Base<T>::_resection_weight(best_sec_size);
+  }
+  else {
+    Base<T>::log("Keeping section size ", best_sec_size, "\n");
+  }
+}
+
+template <typename T>
+double CPUSNIG<T>::_time_sec_size(
+  const std::vector<T>& sample,
+  const size_t num_rows,
+  const size_t num_layers,
+  const size_t sec_size,
+  const int* weight,
+  const std::vector<PackedLayer>& layers
+) {
+  const size_t N = Base<T>::_num_neurons;
+  const size_t num_secs = N / sec_size;
+  const CSRKernels<T> csr = get_csr_kernels<T>(N, sec_size, detect_isa());
+
+  std::vector<T> Y[2] = {sample, std::vector<T>(num_rows * N, T(0))};
+  std::unique_ptr<bool[]> is_nonzero_row[2] = {
+    std::make_unique<bool[]>(num_rows * num_secs),
+    std::make_unique<bool[]>(num_rows * num_secs)
+  };
+  for(size_t r = 0; r < num_rows; ++r) {
+    for(size_t j = 0; j < N; ++j) {
+      is_nonzero_row[0][r * num_secs + j / sec_size] |= (Y[0][r * N + j] != T(0));
+    }
+  }
+  std::vector<T> ones(sec_size, T(1));
+  std::vector<T> results(sec_size + 1);
+
+  auto beg = std::chrono::steady_clock::now();
+  for(size_t cur_layer = 0; cur_layer < num_layers; ++cur_layer) {
+    const size_t cur = cur_layer % 2;
+    const size_t nxt = (cur_layer + 1) % 2;
+    const bool is_uniform = Base<T>::_uniform_layers[cur_layer];
+    const T w_value = Base<T>::_uniform_values[cur_layer];
+    const int* index_w = weight + layers[cur_layer].offset;
+    const T* val_w = is_uniform ? nullptr : (const T*)(index_w + layers[cur_layer].index_len);
+    for(size_t r = 0; r < num_rows; ++r) {
+      csr.inference(
+        Y[cur].data() + r * N, is_nonzero_row[cur].get() + r * num_secs,
+        sec_size, num_secs, N, index_w, index_w + N * num_secs + 1, val_w, w_value, ones.data(), Base<T>::_bias,
+        is_nonzero_row[nxt].get() + r * num_secs, Y[nxt].data() + r * N, results.data(),
+        csr.scatter, csr.block_scatter
+      );
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - beg).count();
+}
+
+template <typename T>
+void CPUSNIG<T>::_infer() {
+  //pick the widest column scatter supported by this CPU
+  //and the CSR kernels specialized for the model sizes if there are
+  const ISA isa = detect_isa();
+  const CSRKernels<T> csr = get_csr_kernels<T>(Base<T>::_num_neurons, Base<T>::_sec_size, isa);
+  Base<T>::log("Using ", isa_name(isa), " column scatter", "\n");
+  if(Base<T>::_ell_width != 0) {
+    Base<T>::log("Using ELL weights with width ", Base<T>::_ell_width, "\n");
+  }
+  else {
+    Base<T>::log("Using ", csr.is_fixed ? "specialized" : "generic", " CSR kernels", "\n");
+  }
+  const fixed_scatter_t<T> ell_scatter = Base<T>::_ell_width == 0 ?
+    nullptr : get_fixed_scatter<T>(Base<T>::_ell_width, isa);
+
+  std::vector<NumaStat> numa_stats;
+  for(size_t node = 0; _numa_mode != NumaMode::OFF && node < _numa.num_nodes(); ++node) {
+    numa_stats.push_back(read_numa_stat(_numa.nodes[node]));
+  }
+
+  Base<T>::log("Start inference...... ", "\n");
+  Base<T>::tic();
+
+  //Use taskflow to implement the same task graph as SNIG
+  //cudaFlow of each GPU is replaced by a static task of each lane
+  tf::Taskflow taskflow("CPUSNIG");
+  tf::Executor executor(_num_threads);
+  std::vector<tf::Task> first_fetchs;
+  std::vector<tf::Task> infers;
+  std::vector<tf::Task> fetchs;
+  first_fetchs.reserve(_num_threads);
+  infers.reserve(_num_threads);
+  fetchs.reserve(_num_threads);
+
+  std::vector<int*> lane_results(_num_threads, nullptr);
+  //the last batch may be smaller than _batch_size
+  std::vector<size_t> lane_batch_size(_num_threads, 0);
+  std::vector<typename InputStream<T>::Batch> lane_batch(_num_threads);
+
+  auto fetch = [&](const size_t lane) {
+    //results of the previous batch are already identified
+    if(lane_batch[lane].Y != nullptr) {
+      _input_stream->release(lane_batch[lane]);
+      lane_batch[lane] = typename InputStream<T>::Batch{};
+    }
+    if(!_input_stream->acquire(lane_batch[lane])) {
+      return 1;
+    }
+    lane_results[lane] = _results + lane_batch[lane].beg;
+    lane_batch_size[lane] = lane_batch[lane].rows;
+    //rows dropped before the last layer stay 0
+    std::fill(lane_results[lane], lane_results[lane] + lane_batch_size[lane], 0);
+    _lane_rows[lane].resize(lane_batch[lane].rows);
+    std::iota(_lane_rows[lane].begin(), _lane_rows[lane].end(), size_t(0));
+    _lane_Y[lane][0] = lane_batch[lane].Y;
+    _lane_is_nonzero_row[lane][0] = lane_batch[lane].is_nonzero_row;
+    return 0;
+  };
+
+  //layers streamed through a window are consumed layer-major:
+  //a wave of one batch per lane goes through a layer before the next layer is acquired,
+  //thus the model is read from disk once per wave.
+  //Every layer ends at a barrier, and batches die off at different rates,
+  //thus workers do not own lanes here: live rows of all lanes are split evenly among workers
+  //as ranges of the lane buffers, re-split whenever compaction drops rows.
+  //Rows are computed where they are, only the ranges move.
+  if(Base<T>::_layer_window != nullptr) {
+    size_t cur_layer{0};
+    const int* weight{nullptr};
+    std::vector<std::vector<RowRange> > worker_ranges(_num_threads);
+    size_t num_live_rows{0};
+    size_t num_moved_rows{0};
+    for(;;) {
+      //once the stream is exhausted every later fetch fails, active lanes are a prefix
+      size_t num_active{0};
+      for(size_t lane = 0; lane < _num_threads; ++lane) {
+        num_active += (fetch(lane) == 0);
+      }
+      if(num_active == 0) {
+        break;
+      }
+
+      const auto wave_beg = std::chrono::steady_clock::now();
+      tf::Taskflow wave("CPUSNIG wave");
+      for(size_t worker = 0; worker < _num_threads; ++worker) {
+        wave.emplace([&, worker](){
+          _worker_node(executor);
+          for(const auto& range : worker_ranges[worker]) {
+            if(cur_layer + 1 == Base<T>::_num_layers) {
+              _identify_layer(
+                worker, range, cur_layer, weight, lane_results[range.lane], csr, ell_scatter
+              );
+            }
+            else {
+              _infer_layer(worker, range, cur_layer, weight, csr, ell_scatter);
+            }
+          }
+        });
+      }
+
+      //a lane is compacted once all of its rows passed the layer
+      tf::Taskflow compaction("CPUSNIG compaction");
+      for(size_t lane = 0; lane < num_active; ++lane) {
+        compaction.emplace([&, lane](){
+          _compact_rows(lane, (cur_layer + 1) % 2);
+        });
+      }
+
+      num_moved_rows += _balance_rows(num_active, worker_ranges);
+      for(size_t lane = 0; lane < num_active; ++lane) {
+        num_live_rows += _lane_rows[lane].size();
+      }
+
+      for(cur_layer = 0; cur_layer < Base<T>::_num_layers; ++cur_layer) {
+        weight = Base<T>::_layer_window->acquire(cur_layer);
+        executor.run(wave).wait();
+        Base<T>::_layer_window->release();
+
+        if(
+          _compact_interval != 0 &&
+          cur_layer + 1 < Base<T>::_num_layers &&
+          (cur_layer + 1) % _compact_interval == 0
+        ) {
+          executor.run(compaction).wait();
+          num_moved_rows += _balance_rows(num_active, worker_ranges);
+          for(size_t lane = 0; lane < num_active; ++lane) {
+            num_live_rows += _lane_rows[lane].size();
+          }
+        }
+      }
+
+      //rows of a wave are balanced over all workers, each batch is charged its share of the wave
+      const double wave_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - wave_beg
+      ).count();
+      for(size_t lane = 0; lane < num_active; ++lane) {
+        _scheduler->report(
+          lane_batch_size[lane],
+          std::count(lane_results[lane], lane_results[lane] + lane_batch_size[lane], 1),
+          wave_ms / num_active
+        );
+      }
+    }
+    _input_stream.reset();
+
+    Base<T>::toc();
+    const auto infer_ms = Base<T>::duration();
+    Base<T>::log("Finish inference with ", infer_ms, " ms", "\n");
+    _log_scheduler();
+    Base<T>::log(
+      "Balanced ", num_moved_rows, " of ", num_live_rows,
+      " live rows onto workers other than their lane", "\n"
+    );
+    if(_numa_mode != NumaMode::OFF) {
+      _log_numa({}, {}, numa_stats, infer_ms);
+    }
+    return;
+  }
+
+  //batches run by each executor worker, and those whose lane buffers are on another node
+  std::vector<size_t> worker_batches(_num_threads, 0);
+  std::vector<size_t> worker_remote_batches(_num_threads, 0);
+
+  tf::Task start = taskflow.emplace([](){
+  }).name("start");
+
+  for(size_t lane = 0; lane < _num_threads; ++lane) {
+    first_fetchs.emplace_back(taskflow.emplace([&, lane](){
+      return fetch(lane);
+    }).name("first_fetch"));
+
+    infers.emplace_back(taskflow.emplace([&, lane](){
+      const auto batch_beg = std::chrono::steady_clock::now();
+      const size_t last_layer = Base<T>::_num_layers - 1;
+
+      //weights local to the node of this worker, lane buffers are local to the node of lane
+      const size_t node = _worker_node(executor);
+      const int* weight = _node_weight[_node_weight.size() == 1 ? 0 : node];
+      if(_numa_mode != NumaMode::OFF) {
+        const size_t worker = executor.this_worker_id();
+        ++worker_batches[worker];
+        worker_remote_batches[worker] += (node != _numa.node_of(lane, _num_threads));
+      }
+
+      for(size_t cur_layer = 0; cur_layer < last_layer; ++cur_layer) {
+        _infer_layer(
+          lane,
+          RowRange{lane, 0, _lane_rows[lane].size()},
+          cur_layer,
+          weight + Base<T>::_layers[cur_layer].offset,
+          csr,
+          ell_scatter
+        );
+        //later layers only touch rows which are still alive
+        if(_compact_interval != 0 && (cur_layer + 1) % _compact_interval == 0) {
+          _compact_rows(lane, (cur_layer + 1) % 2);
+        }
+      }
+
+      //the last layer writes categories straight into the results
+      _identify_layer(
+        lane,
+        RowRange{lane, 0, _lane_rows[lane].size()},
+        last_layer,
+        weight + Base<T>::_layers[last_layer].offset,
+        lane_results[lane],
+        csr,
+        ell_scatter
+      );
+
+      _scheduler->report(
+        lane_batch_size[lane],
+        std::count(lane_results[lane], lane_results[lane] + lane_batch_size[lane], 1),
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - batch_beg).count()
+      );
+    }).name("CPU"));
+
+    fetchs.emplace_back(taskflow.emplace([&, lane](){
+      return fetch(lane);
+    }).name("fetch"));
+  }
+
+  tf::Task stop = taskflow.emplace([](){}).name("stop");
+
+  //dependencies of taskflow
+  for(size_t lane = 0; lane < _num_threads; ++lane) {
+    start.precede(first_fetchs[lane]);
+    first_fetchs[lane].precede(infers[lane], stop);
+    infers[lane].precede(fetchs[lane]);
+    fetchs[lane].precede(infers[lane], stop);
+  }
+
+  executor.run(taskflow).wait();
+  _input_stream.reset();
+
+  Base<T>::toc();
+  const auto infer_ms = Base<T>::duration();
+  Base<T>::log("Finish inference with ", infer_ms, " ms", "\n");
+  _log_scheduler();
+  if(_numa_mode != NumaMode::OFF) {
+    _log_numa(worker_batches, worker_remote_batches, numa_stats, infer_ms);
+  }
+}
+
+template <typename T>
+size_t CPUSNIG<T>::_worker_node(const tf::Executor& executor) {
+  if(_numa_mode == NumaMode::OFF) {
+    return 0;
+  }
+  return bind_worker(_numa, executor.this_worker_id(), _num_threads);
+}
+
+template <typename T>
+void CPUSNIG<T>::_log_numa(
+  const std::vector<size_t>& worker_batches,
+  const std::vector<size_t>& worker_remote_batches,
+  const std::vector<NumaStat>& stats,
+  const double ms
+) {
+  //every batch streams the packed weight of each layer once, the rows of a batch reuse it from cache
+  const double batch_bytes = static_cast<double>(sizeof(int) * Base<T>::_host_wlen);
+
+  for(size_t node = 0; node < _numa.num_nodes(); ++node) {
+    size_t num_workers{0};
+    size_t num_batches{0};
+    size_t num_remote_batches{0};
+    for(size_t worker = 0; worker < _num_threads; ++worker) {
+      if(_numa.node_of(worker, _num_threads) != node) {
+        continue;
+      }
+      ++num_workers;
+      if(worker < worker_batches.size()) {
+        num_batches += worker_batches[worker];
+        num_remote_batches += worker_remote_batches[worker];
+      }
+    }
+    const NumaStat stat = read_numa_stat(_numa.nodes[node]);
+    Base<T>::log("NUMA node ", _numa.nodes[node], " : ", num_workers, " workers, ");
+    if(!worker_batches.empty()) {
+      Base<T>::log(
+        num_batches, " batches (", num_remote_batches, " on lane buffers of another node), ",
+        ms > 0 ? num_batches * batch_bytes / ms / 1e6 : 0, " GB/s of weights, "
+      );
+    }
+    Base<T>::log(
+      "other_node +", stat.other_node - stats[node].other_node,
+      " numa_miss +", stat.numa_miss - stats[node].numa_miss, " pages (system-wide)", "\n"
+    );
+  }
+}
+
+template <typename T>
+void CPUSNIG<T>::_log_scheduler() {
+  Base<T>::log(
+    "Scheduled ", _scheduler->num_batches(), " batches of ",
+    _scheduler->smallest_batch(), " to ", _scheduler->largest_batch(), " inputs, ",
+    _scheduler->live_fraction() * 100, "% alive after the last layer", "\n"
+  );
+}
+
+template <typename T>
+void CPUSNIG<T>::_infer_layer(
+  const size_t worker,
+  const RowRange& range,
+  const size_t cur_layer,
+  const int* weight,
+  const CSRKernels<T>& csr,
+  const fixed_scatter_t<T> ell_scatter
+) {
+  const size_t lane = range.lane;
+  const size_t cur = cur_layer % 2;
+  const size_t nxt = (cur_layer + 1) % 2;
+
+  //uniform layers do not stream any weight value
+  const bool is_uniform = Base<T>::_uniform_layers[cur_layer];
+  const T w_value = Base<T>::_uniform_values[cur_layer];
+  const T* val_w = is_uniform ? nullptr : (const T*)(weight + Base<T>::_layers[cur_layer].index_len);
+
+  for(size_t r = range.beg; r < range.end; ++r) {
+    cpu_snig_packed_inference<T>(
+      _lane_Y[lane][cur] + r * Base<T>::_num_neurons,
+      _lane_is_nonzero_row[lane][cur] + r * Base<T>::_num_secs,
+      Base<T>::_sec_size,
+      Base<T>::_num_secs,
+      Base<T>::_num_neurons,
+      Base<T>::_ell_width,
+      weight,
+      val_w,
+      w_value,
+      _ones.data(),
+      Base<T>::_bias,
+      _lane_is_nonzero_row[lane][nxt] + r * Base<T>::_num_secs,
+      _lane_Y[lane][nxt] + r * Base<T>::_num_neurons,
+      _lane_results[worker],
+      csr,
+      ell_scatter
+    );
+  }
+}
+
+template <typename T>
+void CPUSNIG<T>::_compact_rows(const size_t lane, const size_t buf) {
+  //kernels keep every row of both buffers consistent with its section flags,
+  //thus rows may be moved without clearing the ones left behind
+  const size_t N = Base<T>::_num_neurons;
+  const size_t num_secs = Base<T>::_num_secs;
+  T* Y = _lane_Y[lane][buf];
+  bool* is_nonzero_row = _lane_is_nonzero_row[lane][buf];
+  auto& rows = _lane_rows[lane];
+
+  size_t num_live{0};
+  for(size_t r = 0; r < rows.size(); ++r) {
+    if(std::none_of(
+      is_nonzero_row + r * num_secs,
+      is_nonzero_row + (r + 1) * num_secs,
+      [](const bool is_nonzero) { return is_nonzero; }
+    )) {
+      continue;
+    }
+    if(num_live != r) {
+      std::copy(Y + r * N, Y + (r + 1) * N, Y + num_live * N);
+      std::copy(
+        is_nonzero_row + r * num_secs,
+        is_nonzero_row + (r + 1) * num_secs,
+        is_nonzero_row + num_live * num_secs
+      );
+      rows[num_live] = rows[r];
+    }
+    ++num_live;
+  }
+  rows.resize(num_live);
+}
+
+template <typename T>
+void CPUSNIG<T>::_identify_layer(
+  const size_t worker,
+  const RowRange& range,
+  const size_t cur_layer,
+  const int* weight,
+  int* results,
+  const CSRKernels<T>& csr,
+  const fixed_scatter_t<T> ell_scatter
+) {
+  const size_t lane = range.lane;
+  const size_t cur = cur_layer % 2;
+  const size_t N = Base<T>::_num_neurons;
+  const size_t num_secs = Base<T>::_num_secs;
+  const auto& rows = _lane_rows[lane];
+
+  const bool is_uniform = Base<T>::_uniform_layers[cur_layer];
+  const T w_value = Base<T>::_uniform_values[cur_layer];
+  const T* val_w = is_uniform ? nullptr : (const T*)(weight + Base<T>::_layers[cur_layer].index_len);
+
+  for(size_t i = range.beg; i < range.end; ++i) {
+    results[rows[i]] = cpu_snig_packed_identify_inference<T>(
+      _lane_Y[lane][cur] + i * N,
+      _lane_is_nonzero_row[lane][cur] + i * num_secs,
+      Base<T>::_sec_size,
+      num_secs,
+      N,
+      Base<T>::_ell_width,
+      weight,
+      val_w,
+      w_value,
+      _ones.data(),
+      Base<T>::_bias,
+      _lane_results[worker],
+      csr,
+      ell_scatter
+    );
+  }
+}
+
+template <typename T>
+size_t CPUSNIG<T>::_balance_rows(
+  const size_t num_lanes,
+  std::vector<std::vector<RowRange> >& worker_ranges
+) {
+  const size_t num_workers = worker_ranges.size();
+
+  size_t num_rows{0};
+  for(size_t lane = 0; lane < num_lanes; ++lane) {
+    num_rows += _lane_rows[lane].size();
+  }
+  const size_t share = (num_rows + num_workers - 1) / num_workers;
+
+  //the worker of a lane keeps up to its share, the buffers of its lane are in its cache
+  std::vector<size_t> num_kept(num_lanes, 0);
+  std::vector<size_t> load(num_workers, 0);
+  for(size_t worker = 0; worker < num_workers; ++worker) {
+    worker_ranges[worker].clear();
+    if(worker < num_lanes) {
+      num_kept[worker] = std::min(_lane_rows[worker].size(), share);
+      load[worker] = num_kept[worker];
+      if(num_kept[worker] != 0) {
+        worker_ranges[worker].push_back(RowRange{worker, 0, num_kept[worker]});
+      }
+    }
+  }
+
+  //surplus rows fill the workers below their share in order
+  size_t num_moved{0};
+  size_t worker{0};
+  for(size_t lane = 0; lane < num_lanes; ++lane) {
+    for(size_t beg = num_kept[lane]; beg < _lane_rows[lane].size(); ) {
+      while(load[worker] == share) {
+        ++worker;
+      }
+      const size_t end = std::min(_lane_rows[lane].size(), beg + share - load[worker]);
+      worker_ranges[worker].push_back(RowRange{lane, beg, end});
+      load[worker] += end - beg;
+      num_moved += end - beg;
+      beg = end;
+    }
+  }
+  return num_moved;
+}
+
+template <typename T>
+void CPUSNIG<T>::_weight_alloc() {
+  //all lanes read the packed weight in place from Base<T>::_host_weight
+  //unless NUMA mode places copies of it on the nodes
+  _ones.assign(std::max(Base<T>::_sec_size, MAX_ELL_WIDTH), T(1));
+
+  _node_weight.assign(1, Base<T>::_host_weight);
+  _numa_weight.clear();
+  if(_numa_mode == NumaMode::OFF || Base<T>::_layer_window != nullptr || _numa.num_nodes() < 2) {
+    return;
+  }
+
+  //pages of new arrays are not touched yet, the copying threads place them
+  const size_t wlen = Base<T>::_host_wlen;
+  if(_numa_mode == NumaMode::REPLICATE) {
+    for(size_t node = 0; node < _numa.num_nodes(); ++node) {
+      _numa_weight.emplace_back(new int[wlen]);
+      int* weight = _numa_weight.back().get();
+      run_on_node(_numa, node, [&](){
+        std::copy(Base<T>::_host_weight, Base<T>::_host_weight + wlen, weight);
+      });
+    }
+  }
+  else {
+    _numa_weight.emplace_back(new int[wlen]);
+    interleave_copy(_numa, _numa_weight.back().get(), Base<T>::_host_weight, sizeof(int) * wlen);
+  }
+
+  _node_weight.clear();
+  for(const auto& weight : _numa_weight) {
+    _node_weight.push_back(weight.get());
+  }
+}
+
+template <typename T>
+void CPUSNIG<T>::_input_alloc() {
+  //double buffering for every lane
+  for(size_t i = 0; i < 2 * _num_threads; ++i) {
+    _ring_Y.push_back(new T[_batch_ylen]);
+    _ring_is_nonzero_row.push_back(new bool[_batch_size * Base<T>::_num_secs]);
+  }
+
+  //_lane_Y[lane][0] points to the ring buffer of the fetched batch
+  //in NUMA mode buffers are cleared below by a thread of the node of their lane
+  const bool is_numa = _numa_mode != NumaMode::OFF;
+  std::vector<T*> Y{2, nullptr};
+  std::vector<bool*> is_nonzero_row{2, nullptr};
+  for(size_t lane = 0; lane < _num_threads; ++lane) {
+    Y[1] = is_numa ? new T[_batch_ylen] : new T[_batch_ylen]();
+    is_nonzero_row[1] = is_numa ?
+      new bool[_batch_size * Base<T>::_num_secs] : new bool[_batch_size * Base<T>::_num_secs]();
+    _lane_Y.push_back(Y);
+    _lane_is_nonzero_row.push_back(is_nonzero_row);
+    //one more slot for padded ELL entries
+    _lane_results.push_back(new T[Base<T>::_sec_size + 1]);
+  }
+
+  if(!is_numa) {
+    return;
+  }
+
+  //any lane may fetch any ring slot, slots are still spread over the nodes as lanes are
+  for(size_t node = 0; node < _numa.num_nodes(); ++node) {
+    run_on_node(_numa, node, [&](){
+      for(size_t lane = 0; lane < _num_threads; ++lane) {
+        if(_numa.node_of(lane, _num_threads) != node) {
+          continue;
+        }
+        const size_t slen = _batch_size * Base<T>::_num_secs;
+        std::fill(_lane_Y[lane][1], _lane_Y[lane][1] + _batch_ylen, T(0));
+        std::fill(_lane_is_nonzero_row[lane][1], _lane_is_nonzero_row[lane][1] + slen, false);
+        std::fill(_lane_results[lane], _lane_results[lane] + Base<T>::_sec_size + 1, T(0));
+        for(size_t i = 2 * lane; i < 2 * lane + 2; ++i) {
+          std::fill(_ring_Y[i], _ring_Y[i] + _batch_ylen, T(0));
+          std::fill(_ring_is_nonzero_row[i], _ring_is_nonzero_row[i] + slen, false);
+        }
+      }
+    });
+  }
+}
+
+template <typename T>
+void CPUSNIG<T>::_result_alloc() {
+  _results = new int[Base<T>::_num_inputs]();
+}
+
+}// end of namespace snig ----------------------------------------------
@@ -0,0 +1,867 @@
+#pragma once
+#include <algorithm>
+#include <numeric>
+#include <SNIG/cpu_snig/scatter.hpp>
+
+namespace snig{
+
+//fan-in of the Graph Challenge networks,
+//CSR columns are scattered in unrolled blocks of FAN_IN entries
+constexpr size_t FAN_IN = 32;
+
+//sizes of one row as seen by the row kernels, known at run time
+struct RowShape {
+  size_t sec_size;
+  size_t num_secs;
+  size_t num_neurons;
+};
+
+//sizes of one row known at compile time, loops over them have constant trip counts
+template <size_t N, size_t SEC>
+struct FixedRowShape {
+  static_assert(SEC <= N && N % SEC == 0, "sections must split the row evenly");
+  static constexpr size_t sec_size = SEC;
+  static constexpr size_t num_secs = N / SEC;
+  static constexpr size_t num_neurons = N;
+};
+
+template <typename T>
+void cpu_snig_inference(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const size_t sec_size,
+  const size_t num_secs,
+  const size_t num_neurons,
+  const int* col_w,
+  const int* row_w,
+  const T* val_w,
+  const T w_value,
+  const T* ones,
+  const T bias,
+  bool* is_nonzero_row_1,
+  T* Y_1,
+  T* results,
+  scatter_t<T> scatter = &scatter_scalar<T>,
+  fixed_scatter_t<T> block_scatter = nullptr
+);
+
+//cpu_snig_inference for rows of N neurons in sections of SEC,
+//accumulates into a stack array of SEC entries, results is not touched
+template <typename T, size_t N, size_t SEC>
+void cpu_snig_fixed_inference(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const size_t sec_size,
+  const size_t num_secs,
+  const size_t num_neurons,
+  const int* col_w,
+  const int* row_w,
+  const T* val_w,
+  const T w_value,
+  const T* ones,
+  const T bias,
+  bool* is_nonzero_row_1,
+  T* Y_1,
+  T* results,
+  scatter_t<T> scatter,
+  fixed_scatter_t<T> block_scatter
+);
+
+//ELL version of cpu_snig_inference
+//every row of a section owns exactly width slots, padded slots hit results[sec_size]
+template <typename T>
+void cpu_snig_ell_inference(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const size_t sec_size,
+  const size_t num_secs,
+  const size_t num_neurons,
+  const size_t width,
+  const int* row_w,
+  const T* val_w,
+  const T w_value,
+  const T* ones,
+  const T bias,
+  bool* is_nonzero_row_1,
+  T* Y_1,
+  T* results,
+  fixed_scatter_t<T> scatter
+);
+
+//rows gathered together by cpu_snig_pull_inference, the trip count of its inner loop
+constexpr size_t PULL_ROWS = 16;
+
+//pull version of cpu_snig_inference for num_rows consecutive rows
+//row_w, col_w, and val_w are CSR over output neurons (see transpose_layer),
+//every output neuron gathers its inputs for all rows at once from Y_t,
+//scratch of num_neurons * (num_rows rounded up to PULL_ROWS) entries
+template <typename T>
+void cpu_snig_pull_inference(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const size_t num_rows,
+  const size_t sec_size,
+  const size_t num_secs,
+  const size_t num_neurons,
+  const int* row_w,
+  const int* col_w,
+  const T* val_w,
+  const T w_value,
+  const T bias,
+  bool* is_nonzero_row_1,
+  T* Y_1,
+  T* Y_t
+);
+
+//last layer of cpu_snig_inference fused with cpu_identify
+//returns the category of the row (1 if any output is nonzero) without writing its outputs,
+//sections after the first nonzero one are not computed
+template <typename T>
+int cpu_snig_identify_inference(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const size_t sec_size,
+  const size_t num_secs,
+  const size_t num_neurons,
+  const int* col_w,
+  const int* row_w,
+  const T* val_w,
+  const T w_value,
+  const T* ones,
+  const T bias,
+  T* results,
+  scatter_t<T> scatter,
+  fixed_scatter_t<T> block_scatter = nullptr
+);
+
+//cpu_snig_identify_inference for rows of N neurons in sections of SEC
+template <typename T, size_t N, size_t SEC>
+int cpu_snig_fixed_identify_inference(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const size_t sec_size,
+  const size_t num_secs,
+  const size_t num_neurons,
+  const int* col_w,
+  const int* row_w,
+  const T* val_w,
+  const T w_value,
+  const T* ones,
+  const T bias,
+  T* results,
+  scatter_t<T> scatter,
+  fixed_scatter_t<T> block_scatter
+);
+
+//last layer of cpu_snig_ell_inference fused with cpu_identify
+template <typename T>
+int cpu_snig_ell_identify_inference(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const size_t sec_size,
+  const size_t num_secs,
+  const size_t num_neurons,
+  const size_t width,
+  const int* row_w,
+  const T* val_w,
+  const T w_value,
+  const T* ones,
+  const T bias,
+  T* results,
+  fixed_scatter_t<T> scatter
+);
+
+template <typename T>
+void cpu_identify(
+  const T* target_arr,
+  const size_t batch_size,
+  const size_t num_neurons_per_layer,
+  int* result_arr
+);
+
+//CSR row kernels and the column scatters they are called with
+//inference and identify share the signatures of cpu_snig_inference and cpu_snig_identify_inference
+template <typename T>
+struct CSRKernels {
+  void (*inference)(
+    const T*, const bool*, const size_t, const size_t, const size_t,
+    const int*, const int*, const T*, const T, const T*, const T,
+    bool*, T*, T*, scatter_t<T>, fixed_scatter_t<T>
+  );
+  int (*identify)(
+    const T*, const bool*, const size_t, const size_t, const size_t,
+    const int*, const int*, const T*, const T, const T*, const T,
+    T*, scatter_t<T>, fixed_scatter_t<T>
+  );
+  scatter_t<T> scatter;
+  fixed_scatter_t<T> block_scatter;
+  //true if inference and identify are specialized for the row sizes
+  bool is_fixed;
+};
+
+//kernels specialized for num_neurons in {1024, 4096, 16384, 65536}
+//and sec_size in {1024, 2048, 4096, 8192, 16384}, the generic ones otherwise
+template <typename T>
+CSRKernels<T> get_csr_kernels(const size_t num_neurons, const size_t sec_size, const ISA isa);
+
+//one row through a packed layer, with the ELL kernel if ell_width != 0 and the CSR kernels of csr otherwise
+//weight is the index part of the layer (CSC by input neuron for CSR), val_w == nullptr marks a uniform layer
+template <typename T>
+void cpu_snig_packed_inference(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const size_t sec_size,
+  const size_t num_secs,
+  const size_t num_neurons,
+  const size_t ell_width,
+  const int* weight,
+  const T* val_w,
+  const T w_value,
+  const T* ones,
+  const T bias,
+  bool* is_nonzero_row_1,
+  T* Y_1,
+  T* results,
+  const CSRKernels<T>& csr,
+  fixed_scatter_t<T> ell_scatter
+);
+
+//last layer of cpu_snig_packed_inference fused with cpu_identify
+template <typename T>
+int cpu_snig_packed_identify_inference(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const size_t sec_size,
+  const size_t num_secs,
+  const size_t num_neurons,
+  const size_t ell_width,
+  const int* weight,
+  const T* val_w,
+  const T w_value,
+  const T* ones,
+  const T bias,
+  T* results,
+  const CSRKernels<T>& csr,
+  fixed_scatter_t<T> ell_scatter
+);
+
+//-----------------------------------------------------------------------------
+//Definition of kernel function
+//-----------------------------------------------------------------------------
+
+template <size_t N, size_t SEC>
+constexpr size_t FixedRowShape<N, SEC>::sec_size;
+
+template <size_t N, size_t SEC>
+constexpr size_t FixedRowShape<N, SEC>::num_secs;
+
+template <size_t N, size_t SEC>
+constexpr size_t FixedRowShape<N, SEC>::num_neurons;
+
+// one CSR column [beg_w, end_w) of a section, blocks of FAN_IN entries go through
+// block_scatter (get_fixed_scatter of FAN_IN) if given, the rest through scatter
+// val_w == nullptr scatters ones instead
+template <typename T>
+void _cpu_scatter_column(
+  const T valY,
+  int beg_w,
+  const int end_w,
+  const int* row_w,
+  const T* val_w,
+  const T* ones,
+  const int offset,
+  T* results,
+  scatter_t<T> scatter,
+  fixed_scatter_t<T> block_scatter
+) {
+  if(block_scatter != nullptr) {
+    for(; beg_w + int(FAN_IN) <= end_w; beg_w += FAN_IN) {
+      block_scatter(valY, row_w + beg_w, val_w == nullptr ? ones : val_w + beg_w, offset, results);
+    }
+  }
+  if(beg_w == end_w) {
+    return;
+  }
+  if(val_w == nullptr) {
+    scatter(valY, row_w + beg_w, ones, 0, end_w - beg_w, offset, results);
+  }
+  else {
+    scatter(valY, row_w, val_w, beg_w, end_w, offset, results);
+  }
+}
+
+// pre-activations of output section s_o of one row, shared by all weight formats
+// update(s_o, j, valY) accumulates input neuron j into output section s_o
+// uniform layers accumulate plain activations from bias / w_value and multiply by w_value once per neuron,
+// w_value is a power of two (see is_exact_scaling), thus every partial sum is the weighted one scaled exactly
+template <typename T, typename S, typename F>
+void _cpu_snig_section(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const S& shape,
+  const size_t s_o,
+  const bool is_uniform,
+  const T w_value,
+  const T bias,
+  T* results,
+  F&& update
+) {
+  //set results to bias directly
+  std::fill(results, results + shape.sec_size, is_uniform ? bias / w_value : bias);
+
+  for(size_t s_i = 0; s_i < shape.num_secs; ++s_i) {
+    if(!is_nonzero_row_0[s_i]) {
+      continue;
+    }
+    for(size_t j = s_i * shape.sec_size; j < (s_i + 1) * shape.sec_size; ++j) {
+      T valY = Y_0[j];
+      if(valY == 0) {
+        continue;
+      }
+      update(s_o, j, valY);
+    }
+  }
+
+  if(is_uniform) {
+    for(size_t i = 0; i < shape.sec_size; ++i) {
+      results[i] *= w_value;
+    }
+  }
+}
+
+inline
+bool _cpu_is_all_zero(const bool* is_nonzero_row, const size_t num_secs) {
+  bool is_all_zero = true;
+  for(size_t s = 0; s < num_secs; ++s) {
+    is_all_zero &= !is_nonzero_row[s];
+  }
+  return is_all_zero;
+}
+
+// section skipping of one row shared by all weight formats
+template <typename T, typename S, typename F>
+void _cpu_snig_row(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const S& shape,
+  const bool is_uniform,
+  const T w_value,
+  const T bias,
+  bool* is_nonzero_row_1,
+  T* Y_1,
+  T* results,
+  F&& update
+) {
+  if(_cpu_is_all_zero(is_nonzero_row_0, shape.num_secs)) {
+    //incremental memory resetting
+    //only touch sections which are not zero yet
+    for(size_t s_o = 0; s_o < shape.num_secs; ++s_o) {
+      if(is_nonzero_row_1[s_o]) {
+        std::fill(Y_1 + s_o * shape.sec_size, Y_1 + (s_o + 1) * shape.sec_size, T(0));
+        is_nonzero_row_1[s_o] = false;
+      }
+    }
+    return;
+  }
+
+  for(size_t s_o = 0; s_o < shape.num_secs; ++s_o) {
+    _cpu_snig_section(
+      Y_0, is_nonzero_row_0, shape, s_o, is_uniform, w_value, bias, results, update
+    );
+
+    bool is_nonzero = false;
+    for(size_t i = 0; i < shape.sec_size; ++i) {
+      T v = std::min(T(32), std::max(results[i], T(0)));
+      Y_1[s_o * shape.sec_size + i] = v;
+      is_nonzero |= (v != 0);
+    }
+    is_nonzero_row_1[s_o] = is_nonzero;
+  }
+}
+
+// category of one row after the last layer, outputs are only tested
+// an output survives ReLU/clip exactly when its pre-activation is positive
+template <typename T, typename S, typename F>
+int _cpu_snig_row_category(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const S& shape,
+  const bool is_uniform,
+  const T w_value,
+  const T bias,
+  T* results,
+  F&& update
+) {
+  if(_cpu_is_all_zero(is_nonzero_row_0, shape.num_secs)) {
+    return 0;
+  }
+
+  for(size_t s_o = 0; s_o < shape.num_secs; ++s_o) {
+    _cpu_snig_section(
+      Y_0, is_nonzero_row_0, shape, s_o, is_uniform, w_value, bias, results, update
+    );
+    if(std::any_of(results, results + shape.sec_size, [](const T v) { return v > 0; })) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// host version of snig_inference
+// one call handles one row (all blockIdx.y of one blockIdx.x on GPU)
+// results is a scratch accumulator of sec_size owned by the calling worker
+// scatter is the column update selected by get_scatter
+// val_w == nullptr marks a uniform layer whose weights all equal w_value,
+// then columns are scattered with ones, unit weights of at least sec_size entries
+template <typename T>
+void cpu_snig_inference(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const size_t sec_size,
+  const size_t num_secs,
+  const size_t num_neurons,
+  const int* col_w,
+  const int* row_w,
+  const T* val_w,
+  const T w_value,
+  const T* ones,
+  const T bias,
+  bool* is_nonzero_row_1,
+  T* Y_1,
+  T* results,
+  scatter_t<T> scatter,
+  fixed_scatter_t<T> block_scatter
+) {
+  _cpu_snig_row(
+    Y_0,
+    is_nonzero_row_0,
+    RowShape{sec_size, num_secs, num_neurons},
+    val_w == nullptr,
+    w_value,
+    bias,
+    is_nonzero_row_1,
+    Y_1,
+    results,
+    [&](const size_t s_o, const size_t j, const T valY) {
+      _cpu_scatter_column(
+        valY,
+        col_w[s_o * num_neurons + j],
+        col_w[s_o * num_neurons + j + 1],
+        row_w,
+        val_w,
+        ones,
+        s_o * sec_size,
+        results,
+        scatter,
+        block_scatter
+      );
+    }
+  );
+}
+
+// no row index lookup, scatter is get_fixed_scatter of the same width,
+// whose trip count is known at compile time
+// results needs sec_size + 1 entries, the last one absorbs padded slots
+// uniform layers are handled as in cpu_snig_inference, ones needs at least width entries
+template <typename T>
+void cpu_snig_ell_inference(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const size_t sec_size,
+  const size_t num_secs,
+  const size_t num_neurons,
+  const size_t width,
+  const int* row_w,
+  const T* val_w,
+  const T w_value,
+  const T* ones,
+  const T bias,
+  bool* is_nonzero_row_1,
+  T* Y_1,
+  T* results,
+  fixed_scatter_t<T> scatter
+) {
+  _cpu_snig_row(
+    Y_0,
+    is_nonzero_row_0,
+    RowShape{sec_size, num_secs, num_neurons},
+    val_w == nullptr,
+    w_value,
+    bias,
+    is_nonzero_row_1,
+    Y_1,
+    results,
+    [&](const size_t s_o, const size_t j, const T valY) {
+      scatter(
+        valY,
+        row_w + (s_o * num_neurons + j) * width,
+        val_w == nullptr ? ones : val_w + (s_o * num_neurons + j) * width,
+        s_o * sec_size,
+        results
+      );
+    }
+  );
+}
+
+template <typename T>
+int cpu_snig_identify_inference(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const size_t sec_size,
+  const size_t num_secs,
+  const size_t num_neurons,
+  const int* col_w,
+  const int* row_w,
+  const T* val_w,
+  const T w_value,
+  const T* ones,
+  const T bias,
+  T* results,
+  scatter_t<T> scatter,
+  fixed_scatter_t<T> block_scatter
+) {
+  return _cpu_snig_row_category(
+    Y_0,
+    is_nonzero_row_0,
+    RowShape{sec_size, num_secs, num_neurons},
+    val_w == nullptr,
+    w_value,
+    bias,
+    results,
+    [&](const size_t s_o, const size_t j, const T valY) {
+      _cpu_scatter_column(
+        valY,
+        col_w[s_o * num_neurons + j],
+        col_w[s_o * num_neurons + j + 1],
+        row_w,
+        val_w,
+        ones,
+        s_o * sec_size,
+        results,
+        scatter,
+        block_scatter
+      );
+    }
+  );
+}
+
+// constant sizes let the compiler unroll section loops and drop index multiplications,
+// the accumulator of one section lives on the stack
+template <typename T, size_t N, size_t SEC>
+void cpu_snig_fixed_inference(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const size_t,
+  const size_t,
+  const size_t,
+  const int* col_w,
+  const int* row_w,
+  const T* val_w,
+  const T w_value,
+  const T* ones,
+  const T bias,
+  bool* is_nonzero_row_1,
+  T* Y_1,
+  T*,
+  scatter_t<T> scatter,
+  fixed_scatter_t<T> block_scatter
+) {
+  using S = FixedRowShape<N, SEC>;
+  alignas(64) T results[SEC];
+  _cpu_snig_row(
+    Y_0,
+    is_nonzero_row_0,
+    S{},
+    val_w == nullptr,
+    w_value,
+    bias,
+    is_nonzero_row_1,
+    Y_1,
+    results,
+    [&](const size_t s_o, const size_t j, const T valY) {
+      _cpu_scatter_column(
+        valY,
+        col_w[s_o * S::num_neurons + j],
+        col_w[s_o * S::num_neurons + j + 1],
+        row_w,
+        val_w,
+        ones,
+        s_o * S::sec_size,
+        results,
+        scatter,
+        block_scatter
+      );
+    }
+  );
+}
+
+template <typename T, size_t N, size_t SEC>
+int cpu_snig_fixed_identify_inference(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const size_t,
+  const size_t,
+  const size_t,
+  const int* col_w,
+  const int* row_w,
+  const T* val_w,
+  const T w_value,
+  const T* ones,
+  const T bias,
+  T*,
+  scatter_t<T> scatter,
+  fixed_scatter_t<T> block_scatter
+) {
+  using S = FixedRowShape<N, SEC>;
+  alignas(64) T results[SEC];
+  return _cpu_snig_row_category(
+    Y_0,
+    is_nonzero_row_0,
+    S{},
+    val_w == nullptr,
+    w_value,
+    bias,
+    results,
+    [&](const size_t s_o, const size_t j, const T valY) {
+      _cpu_scatter_column(
+        valY,
+        col_w[s_o * S::num_neurons + j],
+        col_w[s_o * S::num_neurons + j + 1],
+        row_w,
+        val_w,
+        ones,
+        s_o * S::sec_size,
+        results,
+        scatter,
+        block_scatter
+      );
+    }
+  );
+}
+
+template <typename T>
+int cpu_snig_ell_identify_inference(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const size_t sec_size,
+  const size_t num_secs,
+  const size_t num_neurons,
+  const size_t width,
+  const int* row_w,
+  const T* val_w,
+  const T w_value,
+  const T* ones,
+  const T bias,
+  T* results,
+  fixed_scatter_t<T> scatter
+) {
+  return _cpu_snig_row_category(
+    Y_0,
+    is_nonzero_row_0,
+    RowShape{sec_size, num_secs, num_neurons},
+    val_w == nullptr,
+    w_value,
+    bias,
+    results,
+    [&](const size_t s_o, const size_t j, const T valY) {
+      scatter(
+        valY,
+        row_w + (s_o * num_neurons + j) * width,
+        val_w == nullptr ? ones : val_w + (s_o * num_neurons + j) * width,
+        s_o * sec_size,
+        results
+      );
+    }
+  );
+}
+
+// weights are read once per call instead of once per row,
+// and each output is summed in the same order as the push kernels sum it
+// rows whose input is all zero stay zero, as in cpu_snig_inference
+template <typename T>
+void cpu_snig_pull_inference(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const size_t num_rows,
+  const size_t sec_size,
+  const size_t num_secs,
+  const size_t num_neurons,
+  const int* row_w,
+  const int* col_w,
+  const T* val_w,
+  const T w_value,
+  const T bias,
+  bool* is_nonzero_row_1,
+  T* Y_1,
+  T* Y_t
+) {
+  //inputs of all rows of neuron j become contiguous, padded rows read zeros
+  const size_t stride = (num_rows + PULL_ROWS - 1) / PULL_ROWS * PULL_ROWS;
+  for(size_t r = 0; r < stride; ++r) {
+    for(size_t j = 0; j < num_neurons; ++j) {
+      Y_t[j * stride + r] = r < num_rows ? Y_0[r * num_neurons + j] : T(0);
+    }
+  }
+
+  std::fill(is_nonzero_row_1, is_nonzero_row_1 + num_rows * num_secs, false);
+
+  for(size_t i = 0; i < num_neurons; ++i) {
+    const size_t s_o = i / sec_size;
+    for(size_t r_0 = 0; r_0 < num_rows; r_0 += PULL_ROWS) {
+      //uniform layers accumulate plain activations and multiply by w_value once
+      T acc[PULL_ROWS];
+      std::fill(acc, acc + PULL_ROWS, val_w == nullptr ? bias / w_value : bias);
+      for(int k = row_w[i]; k < row_w[i + 1]; ++k) {
+        const T* Y_j = Y_t + col_w[k] * stride + r_0;
+        const T w = val_w == nullptr ? T(1) : val_w[k];
+        for(size_t r = 0; r < PULL_ROWS; ++r) {
+          acc[r] += Y_j[r] * w;
+        }
+      }
+
+      for(size_t r = r_0; r < std::min(r_0 + PULL_ROWS, num_rows); ++r) {
+        T v = val_w == nullptr ? acc[r - r_0] * w_value : acc[r - r_0];
+        v = std::min(T(32), std::max(v, T(0)));
+        Y_1[r * num_neurons + i] = v;
+        is_nonzero_row_1[r * num_secs + s_o] |= (v != 0);
+      }
+    }
+  }
+
+  for(size_t r = 0; r < num_rows; ++r) {
+    if(_cpu_is_all_zero(is_nonzero_row_0 + r * num_secs, num_secs)) {
+      std::fill(Y_1 + r * num_neurons, Y_1 + (r + 1) * num_neurons, T(0));
+      std::fill(is_nonzero_row_1 + r * num_secs, is_nonzero_row_1 + (r + 1) * num_secs, false);
+    }
+  }
+}
+
+template <typename T>
+void cpu_identify(
+  const T* target_arr,
+  const size_t batch_size,
+  const size_t num_neurons_per_layer,
+  int* result_arr
+) {
+  for(size_t i = 0; i < batch_size; ++i) {
+    T sum = std::accumulate(
+      target_arr + i * num_neurons_per_layer,
+      target_arr + (i + 1) * num_neurons_per_layer,
+      T(0)
+    );
+    result_arr[i] = sum > 0 ? 1 : 0;
+  }
+}
+
+//sizes without a specialization fall back to the generic kernels
+template <typename T, size_t N, size_t SEC, bool = (SEC <= N)>
+struct _FixedCSRKernels {
+  static void set(CSRKernels<T>& kernels) {
+    kernels.inference = &cpu_snig_fixed_inference<T, N, SEC>;
+    kernels.identify = &cpu_snig_fixed_identify_inference<T, N, SEC>;
+    kernels.is_fixed = true;
+  }
+};
+
+template <typename T, size_t N, size_t SEC>
+struct _FixedCSRKernels<T, N, SEC, false> {
+  static void set(CSRKernels<T>&) {
+  }
+};
+
+template <typename T, size_t N>
+void _set_fixed_csr_kernels(const size_t sec_size, CSRKernels<T>& kernels) {
+  switch(sec_size) {
+    case 1024:  _FixedCSRKernels<T, N, 1024>::set(kernels);  break;
+    case 2048:  _FixedCSRKernels<T, N, 2048>::set(kernels);  break;
+    case 4096:  _FixedCSRKernels<T, N, 4096>::set(kernels);  break;
+    case 8192:  _FixedCSRKernels<T, N, 8192>::set(kernels);  break;
+    case 16384: _FixedCSRKernels<T, N, 16384>::set(kernels); break;
+    default:    break;
+  }
+}
+
+template <typename T>
+CSRKernels<T> get_csr_kernels(const size_t num_neurons, const size_t sec_size, const ISA isa) {
+  CSRKernels<T> kernels{
+    &cpu_snig_inference<T>,
+    &cpu_snig_identify_inference<T>,
+    get_scatter<T>(isa),
+    get_fixed_scatter<T>(FAN_IN, isa),
+    false
+  };
+  switch(num_neurons) {
+    case 1024:  _set_fixed_csr_kernels<T, 1024>(sec_size, kernels);  break;
+    case 4096:  _set_fixed_csr_kernels<T, 4096>(sec_size, kernels);  break;
+    case 16384: _set_fixed_csr_kernels<T, 16384>(sec_size, kernels); break;
+    case 65536: _set_fixed_csr_kernels<T, 65536>(sec_size, kernels); break;
+    default:    break;
+  }
+  return kernels;
+}
+
+template <typename T>
+void cpu_snig_packed_inference(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const size_t sec_size,
+  const size_t num_secs,
+  const size_t num_neurons,
+  const size_t ell_width,
+  const int* weight,
+  const T* val_w,
+  const T w_value,
+  const T* ones,
+  const T bias,
+  bool* is_nonzero_row_1,
+  T* Y_1,
+  T* results,
+  const CSRKernels<T>& csr,
+  fixed_scatter_t<T> ell_scatter
+) {
+  if(ell_width != 0) {
+    cpu_snig_ell_inference<T>(
+      Y_0, is_nonzero_row_0, sec_size, num_secs, num_neurons, ell_width,
+      weight, val_w, w_value, ones, bias, is_nonzero_row_1, Y_1, results, ell_scatter
+    );
+    return;
+  }
+  // transformed CSC weight matrix equals to CSR with exchanged row and col
+  csr.inference(
+    Y_0, is_nonzero_row_0, sec_size, num_secs, num_neurons,
+    weight, weight + num_neurons * num_secs + 1, val_w, w_value, ones, bias,
+    is_nonzero_row_1, Y_1, results, csr.scatter, csr.block_scatter
+  );
+}
+
+template <typename T>
+int cpu_snig_packed_identify_inference(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const size_t sec_size,
+  const size_t num_secs,
+  const size_t num_neurons,
+  const size_t ell_width,
+  const int* weight,
+  const T* val_w,
+  const T w_value,
+  const T* ones,
+  const T bias,
+  T* results,
+  const CSRKernels<T>& csr,
+  fixed_scatter_t<T> ell_scatter
+) {
+  if(ell_width != 0) {
+    return cpu_snig_ell_identify_inference<T>(
+      Y_0, is_nonzero_row_0, sec_size, num_secs, num_neurons, ell_width,
+      weight, val_w, w_value, ones, bias, results, ell_scatter
+    );
+  }
+  return csr.identify(
+    Y_0, is_nonzero_row_0, sec_size, num_secs, num_neurons,
+    weight, weight + num_neurons * num_secs + 1, val_w, w_value, ones, bias,
+    results, csr.scatter, csr.block_scatter
+  );
+}
+
+}// end of namespace snig ----------------------------------------------
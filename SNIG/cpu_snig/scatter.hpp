@@ -0,0 +1,400 @@
+#pragma once
+#include <string>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SNIG_X86_SIMD
+#endif
+
+namespace snig{
+
+//column scatter of the CSC section update
+//  results[row_w[k] - offset] += valY * val_w[k], for k in [beg_w, end_w)
+//row indices within one column are distinct,
+//thus vector lanes never conflict and no atomic operation is needed
+template <typename T>
+using scatter_t = void (*)(
+  const T valY,
+  const int* row_w,
+  const T* val_w,
+  const int beg_w,
+  const int end_w,
+  const int offset,
+  T* results
+);
+
+//fixed-width scatter of one ELL row, WIDTH slots starting at row_w and val_w
+template <typename T>
+using fixed_scatter_t = void (*)(
+  const T valY,
+  const int* row_w,
+  const T* val_w,
+  const int offset,
+  T* results
+);
+
+enum class ISA {
+  SCALAR,
+  AVX2,
+  AVX512
+};
+
+inline
+ISA detect_isa();
+
+inline
+std::string isa_name(const ISA isa);
+
+template <typename T>
+scatter_t<T> get_scatter(const ISA isa);
+
+template <typename T, size_t WIDTH>
+fixed_scatter_t<T> get_fixed_scatter(const ISA isa);
+
+//maximum ELL width with a fixed-width scatter
+constexpr size_t MAX_ELL_WIDTH = 256;
+
+template <typename T>
+fixed_scatter_t<T> get_fixed_scatter(const size_t width, const ISA isa);
+
+template <typename T>
+void scatter_scalar(
+  const T valY,
+  const int* row_w,
+  const T* val_w,
+  const int beg_w,
+  const int end_w,
+  const int offset,
+  T* results
+);
+
+template <typename T, size_t WIDTH>
+void fixed_scatter_scalar(
+  const T valY,
+  const int* row_w,
+  const T* val_w,
+  const int offset,
+  T* results
+);
+
+//-----------------------------------------------------------------------------
+//Definition of scatter function
+//-----------------------------------------------------------------------------
+
+inline
+ISA detect_isa() {
+#ifdef SNIG_X86_SIMD
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx512f")) {
+    return ISA::AVX512;
+  }
+  if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return ISA::AVX2;
+  }
+#endif
+  return ISA::SCALAR;
+}
+
+inline
+std::string isa_name(const ISA isa) {
+  switch(isa) {
+    case ISA::AVX512:
+      return "AVX-512";
+    case ISA::AVX2:
+      return "AVX2";
+    default:
+      return "scalar";
+  }
+}
+
+template <typename T>
+void scatter_scalar(
+  const T valY,
+  const int* row_w,
+  const T* val_w,
+  const int beg_w,
+  const int end_w,
+  const int offset,
+  T* results
+) {
+  for(int k = beg_w; k < end_w; ++k) {
+    results[row_w[k] - offset] += valY * val_w[k];
+  }
+}
+
+template <typename T, size_t WIDTH>
+void fixed_scatter_scalar(
+  const T valY,
+  const int* row_w,
+  const T* val_w,
+  const int offset,
+  T* results
+) {
+  for(size_t k = 0; k < WIDTH; ++k) {
+    results[row_w[k] - offset] += valY * val_w[k];
+  }
+}
+
+#ifdef SNIG_X86_SIMD
+
+//AVX2 has gather but no scatter, lanes are stored back one by one
+__attribute__((target("avx2,fma")))
+inline
+void scatter_avx2(
+  const float valY,
+  const int* row_w,
+  const float* val_w,
+  const int beg_w,
+  const int end_w,
+  const int offset,
+  float* results
+) {
+  const __m256 vy = _mm256_set1_ps(valY);
+  const __m256i voff = _mm256_set1_epi32(offset);
+  alignas(32) int idx[8];
+  alignas(32) float acc[8];
+  int k = beg_w;
+  for(; k + 8 <= end_w; k += 8) {
+    __m256i vidx = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(row_w + k)), voff);
+    __m256 vacc = _mm256_i32gather_ps(results, vidx, sizeof(float));
+    vacc = _mm256_fmadd_ps(vy, _mm256_loadu_ps(val_w + k), vacc);
+    _mm256_store_si256((__m256i*)idx, vidx);
+    _mm256_store_ps(acc, vacc);
+    for(int l = 0; l < 8; ++l) {
+      results[idx[l]] = acc[l];
+    }
+  }
+  scatter_scalar<float>(valY, row_w, val_w, k, end_w, offset, results);
+}
+
+__attribute__((target("avx2,fma")))
+inline
+void scatter_avx2(
+  const double valY,
+  const int* row_w,
+  const double* val_w,
+  const int beg_w,
+  const int end_w,
+  const int offset,
+  double* results
+) {
+  const __m256d vy = _mm256_set1_pd(valY);
+  const __m128i voff = _mm_set1_epi32(offset);
+  alignas(16) int idx[4];
+  alignas(32) double acc[4];
+  int k = beg_w;
+  for(; k + 4 <= end_w; k += 4) {
+    __m128i vidx = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(row_w + k)), voff);
+    __m256d vacc = _mm256_i32gather_pd(results, vidx, sizeof(double));
+    vacc = _mm256_fmadd_pd(vy, _mm256_loadu_pd(val_w + k), vacc);
+    _mm_store_si128((__m128i*)idx, vidx);
+    _mm256_store_pd(acc, vacc);
+    for(int l = 0; l < 4; ++l) {
+      results[idx[l]] = acc[l];
+    }
+  }
+  scatter_scalar<double>(valY, row_w, val_w, k, end_w, offset, results);
+}
+
+//AVX-512 gathers and scatters a whole column with masked tails
+__attribute__((target("avx512f")))
+inline
+void scatter_avx512(
+  const float valY,
+  const int* row_w,
+  const float* val_w,
+  const int beg_w,
+  const int end_w,
+  const int offset,
+  float* results
+) {
+  const __m512 vy = _mm512_set1_ps(valY);
+  const __m512i voff = _mm512_set1_epi32(offset);
+  for(int k = beg_w; k < end_w; k += 16) {
+    const int remains = end_w - k;
+    const __mmask16 m = remains >= 16 ? __mmask16(0xFFFF) : __mmask16((1u << remains) - 1);
+    __m512i vidx = _mm512_sub_epi32(_mm512_maskz_loadu_epi32(m, row_w + k), voff);
+    __m512 vacc = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), m, vidx, results, sizeof(float));
+    vacc = _mm512_fmadd_ps(vy, _mm512_maskz_loadu_ps(m, val_w + k), vacc);
+    _mm512_mask_i32scatter_ps(results, m, vidx, vacc, sizeof(float));
+  }
+}
+
+__attribute__((target("avx512f")))
+inline
+void scatter_avx512(
+  const double valY,
+  const int* row_w,
+  const double* val_w,
+  const int beg_w,
+  const int end_w,
+  const int offset,
+  double* results
+) {
+  const __m512d vy = _mm512_set1_pd(valY);
+  const __m256i voff = _mm256_set1_epi32(offset);
+  for(int k = beg_w; k < end_w; k += 8) {
+    const int remains = end_w - k;
+    const __mmask8 m = remains >= 8 ? __mmask8(0xFF) : __mmask8((1u << remains) - 1);
+    //8 row indices, loaded through the lower half of a 512-bit register
+    __m256i vidx = _mm256_sub_epi32(
+      _mm512_castsi512_si256(_mm512_maskz_loadu_epi32(__mmask16(m), row_w + k)),
+      voff
+    );
+    __m512d vacc = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), m, vidx, results, sizeof(double));
+    vacc = _mm512_fmadd_pd(vy, _mm512_maskz_loadu_pd(m, val_w + k), vacc);
+    _mm512_mask_i32scatter_pd(results, m, vidx, vacc, sizeof(double));
+  }
+}
+
+//fixed-width versions need no tail mask when WIDTH is a multiple of the vector length
+template <size_t WIDTH>
+__attribute__((target("avx2,fma")))
+void fixed_scatter_avx2(
+  const float valY,
+  const int* row_w,
+  const float* val_w,
+  const int offset,
+  float* results
+) {
+  const __m256 vy = _mm256_set1_ps(valY);
+  const __m256i voff = _mm256_set1_epi32(offset);
+  alignas(32) int idx[8];
+  alignas(32) float acc[8];
+  for(size_t k = 0; k + 8 <= WIDTH; k += 8) {
+    __m256i vidx = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(row_w + k)), voff);
+    __m256 vacc = _mm256_i32gather_ps(results, vidx, sizeof(float));
+    vacc = _mm256_fmadd_ps(vy, _mm256_loadu_ps(val_w + k), vacc);
+    _mm256_store_si256((__m256i*)idx, vidx);
+    _mm256_store_ps(acc, vacc);
+    for(int l = 0; l < 8; ++l) {
+      results[idx[l]] = acc[l];
+    }
+  }
+  scatter_scalar<float>(valY, row_w, val_w, WIDTH - WIDTH % 8, WIDTH, offset, results);
+}
+
+template <size_t WIDTH>
+__attribute__((target("avx2,fma")))
+void fixed_scatter_avx2(
+  const double valY,
+  const int* row_w,
+  const double* val_w,
+  const int offset,
+  double* results
+) {
+  const __m256d vy = _mm256_set1_pd(valY);
+  const __m128i voff = _mm_set1_epi32(offset);
+  alignas(16) int idx[4];
+  alignas(32) double acc[4];
+  for(size_t k = 0; k + 4 <= WIDTH; k += 4) {
+    __m128i vidx = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(row_w + k)), voff);
+    __m256d vacc = _mm256_i32gather_pd(results, vidx, sizeof(double));
+    vacc = _mm256_fmadd_pd(vy, _mm256_loadu_pd(val_w + k), vacc);
+    _mm_store_si128((__m128i*)idx, vidx);
+    _mm256_store_pd(acc, vacc);
+    for(int l = 0; l < 4; ++l) {
+      results[idx[l]] = acc[l];
+    }
+  }
+  scatter_scalar<double>(valY, row_w, val_w, WIDTH - WIDTH % 4, WIDTH, offset, results);
+}
+
+template <size_t WIDTH>
+__attribute__((target("avx512f")))
+void fixed_scatter_avx512(
+  const float valY,
+  const int* row_w,
+  const float* val_w,
+  const int offset,
+  float* results
+) {
+  const __m512 vy = _mm512_set1_ps(valY);
+  const __m512i voff = _mm512_set1_epi32(offset);
+  for(size_t k = 0; k + 16 <= WIDTH; k += 16) {
+    __m512i vidx = _mm512_sub_epi32(_mm512_loadu_si512(row_w + k), voff);
+    __m512 vacc = _mm512_i32gather_ps(vidx, results, sizeof(float));
+    vacc = _mm512_fmadd_ps(vy, _mm512_loadu_ps(val_w + k), vacc);
+    _mm512_i32scatter_ps(results, vidx, vacc, sizeof(float));
+  }
+  if(WIDTH % 16 != 0) {
+    scatter_avx512(valY, row_w, val_w, WIDTH - WIDTH % 16, WIDTH, offset, results);
+  }
+}
+
+template <size_t WIDTH>
+__attribute__((target("avx512f")))
+void fixed_scatter_avx512(
+  const double valY,
+  const int* row_w,
+  const double* val_w,
+  const int offset,
+  double* results
+) {
+  const __m512d vy = _mm512_set1_pd(valY);
+  const __m256i voff = _mm256_set1_epi32(offset);
+  for(size_t k = 0; k + 8 <= WIDTH; k += 8) {
+    __m256i vidx = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(row_w + k)), voff);
+    __m512d vacc = _mm512_i32gather_pd(vidx, results, sizeof(double));
+    vacc = _mm512_fmadd_pd(vy, _mm512_loadu_pd(val_w + k), vacc);
+    _mm512_i32scatter_pd(results, vidx, vacc, sizeof(double));
+  }
+  if(WIDTH % 8 != 0) {
+    scatter_avx512(valY, row_w, val_w, WIDTH - WIDTH % 8, WIDTH, offset, results);
+  }
+}
+
+#endif
+
+template <typename T>
+scatter_t<T> get_scatter(const ISA isa) {
+#ifdef SNIG_X86_SIMD
+  switch(isa) {
+    case ISA::AVX512:
+      return static_cast<scatter_t<T> >(&scatter_avx512);
+    case ISA::AVX2:
+      return static_cast<scatter_t<T> >(&scatter_avx2);
+    default:
+      break;
+  }
+#endif
+  return &scatter_scalar<T>;
+}
+
+template <typename T, size_t WIDTH>
+fixed_scatter_t<T> get_fixed_scatter(const ISA isa) {
+#ifdef SNIG_X86_SIMD
+  switch(isa) {
+    case ISA::AVX512:
+      return static_cast<fixed_scatter_t<T> >(&fixed_scatter_avx512<WIDTH>);
+    case ISA::AVX2:
+      return static_cast<fixed_scatter_t<T> >(&fixed_scatter_avx2<WIDTH>);
+    default:
+      break;
+  }
+#endif
+  return &fixed_scatter_scalar<T, WIDTH>;
+}
+
+template <typename T>
+fixed_scatter_t<T> get_fixed_scatter(const size_t width, const ISA isa) {
+  using namespace std::literals::string_literals;
+
+  //the converter rounds ELL widths up to powers of two
+  switch(width) {
+    case 1:   return get_fixed_scatter<T, 1>(isa);
+    case 2:   return get_fixed_scatter<T, 2>(isa);
+    case 4:   return get_fixed_scatter<T, 4>(isa);
+    case 8:   return get_fixed_scatter<T, 8>(isa);
+    case 16:  return get_fixed_scatter<T, 16>(isa);
+    case 32:  return get_fixed_scatter<T, 32>(isa);
+    case 64:  return get_fixed_scatter<T, 64>(isa);
+    case 128: return get_fixed_scatter<T, 128>(isa);
+    case 256: return get_fixed_scatter<T, 256>(isa);
+    default:
+      throw std::runtime_error("No fixed-width scatter for ELL width "s + std::to_string(width));
+  }
+}
+
+}// end of namespace snig ----------------------------------------------
@@ -8,7 +8,7 @@
 
 // use the same kernel as SNIG
 #include <SNIG/snig/kernel.hpp>
-#include <SNIG/base/base.hpp>
+#include <SNIG/base/gpu_base.hpp>
 #include <vector>
 #include <queue>
 #include <mutex>
@@ -22,7 +22,7 @@ namespace snig{
 
 
 template <typename T>
-class GPipe : public Base<T> {
+class GPipe : public GPUBase<T> {
 
   static_assert(
     std::is_same<T, float>::value || std::is_same<T, double>::value || std::is_same<T, half>::value,
@@ -40,8 +40,8 @@ class GPipe : public Base<T> {
     //record weight to delete
     std::vector<int*> _dev_record_W;
 
-    //partition num_layers evenly to each GPU
-    size_t _num_layers_per_gpu;
+    //GPU dev runs layers [_dev_layers[dev], _dev_layers[dev + 1])
+    std::vector<size_t> _dev_layers;
 
     size_t _batch_ylen;
     size_t _batch_ysize;
@@ -96,7 +96,7 @@ GPipe<T>::GPipe(
   const size_t num_neurons_per_layer,
   const size_t num_layers
 ):
-  Base<T>(threads, weight_path, bias, num_neurons_per_layer, num_layers)
+  GPUBase<T>(threads, weight_path, bias, num_neurons_per_layer, num_layers)
 {
   Base<T>::log("Constructing GPipe......", "\n");
 }
@@ -143,13 +143,31 @@ void GPipe<T>::_set_parameters(
   const size_t batch_size,
   const size_t num_gpus
 ) {
+  using namespace std::literals::string_literals;
+
   Base<T>::log("Using ", num_gpus, " GPUs", "\n");
   Base<T>::log("Total input size : ", num_inputs, "\n");
   Base<T>::log("Input batch size : ", batch_size, "\n\n");
 
+  //the pipeline only hands out full batches
+  if(num_inputs % batch_size != 0) {
+    throw std::runtime_error("GPipe needs an input batch size dividing the number of inputs"s);
+  }
+
+  if(num_gpus == 0 || num_gpus > Base<T>::_num_layers) {
+    throw std::runtime_error("GPipe needs at least one layer per GPU"s);
+  }
+
   Base<T>::_num_inputs = num_inputs;
   Base<T>::_num_gpus = num_gpus;
-  _num_layers_per_gpu = Base<T>::_num_layers / Base<T>::_num_gpus;
+
+  //the first _num_layers % num_gpus GPUs take one more layer, thus no layer is dropped
+  _dev_layers.assign(1, 0);
+  for(size_t dev = 0; dev < num_gpus; ++dev) {
+    _dev_layers.push_back(
+      _dev_layers.back() + Base<T>::_num_layers / num_gpus + (dev < Base<T>::_num_layers % num_gpus)
+    );
+  }
 
   _batch_size = batch_size;
   _batch_ylen = _batch_size * Base<T>::_num_neurons;
@@ -188,10 +206,13 @@ void GPipe<T>::_infer() {
 
   for(size_t dev = 0; dev < Base<T>::_num_gpus; ++dev) {
     cudaSetDevice(dev);
+    //layers of a device are contiguous in the packed weight
+    const PackedLayer& first = Base<T>::_layers[_dev_layers[dev]];
+    const PackedLayer& last = Base<T>::_layers[_dev_layers[dev + 1] - 1];
     checkCuda(cudaMemcpy(
       _dev_record_W[dev],
-      Base<T>::_host_pinned_weight + dev * _num_layers_per_gpu * Base<T>::_pp_wlen,
-      Base<T>::_pp_wsize * _num_layers_per_gpu,
+      Base<T>::_host_weight + first.offset,
+      sizeof(int) * (last.offset + last.length - first.offset),
       cudaMemcpyHostToDevice
     ));
   }
@@ -255,14 +276,34 @@ void GPipe<T>::_infer() {
       _dev_is_nonzero_row[dev][0] = _source_is_nonzero_row + beg_inputs * Base<T>::_num_secs;
       dev_results[dev] = _results + beg_inputs;
 
-      for(size_t cur_layer = dev * _num_layers_per_gpu; cur_layer < (dev + 1) * _num_layers_per_gpu; ++cur_layer) {
+      for(size_t cur_layer = _dev_layers[dev]; cur_layer < _dev_layers[dev + 1]; ++cur_layer) {
+        //the batch arrives in _dev_Y[dev][0], buffers alternate from the first layer of the device
+        const size_t cur = (cur_layer - _dev_layers[dev]) % 2;
         int* roffw = _dev_W[cur_layer];
         int* colsw = _dev_W[cur_layer] + Base<T>::_num_neurons * Base<T>::_num_secs + 1;
-        T* valsw = (T*)(_dev_W[cur_layer] + Base<T>::_p_w_index_len);
+        T* valsw = (T*)(_dev_W[cur_layer] + Base<T>::_layers[cur_layer].index_len);
+
+        //the last layer of the pipeline writes categories straight into the results, which start at 0
+        if(cur_layer + 1 == Base<T>::_num_layers) {
+          snig_identify_inference<T><<<grid_dim, GPUBase<T>::_threads, sizeof(T) * Base<T>::_sec_size, infer_stream>>>(
+            _dev_Y[dev][cur],
+            _dev_is_nonzero_row[dev][cur],
+            Base<T>::_sec_size,
+            Base<T>::_num_secs,
+            Base<T>::_num_neurons,
+            roffw,
+            colsw,
+            valsw,
+            Base<T>::_bias,
+            dev_results[dev]
+          );
+          checkCuda(cudaStreamSynchronize(infer_stream));
+          continue;
+        }
 
-        snig_inference<T><<<grid_dim, Base<T>::_threads, sizeof(T) * Base<T>::_sec_size, infer_stream>>>(
-          _dev_Y[dev][cur_layer % 2],
-          _dev_is_nonzero_row[dev][cur_layer % 2],
+        snig_inference<T><<<grid_dim, GPUBase<T>::_threads, sizeof(T) * Base<T>::_sec_size, infer_stream>>>(
+          _dev_Y[dev][cur],
+          _dev_is_nonzero_row[dev][cur],
           Base<T>::_sec_size,
           Base<T>::_num_secs,
           Base<T>::_num_neurons,
@@ -270,11 +311,26 @@ void GPipe<T>::_infer() {
           colsw,
           valsw,
           Base<T>::_bias,
-          _dev_is_nonzero_row[dev][(cur_layer + 1) % 2],
-          _dev_Y[dev][(cur_layer + 1) % 2]
+          _dev_is_nonzero_row[dev][1 - cur],
+          _dev_Y[dev][1 - cur]
         );
         checkCuda(cudaStreamSynchronize(infer_stream));
       }
+      //an odd number of layers leaves the batch in the buffer of this device,
+      //while the next device reads it from the source
+      if(dev != Base<T>::_num_gpus - 1 && (_dev_layers[dev + 1] - _dev_layers[dev]) % 2 == 1) {
+        checkCuda(cudaMemcpyAsync(
+          _dev_Y[dev][0], _dev_Y[dev][1], _batch_ysize, cudaMemcpyDeviceToDevice, infer_stream
+        ));
+        checkCuda(cudaMemcpyAsync(
+          _dev_is_nonzero_row[dev][0],
+          _dev_is_nonzero_row[dev][1],
+          sizeof(bool) * _batch_size * Base<T>::_num_secs,
+          cudaMemcpyDeviceToDevice,
+          infer_stream
+        ));
+        checkCuda(cudaStreamSynchronize(infer_stream));
+      }
       if(dev != Base<T>::_num_gpus - 1) {
         //notify next device to infer
         {
@@ -283,11 +339,6 @@ void GPipe<T>::_infer() {
         }
         dev_que_cv[dev + 1].notify_one();
       }
-      else {
-        //last device identify
-        identify<T><<<16, 512, 0, infer_stream>>>(_dev_Y[dev][0], _batch_size, Base<T>::_num_neurons, dev_results[dev]);
-        checkCuda(cudaStreamSynchronize(infer_stream));
-      }
     }
   }
 
@@ -301,15 +352,17 @@ template <typename T>
 void GPipe<T>::_weight_alloc() {
   for(size_t dev = 0; dev < Base<T>::_num_gpus; ++dev) {
     cudaSetDevice(dev);
+    const PackedLayer& first = Base<T>::_layers[_dev_layers[dev]];
+    const PackedLayer& last = Base<T>::_layers[_dev_layers[dev + 1] - 1];
     int* W;
     checkCuda(cudaMallocManaged(
       &W,
-      Base<T>::_pp_wsize * _num_layers_per_gpu
+      sizeof(int) * (last.offset + last.length - first.offset)
     ));
     _dev_record_W.emplace_back(W);
-    for(size_t cur_layer = 0; cur_layer < _num_layers_per_gpu; ++cur_layer) {
+    for(size_t cur_layer = _dev_layers[dev]; cur_layer < _dev_layers[dev + 1]; ++cur_layer) {
       //record location of weight of each layer
-      _dev_W.emplace_back(W + cur_layer * Base<T>::_pp_wlen);
+      _dev_W.emplace_back(W + (Base<T>::_layers[cur_layer].offset - first.offset));
     }
   }
   cudaSetDevice(0);
@@ -18,6 +18,25 @@ void snig_inference(
   T* Y_1
 );
 
+//last layer of snig_inference fused with identify
+//outputs are not written, a block sets result_arr[r] to 1 once one output of its section is positive,
+//thus result_arr must be 0 before the launch
+//blocks of a row whose category is already known return at once
+template <typename T>
+__global__ 
+void snig_identify_inference(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const size_t sec_size,
+  const size_t num_sec,
+  const size_t num_neurons,
+  const int* col_w,
+  const int* row_w,
+  const T* val_w,
+  const T bias,
+  int* result_arr
+);
+
 //-----------------------------------------------------------------------------
 //Definition of kernel function
 //-----------------------------------------------------------------------------
@@ -114,4 +133,90 @@ void snig_inference(
   }
 }
 
+template <typename T>
+__global__ 
+void snig_identify_inference(
+  const T* Y_0,
+  const bool* is_nonzero_row_0,
+  const size_t sec_size,
+  const size_t num_secs,
+  const size_t num_neurons,
+  const int* col_w,
+  const int* row_w,
+  const T* val_w,
+  const T bias,
+  int* result_arr
+) {
+  int tid = threadIdx.y * blockDim.x + threadIdx.x;
+  //r = blockIdx.x
+  //s_o = blockIdx.y
+  int num_threads = blockDim.x * blockDim.y;
+
+  //early exit, another section of this row already has a positive output
+  //other blocks of this row write result_arr concurrently,
+  //thus thread 0 reads it once and the whole block leaves together
+  __shared__ bool is_identified;
+  if(tid == 0) {
+    is_identified = (result_arr[blockIdx.x] != 0);
+  }
+  __syncthreads();
+  if(is_identified) {
+    return;
+  }
+
+  bool is_all_zero = true;
+  for(size_t s_i = 0; s_i < num_secs; ++s_i) {
+    is_all_zero &= !is_nonzero_row_0[blockIdx.x * num_secs + s_i];
+  }
+
+  //an all-zero row stays all zero, its category is 0
+  if(is_all_zero) {
+    return;
+  }
+
+  extern __shared__ T results[];
+
+  for(size_t k = tid; k < sec_size; k += num_threads) {
+    results[k] = bias;  
+  }
+
+  __shared__ bool is_nonzero;
+  if(tid == 0) {
+    is_nonzero = false;
+  }
+  __syncthreads();
+
+  for(size_t s_i = 0; s_i < num_secs; ++s_i) {
+    if(!is_nonzero_row_0[blockIdx.x * num_secs + s_i]) {
+      continue;
+    }
+    for(size_t j = threadIdx.y + s_i * sec_size; j < (s_i + 1) * sec_size; j += blockDim.y) {
+      T valY = Y_0[blockIdx.x * num_neurons + j];
+      if(valY == 0) {
+        continue;
+      }
+      int beg_w = col_w[blockIdx.y * num_neurons + j] + threadIdx.x;
+      int end_w = col_w[blockIdx.y * num_neurons + j + 1];
+      for(int k = beg_w; k < end_w; k += blockDim.x) {
+        int roww = row_w[k];
+        T valw = val_w[k];
+        atomicAdd(&results[roww - blockIdx.y * sec_size], valY * valw);
+      }
+    }
+  }
+  __syncthreads();
+
+  //an output survives ReLU/clip exactly when it is positive
+  for(size_t i = tid; i < sec_size; i += num_threads) {
+    if(results[i] > T(0)) {
+      is_nonzero = true;
+    }
+  }
+
+  __syncthreads();
+  if(tid == 0 && is_nonzero) {
+    result_arr[blockIdx.x] = 1;
+  }
+}
+
 }// end of namespace snig ----------------------------------------------
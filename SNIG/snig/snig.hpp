@@ -3,12 +3,14 @@
 #include <Eigen/Core>
 #include <taskflow/taskflow.hpp>
 #include <SNIG/utility/reader.hpp>
+#include <SNIG/utility/input_stream.hpp>
 #include <SNIG/utility/matrix_format.h>
 #include <SNIG/utility/cuda_error.hpp>
 #include <SNIG/snig/kernel.hpp>
 #include <SNIG/utility/scoring.hpp>
-#include <SNIG/base/base.hpp>
+#include <SNIG/base/gpu_base.hpp>
 #include <vector>
+#include <memory>
 
 namespace std {
   namespace fs = experimental::filesystem;  
@@ -17,7 +19,7 @@ namespace std {
 namespace snig{
 
 template <typename T>
-class SNIG : public Base<T> {
+class SNIG : public GPUBase<T> {
 
   static_assert(
     std::is_same<T, float>::value || std::is_same<T, double>::value,
@@ -28,8 +30,13 @@ class SNIG : public Base<T> {
     
     size_t _batch_size;
     size_t _num_weight_buffers;
-    T* _source_Y;
-    bool* _source_is_nonzero_row;
+
+    //inputs are streamed through a pinned ring of two batches per GPU,
+    //a fetched batch is copied to _dev_Y[dev][0] and its ring buffer is released at once
+    std::unique_ptr<InputStream<T> > _input_stream;
+    std::vector<T*> _ring_Y;
+    std::vector<bool*> _ring_is_nonzero_row;
+
     std::vector<std::vector<T*> > _dev_Y;
     std::vector<std::vector<bool*> > _dev_is_nonzero_row;
     std::vector<std::vector<int*> > _dev_W;
@@ -89,7 +96,7 @@ SNIG<T>::SNIG(
   const size_t num_neurons_per_layer,
   const size_t num_layers
 ):
-  Base<T>(threads, weight_path, bias, num_neurons_per_layer, num_layers)
+  GPUBase<T>(threads, weight_path, bias, num_neurons_per_layer, num_layers)
 {
   Base<T>::log("Constructing SNIG engine......", "\n");
 }
@@ -97,8 +104,14 @@ SNIG<T>::SNIG(
 template <typename T>
 SNIG<T>::~SNIG() {
 
-  checkCuda(cudaFree(_source_Y));
-  checkCuda(cudaFree(_source_is_nonzero_row));
+  //stop the I/O thread before freeing its buffers
+  _input_stream.reset();
+  for(auto& Y_in_ring : _ring_Y) {
+    checkCuda(cudaFreeHost(Y_in_ring));
+  }
+  for(auto& rowsY_in_ring : _ring_is_nonzero_row) {
+    checkCuda(cudaFreeHost(rowsY_in_ring));
+  }
 
   for(auto& W_in_dev : _dev_W) {
     for(auto& each_W : W_in_dev) {
@@ -106,9 +119,11 @@ SNIG<T>::~SNIG() {
     }
   }
   for(auto& Y_in_dev : _dev_Y) {
+      checkCuda(cudaFree(Y_in_dev[0]));
       checkCuda(cudaFree(Y_in_dev[1]));
   }
   for(auto& rowsY_in_dev : _dev_is_nonzero_row) {
+      checkCuda(cudaFree(rowsY_in_dev[0]));
       checkCuda(cudaFree(rowsY_in_dev[1]));
   }
 
@@ -175,8 +190,16 @@ void SNIG<T>::_preprocess(const std::fs::path& input_path) {
   //final results allocation
   _result_alloc();
   
-  //read input
-  read_input_binary<T>(input_path, _source_Y);
+  //start reading input, batches are consumed by GPUs while later ones are read
+  _input_stream = std::make_unique<InputStream<T> >(
+    input_path,
+    Base<T>::_num_inputs,
+    Base<T>::_num_neurons,
+    Base<T>::_sec_size,
+    _batch_size,
+    _ring_Y,
+    _ring_is_nonzero_row
+  );
 
   Base<T>::toc();
   Base<T>::log("Finish preprocessing with ", Base<T>::duration(), " ms", "\n");
@@ -197,9 +220,46 @@ void SNIG<T>::_infer() {
   cudaflows.reserve(Base<T>::_num_gpus);
   fetchs.reserve(Base<T>::_num_gpus);
 
-  std::atomic<size_t> finished_inputs{0};
   std::vector<int*> dev_results(Base<T>::_num_gpus, nullptr);
 
+  auto fetch = [&](const size_t dev) {
+    cudaSetDevice(dev);
+    typename InputStream<T>::Batch batch;
+    if(!_input_stream->acquire(batch)) {
+      return 1;
+    }
+    dev_results[dev] = _results + batch.beg;
+    checkCuda(cudaMemcpy(
+      _dev_Y[dev][0],
+      batch.Y,
+      sizeof(T) * batch.rows * Base<T>::_num_neurons,
+      cudaMemcpyHostToDevice
+    ));
+    checkCuda(cudaMemcpy(
+      _dev_is_nonzero_row[dev][0],
+      batch.is_nonzero_row,
+      sizeof(bool) * batch.rows * Base<T>::_num_secs,
+      cudaMemcpyHostToDevice
+    ));
+    //kernels always run _batch_size rows, rows past a short last batch stay zero
+    //and identify into the padding of _results
+    if(batch.rows < _batch_size) {
+      checkCuda(cudaMemset(
+        _dev_Y[dev][0] + batch.rows * Base<T>::_num_neurons,
+        0,
+        sizeof(T) * (_batch_size - batch.rows) * Base<T>::_num_neurons
+      ));
+      checkCuda(cudaMemset(
+        _dev_is_nonzero_row[dev][0] + batch.rows * Base<T>::_num_secs,
+        0,
+        sizeof(bool) * (_batch_size - batch.rows) * Base<T>::_num_secs
+      ));
+    }
+    _input_stream->release(batch);
+    checkCuda(cudaMemPrefetchAsync(dev_results[dev], sizeof(int) * _batch_size, dev, NULL));
+    return 0;
+  };
+
   dim3 grid_dim(_batch_size, Base<T>::_num_secs, 1);
 
   tf::Task start = taskflow.emplace([](){
@@ -207,19 +267,7 @@ void SNIG<T>::_infer() {
 
   for(size_t dev = 0; dev < Base<T>::_num_gpus; ++dev) {
     first_fetchs.emplace_back(taskflow.emplace([&, dev](){
-      cudaSetDevice(dev);
-      int is_end = 1;
-      size_t beg_inputs = finished_inputs.fetch_add(_batch_size);
-      if(beg_inputs < Base<T>::_num_inputs) {
-        _dev_Y[dev][0] = _source_Y + beg_inputs * Base<T>::_num_neurons;
-        _dev_is_nonzero_row[dev][0] = _source_is_nonzero_row + beg_inputs * Base<T>::_num_secs;
-        dev_results[dev] = _results + beg_inputs;
-        checkCuda(cudaMemPrefetchAsync(_dev_Y[dev][0], _batch_ysize, dev, NULL));
-        checkCuda(cudaMemPrefetchAsync(_dev_is_nonzero_row[dev][0], sizeof(bool) * _batch_size * Base<T>::_num_secs, dev, NULL));
-        checkCuda(cudaMemPrefetchAsync(dev_results[dev], sizeof(int) * _batch_size, dev, NULL));
-        is_end = 0;
-      }
-      return is_end;
+      return fetch(dev);
     }).name("first_fetch"));
 
     cudaflows.emplace_back(taskflow.emplace([&, dev](tf::cudaFlow& cf){
@@ -234,17 +282,39 @@ void SNIG<T>::_infer() {
           //tasks of cudaflow
           weight_copies.emplace_back(cf.copy(
             _dev_W[dev][k],
-            Base<T>::_host_pinned_weight + (cur_layer + k) * Base<T>::_pp_wlen,
-            Base<T>::_pp_wlen
+            Base<T>::_host_weight + Base<T>::_layers[cur_layer + k].offset,
+            Base<T>::_layers[cur_layer + k].length
           ).name("weight_copy"));
 
           // transformed CSC weight matrix equals to CSR with exchanged row and col
           int* col_w = _dev_W[dev][k];
           int* row_w = _dev_W[dev][k] + Base<T>::_num_neurons * Base<T>::_num_secs + 1;
-          T* val_w = (T*)(_dev_W[dev][k] + Base<T>::_p_w_index_len);
+          T* val_w = (T*)(_dev_W[dev][k] + Base<T>::_layers[cur_layer + k].index_len);
+
+          //the last layer writes categories straight into the results, which start at 0
+          if(cur_layer + k + 1 == Base<T>::_num_layers) {
+            infers.emplace_back(cf.kernel(
+              grid_dim,
+              GPUBase<T>::_threads,
+              sizeof(T) * Base<T>::_sec_size,
+              snig_identify_inference<T>,
+              _dev_Y[dev][k % 2],
+              _dev_is_nonzero_row[dev][k % 2],
+              Base<T>::_sec_size,
+              Base<T>::_num_secs,
+              Base<T>::_num_neurons,
+              col_w,
+              row_w,
+              val_w,
+              Base<T>::_bias,
+              dev_results[dev]
+            ).name("Inference"));
+            continue;
+          }
+
           infers.emplace_back(cf.kernel(
             grid_dim,
-            Base<T>::_threads,
+            GPUBase<T>::_threads,
             sizeof(T) * Base<T>::_sec_size,
             snig_inference<T>,
             _dev_Y[dev][k % 2],
@@ -262,9 +332,6 @@ void SNIG<T>::_infer() {
         }
       }
 
-      // TODO: consider parameterizing the thread numbers
-      tf::cudaTask ident = cf.kernel(16, 512, 0, identify<T>, _dev_Y[dev][0], _batch_size, Base<T>::_num_neurons, dev_results[dev]);
-
       //dependencies of cudaflow
       for(size_t cur_layer = 0; cur_layer < Base<T>::_num_layers; ++cur_layer) {
         weight_copies[cur_layer].precede(infers[cur_layer]);
@@ -276,23 +343,10 @@ void SNIG<T>::_infer() {
           infers[cur_layer].precede(infers[cur_layer + 1]);
         }
       }
-      infers[Base<T>::_num_layers - 1].precede(ident);
     }).name("GPU"));
 
     fetchs.emplace_back(taskflow.emplace([&, dev](){
-      cudaSetDevice(dev);
-      int is_end = 1;
-      size_t beg_inputs = finished_inputs.fetch_add(_batch_size);
-      if(beg_inputs < Base<T>::_num_inputs) {
-        _dev_Y[dev][0] = _source_Y + beg_inputs * Base<T>::_num_neurons;
-        _dev_is_nonzero_row[dev][0] = _source_is_nonzero_row + beg_inputs * Base<T>::_num_secs;
-        dev_results[dev] = _results + beg_inputs;
-        checkCuda(cudaMemPrefetchAsync(_dev_Y[dev][0], _batch_ysize, dev, NULL));
-        checkCuda(cudaMemPrefetchAsync(_dev_is_nonzero_row[dev][0], sizeof(bool) * _batch_size * Base<T>::_num_secs, dev, NULL));
-        checkCuda(cudaMemPrefetchAsync(dev_results[dev], sizeof(int) * _batch_size, dev, NULL));
-        is_end = 0;
-      }
-      return is_end;
+      return fetch(dev);
     }).name("fetch"));
 
   }
@@ -308,6 +362,7 @@ void SNIG<T>::_infer() {
   }
   
   executor.run(taskflow).wait();
+  _input_stream.reset();
 
   checkCuda(cudaSetDevice(0));
 
@@ -334,17 +389,22 @@ void SNIG<T>::_weight_alloc() {
 
 template <typename T>
 void SNIG<T>::_input_alloc() {
-  size_t ylen = Base<T>::_num_inputs *  Base<T>::_num_neurons;
-  size_t ysize = ylen * sizeof(T);
-
-  checkCuda(cudaMallocManaged(&_source_Y, ysize));
-  checkCuda(cudaMallocManaged(&_source_is_nonzero_row, sizeof(bool) * Base<T>::_num_inputs * Base<T>::_num_secs));
-  checkCuda(cudaMemset(_source_is_nonzero_row, 1, sizeof(bool) * Base<T>::_num_inputs * Base<T>::_num_secs));
+  //double buffering for every GPU, pinned for fast copies
+  for(size_t i = 0; i < 2 * Base<T>::_num_gpus; ++i) {
+    T* Y_in_ring;
+    bool* rowsY_in_ring;
+    checkCuda(cudaMallocHost(&Y_in_ring, _batch_ysize));
+    checkCuda(cudaMallocHost(&rowsY_in_ring, sizeof(bool) * _batch_size * Base<T>::_num_secs));
+    _ring_Y.push_back(Y_in_ring);
+    _ring_is_nonzero_row.push_back(rowsY_in_ring);
+  }
 
   std::vector<T*> Y{2, nullptr};
   std::vector<bool*> is_nonzero_row{2, nullptr};
   for(size_t dev = 0; dev < Base<T>::_num_gpus; ++dev) {
     cudaSetDevice(dev);
+    checkCuda(cudaMalloc(&Y[0], _batch_ysize));
+    checkCuda(cudaMalloc(&is_nonzero_row[0], sizeof(bool) * _batch_size * Base<T>::_num_secs));
     checkCuda(cudaMalloc(&Y[1], _batch_ysize));
     checkCuda(cudaMalloc(&is_nonzero_row[1], sizeof(bool) * _batch_size * Base<T>::_num_secs));
     checkCuda(cudaMemset(Y[1], 0, _batch_ysize));
@@ -357,8 +417,10 @@ void SNIG<T>::_input_alloc() {
 
 template <typename T>
 void SNIG<T>::_result_alloc() {
-  checkCuda(cudaMallocManaged(&_results, sizeof(int) * Base<T>::_num_inputs));
-  checkCuda(cudaMemset(_results, 0, sizeof(int) * Base<T>::_num_inputs));
+  //padded to whole batches, thus the number of inputs needs not be a multiple of _batch_size
+  const size_t num_results = (Base<T>::_num_inputs + _batch_size - 1) / _batch_size * _batch_size;
+  checkCuda(cudaMallocManaged(&_results, sizeof(int) * num_results));
+  checkCuda(cudaMemset(_results, 0, sizeof(int) * num_results));
 }
 
 }// end of namespace snig ----------------------------------------------
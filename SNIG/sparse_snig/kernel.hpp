@@ -0,0 +1,202 @@
+#pragma once
+#include <algorithm>
+#include <SNIG/utility/matrix_format.h>
+
+namespace snig{
+
+//keep the nonzeros of num_rows dense rows
+template <typename T>
+void cpu_dense_to_sparse(
+  const T* Y,
+  const size_t num_rows,
+  const size_t num_neurons,
+  SparseRows<T>& rows
+);
+
+//one layer of sparse rows times a layer with a single section (CSC by input neuron)
+//symbolic phase bounds the nonzeros of every output row by the neurons it touches,
+//numeric phase accumulates touched neurons only and keeps those left nonzero
+//accumulator (num_neurons), touched (num_neurons), and is_touched (num_neurons, all false)
+//are scratch owned by the calling worker, is_touched is all false again on return
+//val_w == nullptr marks a uniform layer whose weights all equal w_value
+template <typename T>
+void cpu_sparse_inference(
+  const SparseRows<T>& Y_0,
+  const int* col_w,
+  const int* row_w,
+  const T* val_w,
+  const T w_value,
+  const T bias,
+  SparseRows<T>& Y_1,
+  T* accumulator,
+  int* touched,
+  bool* is_touched
+);
+
+//last layer of cpu_sparse_inference fused with the category of every row,
+//outputs are only tested, thus neither the symbolic phase nor the output rows are needed
+template <typename T>
+void cpu_sparse_identify_inference(
+  const SparseRows<T>& Y_0,
+  const int* col_w,
+  const int* row_w,
+  const T* val_w,
+  const T w_value,
+  const T bias,
+  int* result_arr,
+  T* accumulator,
+  int* touched,
+  bool* is_touched
+);
+
+//-----------------------------------------------------------------------------
+//Definition of kernel function
+//-----------------------------------------------------------------------------
+
+template <typename T>
+void cpu_dense_to_sparse(
+  const T* Y,
+  const size_t num_rows,
+  const size_t num_neurons,
+  SparseRows<T>& rows
+) {
+  rows.row_array.resize(num_rows + 1);
+  rows.col_array.clear();
+  rows.data_array.clear();
+
+  rows.row_array[0] = 0;
+  for(size_t r = 0; r < num_rows; ++r) {
+    for(size_t j = 0; j < num_neurons; ++j) {
+      if(Y[r * num_neurons + j] != 0) {
+        rows.col_array.push_back(j);
+        rows.data_array.push_back(Y[r * num_neurons + j]);
+      }
+    }
+    rows.row_array[r + 1] = rows.col_array.size();
+  }
+}
+
+template <typename T>
+void cpu_sparse_inference(
+  const SparseRows<T>& Y_0,
+  const int* col_w,
+  const int* row_w,
+  const T* val_w,
+  const T w_value,
+  const T bias,
+  SparseRows<T>& Y_1,
+  T* accumulator,
+  int* touched,
+  bool* is_touched
+) {
+  const size_t num_rows = Y_0.row_array.size() - 1;
+
+  //symbolic phase
+  //every row of Y_1 has at most as many nonzeros as neurons its inputs reach
+  size_t bound{0};
+  for(size_t r = 0; r < num_rows; ++r) {
+    size_t num_touched{0};
+    for(size_t e = Y_0.row_array[r]; e < Y_0.row_array[r + 1]; ++e) {
+      const int j = Y_0.col_array[e];
+      for(int k = col_w[j]; k < col_w[j + 1]; ++k) {
+        if(!is_touched[row_w[k]]) {
+          is_touched[row_w[k]] = true;
+          touched[num_touched++] = row_w[k];
+        }
+      }
+    }
+    for(size_t t = 0; t < num_touched; ++t) {
+      is_touched[touched[t]] = false;
+    }
+    bound += num_touched;
+  }
+
+  Y_1.row_array.resize(num_rows + 1);
+  Y_1.col_array.resize(bound);
+  Y_1.data_array.resize(bound);
+
+  //numeric phase
+  //rows are compacted as they are written, thus a row never passes its bound
+  //inputs are visited in order, so every output is summed as the dense kernels sum it
+  size_t nnz{0};
+  Y_1.row_array[0] = 0;
+  for(size_t r = 0; r < num_rows; ++r) {
+    size_t num_touched{0};
+    for(size_t e = Y_0.row_array[r]; e < Y_0.row_array[r + 1]; ++e) {
+      const int j = Y_0.col_array[e];
+      const T valY = Y_0.data_array[e];
+      for(int k = col_w[j]; k < col_w[j + 1]; ++k) {
+        const int i = row_w[k];
+        if(!is_touched[i]) {
+          is_touched[i] = true;
+          touched[num_touched++] = i;
+          //uniform layers accumulate plain activations and multiply by w_value once
+          accumulator[i] = val_w == nullptr ? bias / w_value : bias;
+        }
+        accumulator[i] += val_w == nullptr ? valY : valY * val_w[k];
+      }
+    }
+
+    std::sort(touched, touched + num_touched);
+    for(size_t t = 0; t < num_touched; ++t) {
+      const int i = touched[t];
+      is_touched[i] = false;
+      T v = val_w == nullptr ? accumulator[i] * w_value : accumulator[i];
+      v = std::min(T(32), std::max(v, T(0)));
+      if(v != 0) {
+        Y_1.col_array[nnz] = i;
+        Y_1.data_array[nnz] = v;
+        ++nnz;
+      }
+    }
+    Y_1.row_array[r + 1] = nnz;
+  }
+
+  Y_1.col_array.resize(nnz);
+  Y_1.data_array.resize(nnz);
+}
+
+template <typename T>
+void cpu_sparse_identify_inference(
+  const SparseRows<T>& Y_0,
+  const int* col_w,
+  const int* row_w,
+  const T* val_w,
+  const T w_value,
+  const T bias,
+  int* result_arr,
+  T* accumulator,
+  int* touched,
+  bool* is_touched
+) {
+  const size_t num_rows = Y_0.row_array.size() - 1;
+
+  for(size_t r = 0; r < num_rows; ++r) {
+    size_t num_touched{0};
+    for(size_t e = Y_0.row_array[r]; e < Y_0.row_array[r + 1]; ++e) {
+      const int j = Y_0.col_array[e];
+      const T valY = Y_0.data_array[e];
+      for(int k = col_w[j]; k < col_w[j + 1]; ++k) {
+        const int i = row_w[k];
+        if(!is_touched[i]) {
+          is_touched[i] = true;
+          touched[num_touched++] = i;
+          accumulator[i] = val_w == nullptr ? bias / w_value : bias;
+        }
+        accumulator[i] += val_w == nullptr ? valY : valY * val_w[k];
+      }
+    }
+
+    //an output survives ReLU/clip exactly when its pre-activation is positive
+    int category{0};
+    for(size_t t = 0; t < num_touched; ++t) {
+      const int i = touched[t];
+      is_touched[i] = false;
+      const T v = val_w == nullptr ? accumulator[i] * w_value : accumulator[i];
+      category |= (v > 0);
+    }
+    result_arr[r] = category;
+  }
+}
+
+}// end of namespace snig ----------------------------------------------
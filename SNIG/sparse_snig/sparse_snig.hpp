@@ -0,0 +1,377 @@
+#pragma once
+
+#include <Eigen/Core>
+#include <taskflow/taskflow.hpp>
+#include <SNIG/utility/reader.hpp>
+#include <SNIG/utility/input_stream.hpp>
+#include <SNIG/utility/matrix_format.h>
+#include <SNIG/sparse_snig/kernel.hpp>
+#include <SNIG/base/base.hpp>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <memory>
+#include <chrono>
+
+namespace std {
+  namespace fs = experimental::filesystem;
+}
+
+namespace snig{
+
+template <typename T>
+class SparseSNIG : public Base<T> {
+
+  //CPUSNIG keeps activations of a batch as a dense batch_size x num_neurons array
+  //and clears it section by section between layers.
+  //Here activations between layers are sparse rows (SparseRows<T>),
+  //and every layer is a sparse x sparse product with a symbolic and a numeric phase,
+  //thus activation memory and traffic scale with the nonzeros instead of num_neurons.
+  //Weights are re-packed as a single section so every input neuron lists all its outputs.
+  //Untouched neurons stay zero, which needs a bias no larger than 0.
+
+  static_assert(
+    std::is_same<T, float>::value || std::is_same<T, double>::value,
+    "data type must be either float or double"
+  );
+
+  private:
+
+    size_t _batch_size;
+    size_t _min_batch_size;
+    size_t _num_threads;
+
+    //sizes batches from the time and live rows of finished ones
+    std::unique_ptr<BatchScheduler> _scheduler;
+
+    //inputs are streamed through a ring of two batches per lane,
+    //dense rows are only kept until they are converted into sparse rows
+    std::unique_ptr<InputStream<T> > _input_stream;
+    std::vector<T*> _ring_Y;
+    std::vector<bool*> _ring_is_nonzero_row;
+
+    //ping-pong sparse activations for each lane
+    std::vector<std::vector<SparseRows<T> > > _lane_Y;
+
+    //scratch of the sparse kernel for each lane
+    std::vector<std::unique_ptr<T[]> > _lane_accumulator;
+    std::vector<std::unique_ptr<int[]> > _lane_touched;
+    std::vector<std::unique_ptr<bool[]> > _lane_is_touched;
+
+    //largest number of nonzeros each lane held between two layers
+    std::vector<size_t> _lane_max_nnz;
+
+    int* _results{nullptr};
+
+    void _set_parameters(
+      const size_t num_inputs,
+      const size_t batch_size,
+      const size_t num_threads,
+      const size_t min_batch_size
+    );
+
+    void _preprocess(const std::fs::path& input_path);
+
+    void  _infer();
+
+    void _weight_alloc();
+
+    void _input_alloc();
+
+    void _result_alloc();
+
+  public:
+
+    SparseSNIG(
+      const std::fs::path& weight_path,
+      const T bias = -.3f,
+      const size_t num_neurons_per_layer = 1024,
+      const size_t num_layers = 120
+    );
+
+    ~SparseSNIG();
+
+    //batches have between min_batch_size and batch_size rows (see BatchScheduler)
+    Eigen::Matrix<int, Eigen::Dynamic, 1> infer(
+      const std::fs::path& input_path,
+      const size_t num_inputs,
+      const size_t batch_size,
+      const size_t num_threads,
+      const size_t min_batch_size = MIN_BATCH_SIZE
+    );
+
+};
+
+// ----------------------------------------------------------------------------
+// Definition of SparseSNIG
+// ----------------------------------------------------------------------------
+
+template <typename T>
+SparseSNIG<T>::SparseSNIG(
+  const std::fs::path& weight_path,
+  const T bias,
+  const size_t num_neurons_per_layer,
+  const size_t num_layers
+):
+  Base<T>(
+    weight_path,
+    bias,
+    num_neurons_per_layer,
+    num_layers,
+    num_neurons_per_layer,
+    //ELL weights of any width are accepted, they are re-packed below
+    WeightOptions{std::numeric_limits<size_t>::max(), true, true, true}
+  )
+{
+  using namespace std::literals::string_literals;
+
+  Base<T>::log("Constructing SparseSNIG engine......", "\n");
+
+  if(bias > 0) {
+    throw std::runtime_error("SparseSNIG needs a bias no larger than 0, untouched neurons would be nonzero"s);
+  }
+}
+
+template <typename T>
+SparseSNIG<T>::~SparseSNIG() {
+  //stop the I/O thread before freeing its buffers
+  _input_stream.reset();
+
+  for(auto& Y_in_ring : _ring_Y) {
+    delete[] Y_in_ring;
+  }
+  for(auto& rowsY_in_ring : _ring_is_nonzero_row) {
+    delete[] rowsY_in_ring;
+  }
+
+  delete[] _results;
+}
+
+template <typename T>
+Eigen::Matrix<int, Eigen::Dynamic, 1> SparseSNIG<T>::infer(
+  const std::fs::path& input_path,
+  const size_t num_inputs,
+  const size_t batch_size,
+  const size_t num_threads,
+  const size_t min_batch_size
+) {
+
+  _set_parameters(
+    num_inputs,
+    batch_size,
+    num_threads,
+    min_batch_size
+  );
+
+  Base<T>::log("Using ", _num_threads, " CPU threads", "\n");
+  Base<T>::log("Total input size : ", num_inputs, "\n");
+  Base<T>::log("Input batch size : ", std::min(_min_batch_size, batch_size), " to ", batch_size, "\n\n");
+
+  _preprocess(input_path);
+
+  _infer();
+
+  return arr_to_Eigen_int(_results, Base<T>::_num_inputs);
+}
+
+template <typename T>
+void SparseSNIG<T>::_set_parameters(
+  const size_t num_inputs,
+  const size_t batch_size,
+  const size_t num_threads,
+  const size_t min_batch_size
+) {
+  Base<T>::_num_inputs = num_inputs;
+  _num_threads = num_threads;
+  _batch_size = batch_size;
+  _min_batch_size = min_batch_size;
+
+  _lane_Y.reserve(_num_threads);
+  _lane_accumulator.reserve(_num_threads);
+  _lane_touched.reserve(_num_threads);
+  _lane_is_touched.reserve(_num_threads);
+  _lane_max_nnz.assign(_num_threads, 0);
+}
+
+template <typename T>
+void SparseSNIG<T>::_preprocess(const std::fs::path& input_path) {
+  Base<T>::log("Preprocessing...... ");
+  Base<T>::tic();
+
+  //weight allocation
+  _weight_alloc();
+  //input allocation
+  _input_alloc();
+  //final results allocation
+  _result_alloc();
+
+  //start reading input, batches are consumed by lanes while later ones are read
+  _scheduler = std::make_unique<BatchScheduler>(
+    Base<T>::_num_inputs,
+    _batch_size,
+    _min_batch_size,
+    _num_threads
+  );
+  _input_stream = std::make_unique<InputStream<T> >(
+    input_path,
+    Base<T>::_num_inputs,
+    Base<T>::_num_neurons,
+    Base<T>::_sec_size,
+    _batch_size,
+    _ring_Y,
+    _ring_is_nonzero_row,
+    _scheduler.get()
+  );
+
+  Base<T>::toc();
+  Base<T>::log("Finish preprocessing with ", Base<T>::duration(), " ms", "\n");
+}
+
+template <typename T>
+void SparseSNIG<T>::_infer() {
+  Base<T>::log("Start inference...... ", "\n");
+  Base<T>::tic();
+
+  //same task graph as CPUSNIG, each lane owns a batch at a time
+  tf::Taskflow taskflow("SparseSNIG");
+  tf::Executor executor(_num_threads);
+  std::vector<tf::Task> first_fetchs;
+  std::vector<tf::Task> infers;
+  std::vector<tf::Task> fetchs;
+  first_fetchs.reserve(_num_threads);
+  infers.reserve(_num_threads);
+  fetchs.reserve(_num_threads);
+
+  std::vector<typename InputStream<T>::Batch> lane_batch(_num_threads);
+
+  //sparse rows are built right after a batch is read, thus the ring slot is released at once
+  auto fetch = [&](const size_t lane) {
+    typename InputStream<T>::Batch& batch = lane_batch[lane];
+    if(!_input_stream->acquire(batch)) {
+      return 1;
+    }
+    cpu_dense_to_sparse<T>(batch.Y, batch.rows, Base<T>::_num_neurons, _lane_Y[lane][0]);
+    _input_stream->release(batch);
+    return 0;
+  };
+
+  tf::Task start = taskflow.emplace([](){
+  }).name("start");
+
+  for(size_t lane = 0; lane < _num_threads; ++lane) {
+    first_fetchs.emplace_back(taskflow.emplace([&, lane](){
+      return fetch(lane);
+    }).name("first_fetch"));
+
+    infers.emplace_back(taskflow.emplace([&, lane](){
+      const auto batch_beg = std::chrono::steady_clock::now();
+      const size_t last_layer = Base<T>::_num_layers - 1;
+      for(size_t cur_layer = 0; cur_layer < last_layer; ++cur_layer) {
+        const int* col_w = Base<T>::_host_weight + Base<T>::_layers[cur_layer].offset;
+        const bool is_uniform = Base<T>::_uniform_layers[cur_layer];
+        cpu_sparse_inference<T>(
+          _lane_Y[lane][cur_layer % 2],
+          col_w,
+          col_w + Base<T>::_num_neurons + 1,
+          is_uniform ? nullptr : (const T*)(col_w + Base<T>::_layers[cur_layer].index_len),
+          Base<T>::_uniform_values[cur_layer],
+          Base<T>::_bias,
+          _lane_Y[lane][(cur_layer + 1) % 2],
+          _lane_accumulator[lane].get(),
+          _lane_touched[lane].get(),
+          _lane_is_touched[lane].get()
+        );
+        _lane_max_nnz[lane] = std::max(
+          _lane_max_nnz[lane],
+          _lane_Y[lane][(cur_layer + 1) % 2].col_array.size()
+        );
+      }
+
+      //the last layer writes categories straight into the results
+      const int* col_w = Base<T>::_host_weight + Base<T>::_layers[last_layer].offset;
+      const bool is_uniform = Base<T>::_uniform_layers[last_layer];
+      cpu_sparse_identify_inference<T>(
+        _lane_Y[lane][last_layer % 2],
+        col_w,
+        col_w + Base<T>::_num_neurons + 1,
+        is_uniform ? nullptr : (const T*)(col_w + Base<T>::_layers[last_layer].index_len),
+        Base<T>::_uniform_values[last_layer],
+        Base<T>::_bias,
+        _results + lane_batch[lane].beg,
+        _lane_accumulator[lane].get(),
+        _lane_touched[lane].get(),
+        _lane_is_touched[lane].get()
+      );
+
+      const auto& batch = lane_batch[lane];
+      _scheduler->report(
+        batch.rows,
+        std::count(_results + batch.beg, _results + batch.beg + batch.rows, 1),
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - batch_beg).count()
+      );
+    }).name("CPU"));
+
+    fetchs.emplace_back(taskflow.emplace([&, lane](){
+      return fetch(lane);
+    }).name("fetch"));
+  }
+
+  tf::Task stop = taskflow.emplace([](){}).name("stop");
+
+  //dependencies of taskflow
+  for(size_t lane = 0; lane < _num_threads; ++lane) {
+    start.precede(first_fetchs[lane]);
+    first_fetchs[lane].precede(infers[lane], stop);
+    infers[lane].precede(fetchs[lane]);
+    fetchs[lane].precede(infers[lane], stop);
+  }
+
+  executor.run(taskflow).wait();
+  _input_stream.reset();
+
+  Base<T>::toc();
+  Base<T>::log("Finish inference with ", Base<T>::duration(), " ms", "\n");
+  Base<T>::log(
+    "Scheduled ", _scheduler->num_batches(), " batches of ",
+    _scheduler->smallest_batch(), " to ", _scheduler->largest_batch(), " inputs, ",
+    _scheduler->live_fraction() * 100, "% alive after the last layer", "\n"
+  );
+  Base<T>::log(
+    "Largest activation of a batch : ",
+    *std::max_element(_lane_max_nnz.begin(), _lane_max_nnz.end()),
+    " nonzeros (dense: ", _batch_size * Base<T>::_num_neurons, ")", "\n"
+  );
+}
+
+template <typename T>
+void SparseSNIG<T>::_weight_alloc() {
+  //prepacked models keep their own sections and may be ELL
+  if(Base<T>::_num_secs != 1 || Base<T>::_ell_width != 0) {
+    Base<T>::_resection_weight(Base<T>::_num_neurons);
+  }
+}
+
+template <typename T>
+void SparseSNIG<T>::_input_alloc() {
+  const size_t ylen = _batch_size * Base<T>::_num_neurons;
+
+  //double buffering for every lane
+  for(size_t i = 0; i < 2 * _num_threads; ++i) {
+    _ring_Y.push_back(new T[ylen]);
+    _ring_is_nonzero_row.push_back(new bool[_batch_size * Base<T>::_num_secs]);
+  }
+
+  for(size_t lane = 0; lane < _num_threads; ++lane) {
+    _lane_Y.emplace_back(2);
+    _lane_accumulator.emplace_back(std::make_unique<T[]>(Base<T>::_num_neurons));
+    _lane_touched.emplace_back(std::make_unique<int[]>(Base<T>::_num_neurons));
+    _lane_is_touched.emplace_back(std::make_unique<bool[]>(Base<T>::_num_neurons));
+  }
+}
+
+template <typename T>
+void SparseSNIG<T>::_result_alloc() {
+  _results = new int[Base<T>::_num_inputs]();
+}
+
+}// end of namespace snig ----------------------------------------------
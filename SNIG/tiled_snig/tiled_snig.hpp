@@ -0,0 +1,609 @@
+#pragma once
+
+#include <Eigen/Core>
+#include <taskflow/taskflow.hpp>
+#include <SNIG/utility/reader.hpp>
+#include <SNIG/utility/input_stream.hpp>
+#include <SNIG/utility/cache_info.hpp>
+#include <SNIG/utility/matrix_format.h>
+#include <SNIG/cpu_snig/kernel.hpp>
+#include <SNIG/base/base.hpp>
+#include <algorithm>
+#include <numeric>
+#include <vector>
+#include <memory>
+#include <chrono>
+
+namespace std {
+  namespace fs = experimental::filesystem;
+}
+
+namespace snig{
+
+//tiles are at most MAX_TILE_SIZE rows, a larger tile no longer fits in L2 for any model
+constexpr size_t MAX_TILE_SIZE = 64;
+
+//a tile pulls a layer once at least PULL_DENSITY of its input activations are nonzero
+constexpr double PULL_DENSITY = 0.5;
+
+template <typename T>
+class TiledSNIG : public Base<T> {
+
+  //Depth-first version of CPUSNIG.
+  //CPUSNIG pushes every row of a batch through layer L before any row sees layer L + 1,
+  //thus activations of the whole batch are streamed through memory once per layer.
+  //Here a lane splits its batch into tiles of a few rows,
+  //and runs each tile through all layers while its ping-pong buffers stay in L1/L2.
+  //Weights are shared read-only by all lanes.
+  //
+  //Like direction-optimizing BFS, every tile picks push or pull for every layer.
+  //Push scatters the nonzero activations of each row into output sections and does work
+  //proportional to the density, pull gathers the inputs of every output neuron for all rows
+  //of the tile from a transposed copy of the layer, which wins once rows are dense.
+
+  static_assert(
+    std::is_same<T, float>::value || std::is_same<T, double>::value,
+    "data type must be either float or double"
+  );
+
+  private:
+
+    size_t _batch_size;
+    size_t _min_batch_size;
+    size_t _num_threads;
+    size_t _tile_size;
+    double _pull_density;
+
+    //sizes batches from the time and live rows of finished ones
+    std::unique_ptr<BatchScheduler> _scheduler;
+
+    //transposed copy of every layer (CSR over output neurons) used by pull,
+    //empty if pull is disabled
+    std::unique_ptr<int[]> _pull_weight;
+    std::vector<PackedLayer> _pull_layers;
+
+    //inputs are streamed through a ring of two batches per lane,
+    //the first layer of a tile reads its rows in place from the ring buffer
+    std::unique_ptr<InputStream<T> > _input_stream;
+    std::vector<T*> _ring_Y;
+    std::vector<bool*> _ring_is_nonzero_row;
+
+    //ping-pong buffers of one tile for each lane
+    std::vector<std::vector<T*> > _lane_tile_Y;
+    std::vector<std::vector<bool*> > _lane_tile_is_nonzero_row;
+
+    //transposed tile gathered by pull for each lane
+    std::vector<T*> _lane_tile_Y_t;
+
+    //scratch accumulator of one section (plus an ELL padding slot) for each lane
+    std::vector<T*> _lane_results;
+
+    //number of (tile, layer) pairs each lane pushed and pulled
+    std::vector<size_t> _lane_num_pushes;
+    std::vector<size_t> _lane_num_pulls;
+
+    //unit weights scattered for uniform layers
+    std::vector<T> _ones;
+
+    int* _results{nullptr};
+
+    void _set_parameters(
+      const size_t num_inputs,
+      const size_t batch_size,
+      const size_t num_threads,
+      const size_t tile_size,
+      const double pull_density,
+      const size_t min_batch_size
+    );
+
+    void _preprocess(const std::fs::path& input_path);
+
+    void  _infer();
+
+    //push num_rows rows at Y through all layers and identify them into results
+    void _infer_tile(
+      const size_t lane,
+      const T* Y,
+      const bool* is_nonzero_row,
+      const size_t num_rows,
+      int* results,
+      const CSRKernels<T>& csr,
+      const fixed_scatter_t<T> ell_scatter
+    );
+
+    //whether at least _pull_density of the num_rows rows at Y are nonzero
+    //only sections flagged in is_nonzero_row are scanned, and scanning stops at the threshold
+    bool _is_dense(const T* Y, const bool* is_nonzero_row, const size_t num_rows) const;
+
+    void _input_alloc();
+
+    void _weight_alloc();
+
+    void _result_alloc();
+
+  public:
+
+    TiledSNIG(
+      const std::fs::path& weight_path,
+      const T bias = -.3f,
+      const size_t num_neurons_per_layer = 1024,
+      const size_t num_layers = 120
+    );
+
+    ~TiledSNIG();
+
+    //tile_size == 0 picks the largest tile whose ping-pong buffers fit in half of L2
+    //pull_density > 1 always pushes and does not build the transposed weight
+    //batches have between min_batch_size and batch_size rows (see BatchScheduler)
+    Eigen::Matrix<int, Eigen::Dynamic, 1> infer(
+      const std::fs::path& input_path,
+      const size_t num_inputs,
+      const size_t batch_size,
+      const size_t num_threads,
+      const size_t tile_size = 0,
+      const double pull_density = PULL_DENSITY,
+      const size_t min_batch_size = MIN_BATCH_SIZE
+    );
+
+};
+
+// ----------------------------------------------------------------------------
+// Definition of TiledSNIG
+// ----------------------------------------------------------------------------
+
+template <typename T>
+TiledSNIG<T>::TiledSNIG(
+  const std::fs::path& weight_path,
+  const T bias,
+  const size_t num_neurons_per_layer,
+  const size_t num_layers
+):
+  Base<T>(
+    weight_path,
+    bias,
+    num_neurons_per_layer,
+    num_layers,
+    get_sec_size<T>(num_neurons_per_layer),
+    WeightOptions{MAX_ELL_WIDTH, true, true, true}
+  )
+{
+  Base<T>::log("Constructing TiledSNIG engine......", "\n");
+}
+
+template <typename T>
+TiledSNIG<T>::~TiledSNIG() {
+  //stop the I/O thread before freeing its buffers
+  _input_stream.reset();
+
+  for(auto& Y_in_ring : _ring_Y) {
+    delete[] Y_in_ring;
+  }
+  for(auto& rowsY_in_ring : _ring_is_nonzero_row) {
+    delete[] rowsY_in_ring;
+  }
+  for(auto& Y_in_lane : _lane_tile_Y) {
+    delete[] Y_in_lane[0];
+    delete[] Y_in_lane[1];
+  }
+  for(auto& rowsY_in_lane : _lane_tile_is_nonzero_row) {
+    delete[] rowsY_in_lane[0];
+    delete[] rowsY_in_lane[1];
+  }
+  for(auto& Y_t_in_lane : _lane_tile_Y_t) {
+    delete[] Y_t_in_lane;
+  }
+  for(auto& results_in_lane : _lane_results) {
+    delete[] results_in_lane;
+  }
+
+  delete[] _results;
+}
+
+template <typename T>
+Eigen::Matrix<int, Eigen::Dynamic, 1> TiledSNIG<T>::infer(
+  const std::fs::path& input_path,
+  const size_t num_inputs,
+  const size_t batch_size,
+  const size_t num_threads,
+  const size_t tile_size,
+  const double pull_density,
+  const size_t min_batch_size
+) {
+
+  _set_parameters(
+    num_inputs,
+    batch_size,
+    num_threads,
+    tile_size,
+    pull_density,
+    min_batch_size
+  );
+
+  Base<T>::log("Using ", _num_threads, " CPU threads", "\n");
+  Base<T>::log("Total input size : ", num_inputs, "\n");
+  Base<T>::log("Input batch size : ", std::min(_min_batch_size, batch_size), " to ", batch_size, "\n");
+  Base<T>::log("Row tile size : ", _tile_size, "\n");
+  Base<T>::log("Pull density : ", _pull_density, "\n\n");
+
+  _preprocess(input_path);
+
+  _infer();
+
+  return arr_to_Eigen_int(_results, Base<T>::_num_inputs);
+}
+
+template <typename T>
+void TiledSNIG<T>::_set_parameters(
+  const size_t num_inputs,
+  const size_t batch_size,
+  const size_t num_threads,
+  const size_t tile_size,
+  const double pull_density,
+  const size_t min_batch_size
+) {
+  Base<T>::_num_inputs = num_inputs;
+  _pull_density = pull_density;
+  _num_threads = num_threads;
+  _batch_size = batch_size;
+  _min_batch_size = min_batch_size;
+
+  _tile_size = tile_size;
+  if(_tile_size == 0) {
+    //two tiles of activations in half of L2, the other half is left to weights
+    const size_t tile_bytes = 2 * Base<T>::_num_neurons * (sizeof(T) + sizeof(bool));
+    _tile_size = std::max(read_cache_info().l2 / 2 / tile_bytes, size_t(1));
+    _tile_size = std::min(_tile_size, MAX_TILE_SIZE);
+  }
+  _tile_size = std::min(_tile_size, _batch_size);
+
+  _lane_tile_Y.reserve(_num_threads);
+  _lane_tile_is_nonzero_row.reserve(_num_threads);
+  _lane_tile_Y_t.reserve(_num_threads);
+  _lane_results.reserve(_num_threads);
+  _lane_num_pushes.assign(_num_threads, 0);
+  _lane_num_pulls.assign(_num_threads, 0);
+}
+
+template <typename T>
+void TiledSNIG<T>::_preprocess(const std::fs::path& input_path) {
+  Base<T>::log("Preprocessing...... ");
+  Base<T>::tic();
+
+  //weight allocation
+  _weight_alloc();
+  //input allocation
+  _input_alloc();
+  //final results allocation
+  _result_alloc();
+
+  //start reading input, batches are consumed by lanes while later ones are read
+  _scheduler = std::make_unique<BatchScheduler>(
+    Base<T>::_num_inputs,
+    _batch_size,
+    _min_batch_size,
+    _num_threads
+  );
+  _input_stream = std::make_unique<InputStream<T> >(
+    input_path,
+    Base<T>::_num_inputs,
+    Base<T>::_num_neurons,
+    Base<T>::_sec_size,
+    _batch_size,
+    _ring_Y,
+    _ring_is_nonzero_row,
+    _scheduler.get()
+  );
+
+  Base<T>::toc();
+  Base<T>::log("Finish preprocessing with ", Base<T>::duration(), " ms", "\n");
+}
+
+template <typename T>
+void TiledSNIG<T>::_infer() {
+  //pick the widest column scatter supported by this CPU
+  //and the CSR kernels specialized for the model sizes if there are
+  const ISA isa = detect_isa();
+  const CSRKernels<T> csr = get_csr_kernels<T>(Base<T>::_num_neurons, Base<T>::_sec_size, isa);
+  Base<T>::log("Using ", isa_name(isa), " column scatter", "\n");
+  if(Base<T>::_ell_width != 0) {
+    Base<T>::log("Using ELL weights with width ", Base<T>::_ell_width, "\n");
+  }
+  else {
+    Base<T>::log("Using ", csr.is_fixed ? "specialized" : "generic", " CSR kernels", "\n");
+  }
+  const fixed_scatter_t<T> ell_scatter = Base<T>::_ell_width == 0 ?
+    nullptr : get_fixed_scatter<T>(Base<T>::_ell_width, isa);
+
+  Base<T>::log("Start inference...... ", "\n");
+  Base<T>::tic();
+
+  //same task graph as CPUSNIG, each lane owns a batch at a time
+  tf::Taskflow taskflow("TiledSNIG");
+  tf::Executor executor(_num_threads);
+  std::vector<tf::Task> first_fetchs;
+  std::vector<tf::Task> infers;
+  std::vector<tf::Task> fetchs;
+  first_fetchs.reserve(_num_threads);
+  infers.reserve(_num_threads);
+  fetchs.reserve(_num_threads);
+
+  std::vector<typename InputStream<T>::Batch> lane_batch(_num_threads);
+
+  auto fetch = [&](const size_t lane) {
+    //results of the previous batch are already identified
+    if(lane_batch[lane].Y != nullptr) {
+      _input_stream->release(lane_batch[lane]);
+      lane_batch[lane] = typename InputStream<T>::Batch{};
+    }
+    if(!_input_stream->acquire(lane_batch[lane])) {
+      return 1;
+    }
+    return 0;
+  };
+
+  tf::Task start = taskflow.emplace([](){
+  }).name("start");
+
+  for(size_t lane = 0; lane < _num_threads; ++lane) {
+    first_fetchs.emplace_back(taskflow.emplace([&, lane](){
+      return fetch(lane);
+    }).name("first_fetch"));
+
+    infers.emplace_back(taskflow.emplace([&, lane](){
+      const auto batch_beg = std::chrono::steady_clock::now();
+      const auto& batch = lane_batch[lane];
+      for(size_t beg = 0; beg < batch.rows; beg += _tile_size) {
+        _infer_tile(
+          lane,
+          batch.Y + beg * Base<T>::_num_neurons,
+          batch.is_nonzero_row + beg * Base<T>::_num_secs,
+          std::min(_tile_size, batch.rows - beg),
+          _results + batch.beg + beg,
+          csr,
+          ell_scatter
+        );
+      }
+
+      _scheduler->report(
+        batch.rows,
+        std::count(_results + batch.beg, _results + batch.beg + batch.rows, 1),
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - batch_beg).count()
+      );
+    }).name("CPU"));
+
+    fetchs.emplace_back(taskflow.emplace([&, lane](){
+      return fetch(lane);
+    }).name("fetch"));
+  }
+
+  tf::Task stop = taskflow.emplace([](){}).name("stop");
+
+  //dependencies of taskflow
+  for(size_t lane = 0; lane < _num_threads; ++lane) {
+    start.precede(first_fetchs[lane]);
+    first_fetchs[lane].precede(infers[lane], stop);
+    infers[lane].precede(fetchs[lane]);
+    fetchs[lane].precede(infers[lane], stop);
+  }
+
+  executor.run(taskflow).wait();
+  _input_stream.reset();
+
+  Base<T>::toc();
+  Base<T>::log("Finish inference with ", Base<T>::duration(), " ms", "\n");
+
+  Base<T>::log(
+    "Scheduled ", _scheduler->num_batches(), " batches of ",
+    _scheduler->smallest_batch(), " to ", _scheduler->largest_batch(), " inputs, ",
+    _scheduler->live_fraction() * 100, "% alive after the last layer", "\n"
+  );
+  Base<T>::log(
+    "Pushed ", std::accumulate(_lane_num_pushes.begin(), _lane_num_pushes.end(), size_t(0)),
+    " and pulled ", std::accumulate(_lane_num_pulls.begin(), _lane_num_pulls.end(), size_t(0)),
+    " tile layers", "\n"
+  );
+}
+
+template <typename T>
+void TiledSNIG<T>::_infer_tile(
+  const size_t lane,
+  const T* Y,
+  const bool* is_nonzero_row,
+  const size_t num_rows,
+  int* results,
+  const CSRKernels<T>& csr,
+  const fixed_scatter_t<T> ell_scatter
+) {
+  const size_t N = Base<T>::_num_neurons;
+  const size_t num_secs = Base<T>::_num_secs;
+
+  //the first layer reads the tile from the batch, later ones ping-pong between tile buffers
+  const T* Y_0 = Y;
+  const bool* is_nonzero_row_0 = is_nonzero_row;
+  for(size_t cur_layer = 0; cur_layer < Base<T>::_num_layers; ++cur_layer) {
+    T* Y_1 = _lane_tile_Y[lane][cur_layer % 2];
+    bool* is_nonzero_row_1 = _lane_tile_is_nonzero_row[lane][cur_layer % 2];
+
+    //uniform layers do not stream any weight value
+    const bool is_uniform = Base<T>::_uniform_layers[cur_layer];
+    const T w_value = Base<T>::_uniform_values[cur_layer];
+    const int* index_w = Base<T>::_host_weight + Base<T>::_layers[cur_layer].offset;
+    const T* val_w = is_uniform ? nullptr : (const T*)(index_w + Base<T>::_layers[cur_layer].index_len);
+
+    //measured active-neuron fraction of the tile picks the direction
+    if(!_pull_layers.empty()) {
+      if(_is_dense(Y_0, is_nonzero_row_0, num_rows)) {
+        const int* row_w = _pull_weight.get() + _pull_layers[cur_layer].offset;
+        cpu_snig_pull_inference<T>(
+          Y_0,
+          is_nonzero_row_0,
+          num_rows,
+          Base<T>::_sec_size,
+          num_secs,
+          N,
+          row_w,
+          row_w + N + 1,
+          is_uniform ? nullptr : (const T*)(row_w + _pull_layers[cur_layer].index_len),
+          w_value,
+          Base<T>::_bias,
+          is_nonzero_row_1,
+          Y_1,
+          _lane_tile_Y_t[lane]
+        );
+        ++_lane_num_pulls[lane];
+        Y_0 = Y_1;
+        is_nonzero_row_0 = is_nonzero_row_1;
+        continue;
+      }
+    }
+    ++_lane_num_pushes[lane];
+
+    //a pushed last layer writes categories straight into results
+    if(cur_layer + 1 == Base<T>::_num_layers) {
+      for(size_t r = 0; r < num_rows; ++r) {
+        results[r] = cpu_snig_packed_identify_inference<T>(
+          Y_0 + r * N,
+          is_nonzero_row_0 + r * num_secs,
+          Base<T>::_sec_size,
+          num_secs,
+          N,
+          Base<T>::_ell_width,
+          index_w,
+          val_w,
+          w_value,
+          _ones.data(),
+          Base<T>::_bias,
+          _lane_results[lane],
+          csr,
+          ell_scatter
+        );
+      }
+      return;
+    }
+
+    for(size_t r = 0; r < num_rows; ++r) {
+      cpu_snig_packed_inference<T>(
+        Y_0 + r * N,
+        is_nonzero_row_0 + r * num_secs,
+        Base<T>::_sec_size,
+        num_secs,
+        N,
+        Base<T>::_ell_width,
+        index_w,
+        val_w,
+        w_value,
+        _ones.data(),
+        Base<T>::_bias,
+        is_nonzero_row_1 + r * num_secs,
+        Y_1 + r * N,
+        _lane_results[lane],
+        csr,
+        ell_scatter
+      );
+    }
+
+    Y_0 = Y_1;
+    is_nonzero_row_0 = is_nonzero_row_1;
+  }
+
+  //the last layer was pulled
+  cpu_identify<T>(Y_0, num_rows, N, results);
+}
+
+template <typename T>
+bool TiledSNIG<T>::_is_dense(const T* Y, const bool* is_nonzero_row, const size_t num_rows) const {
+  const size_t N = Base<T>::_num_neurons;
+  const size_t sec_size = Base<T>::_sec_size;
+  const size_t num_secs = Base<T>::_num_secs;
+  const double threshold = _pull_density * num_rows * N;
+
+  //flagged sections bound the nonzeros from above
+  const size_t num_flagged = std::count(is_nonzero_row, is_nonzero_row + num_rows * num_secs, true);
+  if(num_flagged * sec_size < threshold) {
+    return false;
+  }
+
+  size_t nnz{0};
+  for(size_t r = 0; r < num_rows; ++r) {
+    for(size_t s = 0; s < num_secs; ++s) {
+      if(!is_nonzero_row[r * num_secs + s]) {
+        continue;
+      }
+      const T* sec = Y + r * N + s * sec_size;
+      nnz += sec_size - std::count(sec, sec + sec_size, T(0));
+      if(nnz >= threshold) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+template <typename T>
+void TiledSNIG<T>::_weight_alloc() {
+  //all lanes read the packed weight in place from Base<T>::_host_weight
+  _ones.assign(std::max(Base<T>::_sec_size, MAX_ELL_WIDTH), T(1));
+
+  if(_pull_density > 1) {
+    return;
+  }
+
+  std::vector<WeightHeader> headers(Base<T>::_num_layers);
+  for(size_t i = 0; i < Base<T>::_num_layers; ++i) {
+    headers[i].nnz = packed_nnz(
+      Base<T>::_host_weight + Base<T>::_layers[i].offset,
+      Base<T>::_num_neurons,
+      Base<T>::_num_secs,
+      Base<T>::_ell_width
+    );
+    headers[i].uniform = Base<T>::_uniform_layers[i];
+  }
+  _pull_layers = packed_layers<T>(headers, Base<T>::_num_neurons, 1, 0, true);
+
+  const size_t wlen = _pull_layers.back().offset + _pull_layers.back().length;
+  _pull_weight = std::make_unique<int[]>(wlen);
+  for(size_t i = 0; i < Base<T>::_num_layers; ++i) {
+    transpose_layer<T>(
+      Base<T>::_host_weight + Base<T>::_layers[i].offset,
+      Base<T>::_layers[i],
+      Base<T>::_num_neurons,
+      Base<T>::_num_secs,
+      Base<T>::_ell_width,
+      _pull_weight.get() + _pull_layers[i].offset,
+      _pull_layers[i],
+      !Base<T>::_uniform_layers[i]
+    );
+  }
+}
+
+template <typename T>
+void TiledSNIG<T>::_input_alloc() {
+  const size_t batch_ylen = _batch_size * Base<T>::_num_neurons;
+  const size_t tile_ylen = _tile_size * Base<T>::_num_neurons;
+
+  //double buffering for every lane
+  for(size_t i = 0; i < 2 * _num_threads; ++i) {
+    _ring_Y.push_back(new T[batch_ylen]);
+    _ring_is_nonzero_row.push_back(new bool[_batch_size * Base<T>::_num_secs]);
+  }
+
+  //kernels only clear sections flagged nonzero, thus tile buffers start zeroed
+  for(size_t lane = 0; lane < _num_threads; ++lane) {
+    _lane_tile_Y.push_back({new T[tile_ylen](), new T[tile_ylen]()});
+    _lane_tile_is_nonzero_row.push_back({
+      new bool[_tile_size * Base<T>::_num_secs](),
+      new bool[_tile_size * Base<T>::_num_secs]()
+    });
+    const size_t tile_tlen = (_tile_size + PULL_ROWS - 1) / PULL_ROWS * PULL_ROWS * Base<T>::_num_neurons;
+    _lane_tile_Y_t.push_back(_pull_density > 1 ? nullptr : new T[tile_tlen]);
+    //one more slot for padded ELL entries
+    _lane_results.push_back(new T[Base<T>::_sec_size + 1]);
+  }
+}
+
+template <typename T>
+void TiledSNIG<T>::_result_alloc() {
+  _results = new int[Base<T>::_num_inputs]();
+}
+
+}// end of namespace snig ----------------------------------------------
@@ -0,0 +1,205 @@
+#pragma once
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+namespace snig {
+
+//smallest batch handed out by default
+constexpr size_t MIN_BATCH_SIZE = 16;
+
+//guided self-scheduling of input batches for host engines
+//with fixed batches the tail is unbalanced: late batches have mostly dead rows and finish
+//faster, while one lane still computes a full batch and the others idle.
+//Here every batch aims at 1 / (GUIDED_FACTOR * num_workers) of the predicted remaining time,
+//thus batches shrink towards the tail, but never below MIN_BATCH_MS, under which per-batch
+//overheads dominate.
+//Rows dying early skip most layers, so the time per row is fitted linearly against the fraction
+//of rows alive after the last layer on finished batches: the remaining inputs are priced at the
+//overall live fraction, and the next batch at the live fraction of recent batches.
+//Until the first report batches take 1 / (GUIDED_FACTOR * num_workers) of the inputs left.
+//Batch sizes are chosen in input order by the reader, and reported by the workers.
+class BatchScheduler {
+
+  public:
+
+    //share of the remaining inputs given to one batch, per worker
+    static constexpr size_t GUIDED_FACTOR = 2;
+
+    //shortest batch worth scheduling, in milliseconds
+    static constexpr double MIN_BATCH_MS = 20.0;
+
+    //weight of the latest batch in the recent live fraction
+    static constexpr double SMOOTHING = 0.5;
+
+    //batches have between min_batch_size and max_batch_size rows,
+    //min_batch_size >= max_batch_size hands out fixed batches
+    BatchScheduler(
+      const size_t num_inputs,
+      const size_t max_batch_size,
+      const size_t min_batch_size,
+      const size_t num_workers
+    );
+
+    //rows of the batch starting at input beg, batches are asked for in input order
+    size_t next(const size_t beg);
+
+    //a worker finished a batch of rows inputs in ms milliseconds,
+    //live_rows of them are nonzero after the last layer
+    void report(const size_t rows, const size_t live_rows, const double ms);
+
+    size_t num_batches() const;
+
+    size_t smallest_batch() const;
+
+    size_t largest_batch() const;
+
+    //fraction of the reported rows alive after the last layer
+    double live_fraction() const;
+
+  private:
+
+    const size_t _num_inputs;
+    const size_t _max_batch_size;
+    const size_t _min_batch_size;
+    const size_t _num_workers;
+
+    mutable std::mutex _mutex;
+
+    size_t _num_batches{0};
+    size_t _smallest_batch{std::numeric_limits<size_t>::max()};
+    size_t _largest_batch{0};
+
+    size_t _reported_rows{0};
+    size_t _live_rows{0};
+
+    //sums of the least-squares fit ms / rows = a + b * live_rows / rows,
+    //each batch weighted by its rows
+    double _sum_x{0};
+    double _sum_y{0};
+    double _sum_xx{0};
+    double _sum_xy{0};
+
+    //live fraction of recent batches
+    double _recent_live_fraction{0};
+
+    //predicted milliseconds per row of rows with the given live fraction, 0 until the first report
+    double _ms_per_row(const double live_fraction) const;
+};
+
+// ----------------------------------------------------------------------------
+// Definition of BatchScheduler
+// ----------------------------------------------------------------------------
+
+inline
+BatchScheduler::BatchScheduler(
+  const size_t num_inputs,
+  const size_t max_batch_size,
+  const size_t min_batch_size,
+  const size_t num_workers
+):
+  _num_inputs{num_inputs},
+  _max_batch_size{max_batch_size},
+  _min_batch_size{std::max(std::min(min_batch_size, max_batch_size), size_t(1))},
+  _num_workers{std::max(num_workers, size_t(1))}
+{
+  using namespace std::literals::string_literals;
+
+  if(max_batch_size == 0) {
+    throw std::runtime_error("Input batch size must be positive"s);
+  }
+}
+
+inline
+size_t BatchScheduler::next(const size_t beg) {
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  const size_t remaining = _num_inputs - beg;
+  size_t rows = (remaining + GUIDED_FACTOR * _num_workers - 1) / (GUIDED_FACTOR * _num_workers);
+
+  const double remaining_ms_per_row = _ms_per_row(double(_live_rows) / std::max(_reported_rows, size_t(1)));
+  const double next_ms_per_row = _ms_per_row(_recent_live_fraction);
+  if(remaining_ms_per_row > 0 && next_ms_per_row > 0) {
+    double batch_ms = remaining * remaining_ms_per_row / (GUIDED_FACTOR * _num_workers);
+    if(batch_ms < MIN_BATCH_MS) {
+      batch_ms = MIN_BATCH_MS;
+    }
+    rows = static_cast<size_t>(std::min(batch_ms / next_ms_per_row, double(remaining)));
+  }
+  rows = std::min(std::max(rows, _min_batch_size), _max_batch_size);
+  rows = std::min(rows, remaining);
+
+  ++_num_batches;
+  _smallest_batch = std::min(_smallest_batch, rows);
+  _largest_batch = std::max(_largest_batch, rows);
+  return rows;
+}
+
+inline
+void BatchScheduler::report(const size_t rows, const size_t live_rows, const double ms) {
+  if(rows == 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  const double x = double(live_rows) / rows;
+  const double y = ms / rows;
+  _sum_x += rows * x;
+  _sum_y += rows * y;
+  _sum_xx += rows * x * x;
+  _sum_xy += rows * x * y;
+
+  //recent batches predict the next ones better than the average over all inputs
+  _recent_live_fraction = _reported_rows == 0 ? x : SMOOTHING * x + (1 - SMOOTHING) * _recent_live_fraction;
+  _reported_rows += rows;
+  _live_rows += live_rows;
+}
+
+inline
+double BatchScheduler::_ms_per_row(const double live_fraction) const {
+  if(_reported_rows == 0) {
+    return 0;
+  }
+  const double n = _reported_rows;
+  const double mean_x = _sum_x / n;
+  const double mean_y = _sum_y / n;
+  const double var_x = _sum_xx / n - mean_x * mean_x;
+
+  //batches with (almost) the same live fraction cannot separate live and dead rows
+  double slope = 0;
+  if(var_x > 1e-6) {
+    slope = (_sum_xy / n - mean_x * mean_y) / var_x;
+  }
+  //a dead row never costs more than a live one, and no prediction drops below a tenth of the average
+  slope = std::max(slope, 0.0);
+  return std::max(mean_y + slope * (live_fraction - mean_x), mean_y * 0.1);
+}
+
+inline
+size_t BatchScheduler::num_batches() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _num_batches;
+}
+
+inline
+size_t BatchScheduler::smallest_batch() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _num_batches == 0 ? 0 : _smallest_batch;
+}
+
+inline
+size_t BatchScheduler::largest_batch() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _largest_batch;
+}
+
+inline
+double BatchScheduler::live_fraction() const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _reported_rows == 0 ? 0 : double(_live_rows) / _reported_rows;
+}
+
+}// end of namespace snig ----------------------------------------------
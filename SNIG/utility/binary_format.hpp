@@ -0,0 +1,573 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <stdexcept>
+#include <vector>
+
+namespace snig {
+
+//on-disk layout of a packed weight layer (.b)
+//  CSR : row_array (rows * N_SLAB + 1 ints), col_array (nnz ints), values (nnz T)
+//  ELL : col_array (rows * N_SLAB * width ints), values (rows * N_SLAB * width T)
+//        every (section, row) owns exactly width slots,
+//        unused slots point to (section + 1) * COL_BLK, i.e. one past the section, with value 0
+//if every weight of a layer equals the same value, the values array is not stored
+//and the value is kept in the header (UNIFORM_VALUE)
+enum class WeightFormat : int {
+  CSR = 0,
+  ELL = 1
+};
+
+//CSR files written before the header was introduced only store (rows, nnz),
+//such files are still accepted and reported as CSR
+//since version 3 the converter writes plain CSC (one section) and records its section size,
+//engines re-section layers at load time
+constexpr size_t WEIGHT_MAGIC = 0x0000315447494e53; // "SNIGT1"
+constexpr int WEIGHT_VERSION = 3;
+
+//header flags since version 2
+//only layers whose weights all equal a power of two are flagged uniform:
+//host kernels sum their activations and scale the sum once (see _cpu_snig_section),
+//which rounds exactly as the weighted sum of the GPU engines only for such values
+constexpr int UNIFORM_VALUE = 1;
+
+//true if scaling by value is exact, i.e. value is a (positive or negative) power of two
+inline
+bool is_exact_scaling(const double value) {
+  int exponent;
+  return std::isfinite(value) && std::abs(std::frexp(value, &exponent)) == 0.5;
+}
+
+struct WeightHeader {
+  WeightFormat format{WeightFormat::CSR};
+  size_t rows{0};
+  size_t nnz{0};
+  //sections stored in the file, 0 if unknown (files without header)
+  size_t num_secs{0};
+  size_t width{0};
+  bool uniform{false};
+  double value{0};
+  //section size chosen by the converter, only a hint, 0 if not recorded
+  size_t sec_size{0};
+};
+
+//in-memory layout of a packed layer, all sizes are in ints
+//  CSR : row_array (rows * N_SLAB + 1), col_array (nnz), values (nnz T)
+//  ELL : col_array (rows * N_SLAB * width), values (rows * N_SLAB * width T)
+//values start at index_len, which is rounded up to the alignment of T,
+//every layer starts at a PACKED_LAYER_ALIGNMENT-byte boundary of the packed array
+//and is only as long as its own nnz requires
+constexpr size_t PACKED_LAYER_ALIGNMENT = 64;
+
+struct PackedLayer {
+  size_t offset{0};
+  size_t length{0};
+  size_t index_len{0};
+};
+
+//on-disk layout of an input file (sparse-images-N.b)
+//  dense : (rows, cols), values (rows * cols T)
+//  CSR   : header, row_array (rows + 1 size_t), col_array (nnz ints), values (nnz T)
+//dense files carry no magic number, they are what the converter wrote before CSR
+constexpr size_t INPUT_MAGIC = 0x0000314947494e53; // "SNIGI1"
+constexpr int INPUT_VERSION = 1;
+
+enum class ValueType : int {
+  FLOAT = 0,
+  DOUBLE = 1,
+  HALF = 2
+};
+
+struct InputHeader {
+  bool is_csr{false};
+  size_t rows{0};
+  size_t cols{0};
+  size_t nnz{0};
+  ValueType value_type{ValueType::FLOAT};
+};
+
+//prepacked model (.snig) : header, layer table, packed layers
+//the header records everything needed to lay out the weights (neurons, layers, value type, sections),
+//the layer table starts at a 64-byte boundary and holds one LayerEntry per layer,
+//packed layers are exactly the image Base<T> builds in memory (see PackedLayer),
+//the table gives their byte offset and length, and data start at a page boundary,
+//thus they can be used in place through mmap
+//version 1 files (uniform table only) are no longer accepted, repack them
+constexpr size_t MODEL_MAGIC = 0x0000314d47494e53; // "SNIGM1"
+constexpr int MODEL_VERSION = 2;
+constexpr size_t MODEL_ALIGNMENT = 4096;
+constexpr size_t MODEL_TABLE_ALIGNMENT = 64;
+
+//model flags
+constexpr int MODEL_ELL = 1;
+constexpr int MODEL_CHECKSUM = 2;
+
+struct ModelHeader {
+  size_t magic{MODEL_MAGIC};
+  int version{MODEL_VERSION};
+  int value_type{0};
+  size_t num_neurons{0};
+  size_t num_layers{0};
+  size_t sec_size{0};
+  size_t num_secs{0};
+  int flags{0};
+  int reserved{0};
+  size_t max_nnz{0};
+  size_t ell_width{0};
+  size_t pad{0};
+  size_t pp_wlen{0};
+  size_t table_offset{0};
+  size_t data_offset{0};
+};
+
+//max_nnz and pp_wlen are the largest layer, pad is unused since layers carry their own padding
+//offset and length are in bytes, offset is relative to data_offset
+//checksum is only valid if MODEL_CHECKSUM is set
+struct LayerEntry {
+  size_t offset{0};
+  size_t length{0};
+  size_t nnz{0};
+  uint64_t checksum{0};
+  int uniform{0};
+  int reserved{0};
+  double value{0};
+  size_t unused[2]{0, 0};
+};
+
+static_assert(sizeof(LayerEntry) == MODEL_TABLE_ALIGNMENT, "a layer entry must fill one cache line");
+
+inline
+WeightHeader read_weight_header(std::istream& in);
+
+inline
+void write_weight_header(std::ostream& out, const WeightHeader& header);
+
+template <typename T>
+ValueType value_type_of();
+
+inline
+InputHeader read_input_header(std::istream& in);
+
+inline
+uint64_t layer_checksum(const void* data, const size_t bytes);
+
+template <typename T>
+std::vector<PackedLayer> packed_layers(
+  const std::vector<WeightHeader>& headers,
+  const size_t num_neurons_per_layer,
+  const size_t N_SLAB,
+  const size_t ell_width,
+  const bool skip_uniform_values
+);
+
+//number of weights of a packed layer, padded ELL slots are not counted
+inline
+size_t packed_nnz(
+  const int* layer,
+  const size_t num_neurons_per_layer,
+  const size_t N_SLAB,
+  const size_t ell_width
+);
+
+//re-pack a packed layer (CSR, or ELL if ell_width > 0) with N_SLAB sections
+//into CSR with dst_N_SLAB sections, dst_layout comes from packed_layers<T> for dst_N_SLAB
+//values are copied unless has_values is false
+template <typename T>
+void resection_layer(
+  const int* src,
+  const PackedLayer& src_layout,
+  const size_t num_neurons_per_layer,
+  const size_t N_SLAB,
+  const size_t ell_width,
+  int* dst,
+  const PackedLayer& dst_layout,
+  const size_t dst_N_SLAB,
+  const bool has_values
+);
+
+//transpose a packed layer (CSR, or ELL if ell_width > 0) with N_SLAB sections
+//into CSR over output neurons, every output neuron lists its input neurons in ascending order
+//dst_layout comes from packed_layers<T> with a single section
+//values are copied unless has_values is false
+template <typename T>
+void transpose_layer(
+  const int* src,
+  const PackedLayer& src_layout,
+  const size_t num_neurons_per_layer,
+  const size_t N_SLAB,
+  const size_t ell_width,
+  int* dst,
+  const PackedLayer& dst_layout,
+  const bool has_values
+);
+
+inline
+void write_input_header(std::ostream& out, const InputHeader& header);
+
+//-----------------------------------------------------------------------------
+//Definition of binary format function
+//-----------------------------------------------------------------------------
+
+inline
+WeightHeader read_weight_header(std::istream& in) {
+  using namespace std::literals::string_literals;
+
+  WeightHeader header;
+  size_t first;
+  in.read((char*)&first, sizeof(size_t));
+
+  if(first != WEIGHT_MAGIC) {
+    //legacy CSR file
+    header.rows = first;
+    in.read((char*)&header.nnz, sizeof(size_t));
+    return header;
+  }
+
+  int version;
+  int format;
+  in.read((char*)&version, sizeof(int));
+  in.read((char*)&format, sizeof(int));
+  if(version > WEIGHT_VERSION) {
+    throw std::runtime_error("Unsupported weight file version "s + std::to_string(version));
+  }
+  header.format = static_cast<WeightFormat>(format);
+  in.read((char*)&header.rows, sizeof(size_t));
+  in.read((char*)&header.nnz, sizeof(size_t));
+  in.read((char*)&header.num_secs, sizeof(size_t));
+  in.read((char*)&header.width, sizeof(size_t));
+  if(version >= 2) {
+    int flags;
+    int sec_size;
+    in.read((char*)&flags, sizeof(int));
+    in.read((char*)&sec_size, sizeof(int));
+    in.read((char*)&header.value, sizeof(double));
+    header.uniform = flags & UNIFORM_VALUE;
+    if(header.uniform && !is_exact_scaling(header.value)) {
+      throw std::runtime_error(
+        "Uniform weight value "s + std::to_string(header.value) + " is not a power of two, repack the weight files"
+      );
+    }
+    //reserved in version 2
+    if(version >= 3) {
+      header.sec_size = sec_size;
+    }
+  }
+  return header;
+}
+
+inline
+void write_weight_header(std::ostream& out, const WeightHeader& header) {
+  //always versioned, files without header cannot tell their sections
+  int format = static_cast<int>(header.format);
+  out.write((char*)&WEIGHT_MAGIC, sizeof(size_t));
+  out.write((char*)&WEIGHT_VERSION, sizeof(int));
+  out.write((char*)&format, sizeof(int));
+  out.write((char*)&header.rows, sizeof(size_t));
+  out.write((char*)&header.nnz, sizeof(size_t));
+  out.write((char*)&header.num_secs, sizeof(size_t));
+  out.write((char*)&header.width, sizeof(size_t));
+
+  int flags = header.uniform ? UNIFORM_VALUE : 0;
+  int sec_size = static_cast<int>(header.sec_size);
+  out.write((char*)&flags, sizeof(int));
+  out.write((char*)&sec_size, sizeof(int));
+  out.write((char*)&header.value, sizeof(double));
+}
+
+template <typename T>
+ValueType value_type_of() {
+  //half is the only 2-byte type
+  return sizeof(T) == sizeof(double) ? ValueType::DOUBLE :
+         sizeof(T) == sizeof(float) ? ValueType::FLOAT : ValueType::HALF;
+}
+
+inline
+InputHeader read_input_header(std::istream& in) {
+  using namespace std::literals::string_literals;
+
+  InputHeader header;
+  size_t first;
+  in.read((char*)&first, sizeof(size_t));
+
+  if(first != INPUT_MAGIC) {
+    //legacy dense file
+    header.rows = first;
+    in.read((char*)&header.cols, sizeof(size_t));
+    header.nnz = header.rows * header.cols;
+    return header;
+  }
+
+  int version;
+  int value_type;
+  in.read((char*)&version, sizeof(int));
+  in.read((char*)&value_type, sizeof(int));
+  if(version > INPUT_VERSION) {
+    throw std::runtime_error("Unsupported input file version "s + std::to_string(version));
+  }
+  header.is_csr = true;
+  header.value_type = static_cast<ValueType>(value_type);
+  in.read((char*)&header.rows, sizeof(size_t));
+  in.read((char*)&header.cols, sizeof(size_t));
+  in.read((char*)&header.nnz, sizeof(size_t));
+  return header;
+}
+
+//row offsets of a CSR input must start at 0, never decrease, and end at header.nnz
+//otherwise expanding rows would index past the columns and values of the file
+inline
+void check_input_row_array(const InputHeader& header, const size_t* row_array) {
+  using namespace std::literals::string_literals;
+
+  if(row_array[0] != 0 || row_array[header.rows] != header.nnz) {
+    throw std::runtime_error("Row offsets of the input file do not span its nonzeros"s);
+  }
+  for(size_t r = 0; r < header.rows; ++r) {
+    if(row_array[r] > row_array[r + 1]) {
+      throw std::runtime_error("Row offsets of the input file decrease at row "s + std::to_string(r));
+    }
+  }
+}
+
+inline
+void write_input_header(std::ostream& out, const InputHeader& header) {
+  if(!header.is_csr) {
+    out.write((char*)&header.rows, sizeof(size_t));
+    out.write((char*)&header.cols, sizeof(size_t));
+    return;
+  }
+
+  int value_type = static_cast<int>(header.value_type);
+  out.write((char*)&INPUT_MAGIC, sizeof(size_t));
+  out.write((char*)&INPUT_VERSION, sizeof(int));
+  out.write((char*)&value_type, sizeof(int));
+  out.write((char*)&header.rows, sizeof(size_t));
+  out.write((char*)&header.cols, sizeof(size_t));
+  out.write((char*)&header.nnz, sizeof(size_t));
+}
+
+//FNV-1a over 64-bit words in four independent lanes, folded and mixed at the end
+//not cryptographic, it only catches truncated or corrupted layers
+inline
+uint64_t layer_checksum(const void* data, const size_t bytes) {
+  constexpr uint64_t basis = 0xcbf29ce484222325ULL;
+  constexpr uint64_t prime = 0x100000001b3ULL;
+
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  uint64_t lanes[4] = {basis, basis ^ 1, basis ^ 2, basis ^ 3};
+
+  size_t i = 0;
+  for(; i + sizeof(lanes) <= bytes; i += sizeof(lanes)) {
+    for(size_t k = 0; k < 4; ++k) {
+      uint64_t word;
+      std::memcpy(&word, p + i + k * sizeof(uint64_t), sizeof(uint64_t));
+      lanes[k] = (lanes[k] ^ word) * prime;
+    }
+  }
+
+  uint64_t h = basis;
+  for(size_t k = 0; k < 4; ++k) {
+    h = (h ^ lanes[k]) * prime;
+  }
+  for(; i < bytes; ++i) {
+    h = (h ^ p[i]) * prime;
+  }
+  h ^= bytes;
+
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return h;
+}
+
+//ell_width == 0 lays out every layer as CSR with its own nnz,
+//ell_width  > 0 lays out every layer as ELL with ell_width slots per row
+//values of uniform layers take no space if skip_uniform_values is set
+template <typename T>
+std::vector<PackedLayer> packed_layers(
+  const std::vector<WeightHeader>& headers,
+  const size_t num_neurons_per_layer,
+  const size_t N_SLAB,
+  const size_t ell_width,
+  const bool skip_uniform_values
+) {
+  //half is smaller than int, thus values never need padding
+  const size_t value_align = std::max(sizeof(T) / sizeof(int), size_t(1));
+  const size_t layer_align = PACKED_LAYER_ALIGNMENT / sizeof(int);
+
+  std::vector<PackedLayer> layers(headers.size());
+  size_t offset{0};
+  for(size_t i = 0; i < headers.size(); ++i) {
+    size_t index_len{0};
+    size_t num_values{0};
+    if(ell_width == 0) {
+      index_len = num_neurons_per_layer * N_SLAB + 1 + headers[i].nnz;
+      num_values = headers[i].nnz;
+    }
+    else {
+      index_len = num_neurons_per_layer * N_SLAB * ell_width;
+      num_values = index_len;
+    }
+    if(headers[i].uniform && skip_uniform_values) {
+      num_values = 0;
+    }
+
+    layers[i].offset = offset;
+    layers[i].index_len = (index_len + value_align - 1) / value_align * value_align;
+    layers[i].length = layers[i].index_len + (sizeof(T) * num_values + sizeof(int) - 1) / sizeof(int);
+    offset += (layers[i].length + layer_align - 1) / layer_align * layer_align;
+  }
+  return layers;
+}
+
+namespace detail {
+
+//call f(r, col, k) for every weight of a packed layer,
+//r is the row (s_o * num_neurons_per_layer + j), col the output neuron,
+//and k the position of the weight in the column and value arrays
+template <typename F>
+void for_each_packed_weight(
+  const int* layer,
+  const size_t num_neurons_per_layer,
+  const size_t N_SLAB,
+  const size_t ell_width,
+  F&& f
+) {
+  const size_t num_rows = num_neurons_per_layer * N_SLAB;
+  if(ell_width == 0) {
+    const int* row_array = layer;
+    const int* col_array = layer + num_rows + 1;
+    for(size_t r = 0; r < num_rows; ++r) {
+      for(int k = row_array[r]; k < row_array[r + 1]; ++k) {
+        f(r, col_array[k], size_t(k));
+      }
+    }
+    return;
+  }
+
+  //padded slots point to the first neuron of the next section
+  const size_t COL_BLK = num_neurons_per_layer / N_SLAB;
+  for(size_t r = 0; r < num_rows; ++r) {
+    const int dummy = (r / num_neurons_per_layer + 1) * COL_BLK;
+    for(size_t k = r * ell_width; k < (r + 1) * ell_width; ++k) {
+      if(layer[k] != dummy) {
+        f(r, layer[k], k);
+      }
+    }
+  }
+}
+
+}// end of namespace detail
+
+inline
+size_t packed_nnz(
+  const int* layer,
+  const size_t num_neurons_per_layer,
+  const size_t N_SLAB,
+  const size_t ell_width
+) {
+  if(ell_width == 0) {
+    return layer[num_neurons_per_layer * N_SLAB];
+  }
+  size_t nnz{0};
+  detail::for_each_packed_weight(layer, num_neurons_per_layer, N_SLAB, ell_width,
+    [&](const size_t, const int, const size_t) { ++nnz; }
+  );
+  return nnz;
+}
+
+template <typename T>
+void resection_layer(
+  const int* src,
+  const PackedLayer& src_layout,
+  const size_t num_neurons_per_layer,
+  const size_t N_SLAB,
+  const size_t ell_width,
+  int* dst,
+  const PackedLayer& dst_layout,
+  const size_t dst_N_SLAB,
+  const bool has_values
+) {
+  const size_t N = num_neurons_per_layer;
+  const size_t dst_COL_BLK = N / dst_N_SLAB;
+  const size_t dst_rows = N * dst_N_SLAB;
+
+  int* row_array = dst;
+  int* col_array = dst + dst_rows + 1;
+  const T* src_values = reinterpret_cast<const T*>(src + src_layout.index_len);
+  T* dst_values = reinterpret_cast<T*>(dst + dst_layout.index_len);
+
+  std::fill(row_array, row_array + dst_rows + 1, 0);
+  detail::for_each_packed_weight(src, N, N_SLAB, ell_width,
+    [&](const size_t r, const int col, const size_t) {
+      ++row_array[(col / dst_COL_BLK) * N + r % N + 1];
+    }
+  );
+  std::partial_sum(row_array, row_array + dst_rows + 1, row_array);
+
+  //row_array[r] is the cursor of row r, thus it ends up at the beginning of row r + 1
+  //source sections are visited in order, so sorted rows stay sorted
+  detail::for_each_packed_weight(src, N, N_SLAB, ell_width,
+    [&](const size_t r, const int col, const size_t k) {
+      int& pos = row_array[(col / dst_COL_BLK) * N + r % N];
+      col_array[pos] = col;
+      if(has_values) {
+        dst_values[pos] = src_values[k];
+      }
+      ++pos;
+    }
+  );
+  for(size_t r = dst_rows; r > 0; --r) {
+    row_array[r] = row_array[r - 1];
+  }
+  row_array[0] = 0;
+}
+
+template <typename T>
+void transpose_layer(
+  const int* src,
+  const PackedLayer& src_layout,
+  const size_t num_neurons_per_layer,
+  const size_t N_SLAB,
+  const size_t ell_width,
+  int* dst,
+  const PackedLayer& dst_layout,
+  const bool has_values
+) {
+  const size_t N = num_neurons_per_layer;
+
+  int* row_array = dst;
+  int* col_array = dst + N + 1;
+  const T* src_values = reinterpret_cast<const T*>(src + src_layout.index_len);
+  T* dst_values = reinterpret_cast<T*>(dst + dst_layout.index_len);
+
+  std::fill(row_array, row_array + N + 1, 0);
+  detail::for_each_packed_weight(src, N, N_SLAB, ell_width,
+    [&](const size_t, const int col, const size_t) {
+      ++row_array[col + 1];
+    }
+  );
+  std::partial_sum(row_array, row_array + N + 1, row_array);
+
+  //an output neuron lives in one section, whose rows are visited in input order
+  detail::for_each_packed_weight(src, N, N_SLAB, ell_width,
+    [&](const size_t r, const int col, const size_t k) {
+      int& pos = row_array[col];
+      col_array[pos] = r % N;
+      if(has_values) {
+        dst_values[pos] = src_values[k];
+      }
+      ++pos;
+    }
+  );
+  for(size_t r = N; r > 0; --r) {
+    row_array[r] = row_array[r - 1];
+  }
+  row_array[0] = 0;
+}
+
+}// end of namespace snig ----------------------------------------------
@@ -0,0 +1,109 @@
+#pragma once
+#include <experimental/filesystem>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+namespace std {
+  namespace fs = experimental::filesystem;
+}
+
+namespace snig {
+
+//data cache sizes of one core in bytes, 0 if a level does not exist
+struct CacheInfo {
+  size_t l1d{0};
+  size_t l2{0};
+  size_t l3{0};
+};
+
+//read the data caches of cpu from sysfs,
+//levels sysfs does not report fall back to sysconf, then to common sizes
+inline
+CacheInfo read_cache_info(const size_t cpu = 0);
+
+// ----------------------------------------------------------------------------
+// Definition of cache info function
+// ----------------------------------------------------------------------------
+
+namespace detail {
+
+//sysfs sizes look like "48K", "2048K", or "32M"
+inline
+size_t parse_cache_size(const std::string& s) {
+  size_t pos{0};
+  size_t size{0};
+  try {
+    size = std::stoul(s, &pos);
+  }
+  catch(...) {
+    return 0;
+  }
+  if(pos < s.size()) {
+    switch(s[pos]) {
+      case 'K': size <<= 10; break;
+      case 'M': size <<= 20; break;
+      case 'G': size <<= 30; break;
+      default: break;
+    }
+  }
+  return size;
+}
+
+}// end of namespace detail
+
+inline
+CacheInfo read_cache_info(const size_t cpu) {
+  CacheInfo info;
+
+  const std::fs::path dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cache";
+  for(size_t index = 0; ; ++index) {
+    const std::fs::path p = dir / ("index" + std::to_string(index));
+    std::ifstream level_in(p / "level");
+    std::ifstream type_in(p / "type");
+    std::ifstream size_in(p / "size");
+    if(!level_in || !type_in || !size_in) {
+      break;
+    }
+    int level{0};
+    std::string type;
+    std::string size;
+    level_in >> level;
+    type_in >> type;
+    size_in >> size;
+    if(type == "Instruction") {
+      continue;
+    }
+    switch(level) {
+      case 1: info.l1d = detail::parse_cache_size(size); break;
+      case 2: info.l2 = detail::parse_cache_size(size); break;
+      case 3: info.l3 = detail::parse_cache_size(size); break;
+      default: break;
+    }
+  }
+
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+  if(info.l1d == 0) {
+    long size = ::sysconf(_SC_LEVEL1_DCACHE_SIZE);
+    info.l1d = size > 0 ? size : 0;
+  }
+  if(info.l2 == 0) {
+    long size = ::sysconf(_SC_LEVEL2_CACHE_SIZE);
+    info.l2 = size > 0 ? size : 0;
+  }
+  if(info.l3 == 0) {
+    long size = ::sysconf(_SC_LEVEL3_CACHE_SIZE);
+    info.l3 = size > 0 ? size : 0;
+  }
+#endif
+
+  if(info.l1d == 0) {
+    info.l1d = 32 * 1024;
+  }
+  if(info.l2 == 0) {
+    info.l2 = 1024 * 1024;
+  }
+  return info;
+}
+
+}// end of namespace snig ----------------------------------------------
@@ -0,0 +1,22 @@
+#pragma once
+#include <SNIG/utility/utility.hpp>
+#include <SNIG/utility/cuda_error.hpp>
+
+namespace snig {
+
+template<typename T>
+size_t get_device_sec_size(const size_t num_neurons, const int dev = 0);
+
+//-----------------------------------------------------------------------------
+//Definition of CUDA utility function
+//-----------------------------------------------------------------------------
+
+template<typename T>
+size_t get_device_sec_size(const size_t num_neurons, const int dev) {
+  //only for the same GPUs
+  cudaDeviceProp props;
+  checkCuda(cudaGetDeviceProperties(&props, dev));
+  return get_sec_size<T>(num_neurons, props.sharedMemPerBlock);
+}
+
+}// end of namespace snig ----------------------------------------------
@@ -0,0 +1,303 @@
+#pragma once
+#include <SNIG/utility/binary_format.hpp>
+#include <SNIG/utility/batch_scheduler.hpp>
+#include <experimental/filesystem>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace std {
+  namespace fs = experimental::filesystem;
+}
+
+namespace snig {
+
+//streams an input file (sparse-images-N.b) batch by batch
+//a background I/O thread expands batches in input order into a bounded ring of buffers,
+//thus computing a batch overlaps reading the next ones,
+//and input memory is bounded by the ring instead of num_inputs * num_features
+template <typename T>
+class InputStream {
+
+  public:
+
+    struct Batch {
+      //first input of the batch
+      size_t beg{0};
+      size_t rows{0};
+      //rows * num_features values, rows * num_secs section flags
+      T* Y{nullptr};
+      bool* is_nonzero_row{nullptr};
+      size_t slot{0};
+    };
+
+    //Y[i] holds batch_size * num_features values and is_nonzero_row[i] holds
+    //batch_size * (num_features / sec_size) flags, buffers are owned by the caller,
+    //their number bounds the batches read ahead of computation
+    //batches have batch_size rows (the last one may be smaller),
+    //or as many as scheduler picks if given, which may not exceed batch_size
+    InputStream(
+      const std::fs::path& input_path,
+      const size_t num_inputs,
+      const size_t num_features,
+      const size_t sec_size,
+      const size_t batch_size,
+      const std::vector<T*>& Y,
+      const std::vector<bool*>& is_nonzero_row,
+      BatchScheduler* scheduler = nullptr
+    );
+
+    ~InputStream();
+
+    InputStream(const InputStream&) = delete;
+
+    InputStream& operator = (const InputStream&) = delete;
+
+    //take the next batch in input order, wait until it is read
+    //return false once every batch has been handed out
+    bool acquire(Batch& batch);
+
+    //hand the buffers of batch back to the I/O thread
+    void release(const Batch& batch);
+
+  private:
+
+    std::ifstream _in;
+    InputHeader _header;
+    std::streamoff _data_pos{0};
+
+    size_t _num_inputs;
+    size_t _num_features;
+    size_t _sec_size;
+    size_t _batch_size;
+    BatchScheduler* _scheduler;
+
+    //row offsets of a CSR file, column and value scratch of one batch
+    std::vector<size_t> _row_array;
+    std::vector<int> _batch_col_array;
+    std::vector<T> _batch_data_array;
+
+    std::vector<Batch> _slots;
+    std::deque<size_t> _free_slots;
+    std::deque<size_t> _ready_slots;
+    //inputs handed out by acquire
+    size_t _num_acquired{0};
+    bool _stop{false};
+    std::exception_ptr _error;
+
+    std::mutex _mutex;
+    std::condition_variable _free_cv;
+    std::condition_variable _ready_cv;
+    std::thread _io_thread;
+
+    void _read_loop();
+
+    void _read_batch(Batch& batch);
+
+};
+
+// ----------------------------------------------------------------------------
+// Definition of InputStream
+// ----------------------------------------------------------------------------
+
+template <typename T>
+InputStream<T>::InputStream(
+  const std::fs::path& input_path,
+  const size_t num_inputs,
+  const size_t num_features,
+  const size_t sec_size,
+  const size_t batch_size,
+  const std::vector<T*>& Y,
+  const std::vector<bool*>& is_nonzero_row,
+  BatchScheduler* scheduler
+) :
+  _in{input_path, std::ios::in | std::ios::binary},
+  _num_inputs{num_inputs},
+  _num_features{num_features},
+  _sec_size{sec_size},
+  _batch_size{batch_size},
+  _scheduler{scheduler}
+{
+  using namespace std::literals::string_literals;
+
+  if(!_in) {
+    throw std::runtime_error("cannot open the file"s + input_path.c_str());
+  }
+  if(Y.empty() || Y.size() != is_nonzero_row.size()) {
+    throw std::runtime_error("InputStream needs the same number of value and flag buffers"s);
+  }
+
+  _header = read_input_header(_in);
+  if(_header.rows < _num_inputs || _header.cols != _num_features) {
+    throw std::runtime_error("Input file "s + input_path.c_str() + " does not match the model");
+  }
+  if(_header.is_csr) {
+    if(_header.value_type != value_type_of<T>()) {
+      throw std::runtime_error("Value type of "s + input_path.c_str() + " does not match the engine");
+    }
+    //row offsets are small, columns and values are read per batch
+    _row_array.resize(_header.rows + 1);
+    _in.read((char*)_row_array.data(), sizeof(size_t) * (_header.rows + 1));
+    if(!_in) {
+      throw std::runtime_error("Truncated input file "s + input_path.c_str());
+    }
+    check_input_row_array(_header, _row_array.data());
+  }
+  _data_pos = _in.tellg();
+
+  _slots.resize(Y.size());
+  for(size_t i = 0; i < Y.size(); ++i) {
+    _slots[i].Y = Y[i];
+    _slots[i].is_nonzero_row = is_nonzero_row[i];
+    _slots[i].slot = i;
+    _free_slots.push_back(i);
+  }
+
+  _io_thread = std::thread([this](){ _read_loop(); });
+}
+
+template <typename T>
+InputStream<T>::~InputStream() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _free_cv.notify_all();
+  _io_thread.join();
+}
+
+template <typename T>
+bool InputStream<T>::acquire(Batch& batch) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _ready_cv.wait(lock, [&](){
+    return !_ready_slots.empty() || _error || _num_acquired == _num_inputs;
+  });
+  if(_error) {
+    std::rethrow_exception(_error);
+  }
+  if(_num_acquired == _num_inputs) {
+    return false;
+  }
+  batch = _slots[_ready_slots.front()];
+  _ready_slots.pop_front();
+
+  //wake up consumers waiting for a batch that will never come
+  _num_acquired += batch.rows;
+  if(_num_acquired == _num_inputs) {
+    lock.unlock();
+    _ready_cv.notify_all();
+  }
+  return true;
+}
+
+template <typename T>
+void InputStream<T>::release(const Batch& batch) {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _free_slots.push_back(batch.slot);
+  }
+  _free_cv.notify_one();
+}
+
+template <typename T>
+void InputStream<T>::_read_loop() {
+  try {
+    size_t rows{0};
+    for(size_t beg = 0; beg < _num_inputs; beg += rows) {
+      rows = _scheduler == nullptr ?
+        std::min(_batch_size, _num_inputs - beg) : std::min(_scheduler->next(beg), _batch_size);
+
+      size_t slot;
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _free_cv.wait(lock, [&](){ return !_free_slots.empty() || _stop; });
+        if(_stop) {
+          return;
+        }
+        slot = _free_slots.front();
+        _free_slots.pop_front();
+      }
+
+      //only this thread touches a slot between free and ready
+      _slots[slot].beg = beg;
+      _slots[slot].rows = rows;
+      _read_batch(_slots[slot]);
+
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _ready_slots.push_back(slot);
+      }
+      _ready_cv.notify_one();
+    }
+  }
+  catch(...) {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _error = std::current_exception();
+    }
+    _ready_cv.notify_all();
+  }
+}
+
+template <typename T>
+void InputStream<T>::_read_batch(Batch& batch) {
+  using namespace std::literals::string_literals;
+
+  const size_t num_secs = _num_features / _sec_size;
+  std::fill(batch.is_nonzero_row, batch.is_nonzero_row + batch.rows * num_secs, false);
+
+  if(!_header.is_csr) {
+    _in.seekg(_data_pos + std::streamoff(sizeof(T) * batch.beg * _num_features));
+    _in.read((char*)batch.Y, sizeof(T) * batch.rows * _num_features);
+    for(size_t r = 0; r < batch.rows; ++r) {
+      for(size_t c = 0; c < _num_features; ++c) {
+        if(batch.Y[r * _num_features + c] != T(0)) {
+          batch.is_nonzero_row[r * num_secs + c / _sec_size] = true;
+        }
+      }
+    }
+  }
+  else {
+    const size_t beg_nnz = _row_array[batch.beg];
+    const size_t nnz = _row_array[batch.beg + batch.rows] - beg_nnz;
+    _batch_col_array.resize(nnz);
+    _batch_data_array.resize(nnz);
+
+    const std::streamoff col_pos = _data_pos;
+    const std::streamoff data_pos = col_pos + std::streamoff(sizeof(int) * _header.nnz);
+    _in.seekg(col_pos + std::streamoff(sizeof(int) * beg_nnz));
+    _in.read((char*)_batch_col_array.data(), sizeof(int) * nnz);
+    _in.seekg(data_pos + std::streamoff(sizeof(T) * beg_nnz));
+    _in.read((char*)_batch_data_array.data(), sizeof(T) * nnz);
+    if(!_in) {
+      throw std::runtime_error("Truncated input file at input "s + std::to_string(batch.beg));
+    }
+
+    std::fill(batch.Y, batch.Y + batch.rows * _num_features, T(0));
+    for(size_t r = 0; r < batch.rows; ++r) {
+      for(size_t k = _row_array[batch.beg + r]; k < _row_array[batch.beg + r + 1]; ++k) {
+        const int col = _batch_col_array[k - beg_nnz];
+        if(col < 0 || size_t(col) >= _num_features) {
+          throw std::runtime_error(
+            "Column "s + std::to_string(col) + " out of range at input "s + std::to_string(batch.beg + r)
+          );
+        }
+        batch.Y[r * _num_features + col] = _batch_data_array[k - beg_nnz];
+        batch.is_nonzero_row[r * num_secs + col / _sec_size] = true;
+      }
+    }
+  }
+
+  if(!_in) {
+    throw std::runtime_error("Truncated input file at input "s + std::to_string(batch.beg));
+  }
+}
+
+}// end of namespace snig ----------------------------------------------
@@ -0,0 +1,177 @@
+#pragma once
+#include <SNIG/utility/binary_format.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace snig {
+
+//bounded window of packed layers resident in memory, the host analogue of SNIG's num_weight_buffers
+//a background thread loads layers in the order 0, 1, ..., num_layers - 1, 0, 1, ...
+//into a ring of num_slots buffers, thus layers L + 1 .. L + num_slots - 1 are read while L is computed
+//every pass over the model must acquire all layers in order
+class LayerWindow {
+
+  public:
+
+    //load(layer, dst) fills dst with the packed layer, dst holds slot_len ints
+    LayerWindow(
+      const size_t num_layers,
+      const size_t slot_len,
+      const size_t num_slots,
+      std::function<void(size_t, int*)> load
+    );
+
+    ~LayerWindow();
+
+    LayerWindow(const LayerWindow&) = delete;
+
+    LayerWindow& operator = (const LayerWindow&) = delete;
+
+    //wait until layer is resident, layer must be the next one of the pass
+    const int* acquire(const size_t layer);
+
+    //hand the slot of the acquired layer back to the loader
+    void release();
+
+    size_t num_slots() const;
+
+  private:
+
+    size_t _num_layers;
+    size_t _slot_stride;
+    size_t _num_slots;
+    std::function<void(size_t, int*)> _load;
+
+    //one allocation for all slots, every slot starts at a PACKED_LAYER_ALIGNMENT-byte boundary
+    std::unique_ptr<int[]> _storage;
+    int* _slots{nullptr};
+
+    //layers are numbered across passes, layer n is n % _num_layers in slot n % _num_slots
+    size_t _num_loaded{0};
+    size_t _num_released{0};
+    bool _acquired{false};
+    bool _stop{false};
+    std::exception_ptr _error;
+
+    std::mutex _mutex;
+    std::condition_variable _free_cv;
+    std::condition_variable _loaded_cv;
+    std::thread _load_thread;
+
+    void _load_loop();
+
+};
+
+// ----------------------------------------------------------------------------
+// Definition of LayerWindow
+// ----------------------------------------------------------------------------
+
+inline
+LayerWindow::LayerWindow(
+  const size_t num_layers,
+  const size_t slot_len,
+  const size_t num_slots,
+  std::function<void(size_t, int*)> load
+) :
+  _num_layers{num_layers},
+  _num_slots{num_slots},
+  _load{std::move(load)}
+{
+  using namespace std::literals::string_literals;
+
+  if(_num_layers == 0 || _num_slots == 0) {
+    throw std::runtime_error("A layer window needs at least one layer and one slot"s);
+  }
+
+  const size_t align = PACKED_LAYER_ALIGNMENT / sizeof(int);
+  _slot_stride = (slot_len + align - 1) / align * align;
+  _storage = std::make_unique<int[]>(_slot_stride * _num_slots + align);
+  const size_t misalign = reinterpret_cast<uintptr_t>(_storage.get()) % PACKED_LAYER_ALIGNMENT;
+  _slots = _storage.get() + (misalign == 0 ? 0 : (PACKED_LAYER_ALIGNMENT - misalign) / sizeof(int));
+
+  _load_thread = std::thread([this](){ _load_loop(); });
+}
+
+inline
+LayerWindow::~LayerWindow() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _free_cv.notify_all();
+  _load_thread.join();
+}
+
+inline
+const int* LayerWindow::acquire(const size_t layer) {
+  using namespace std::literals::string_literals;
+
+  std::unique_lock<std::mutex> lock(_mutex);
+  if(_acquired || layer != _num_released % _num_layers) {
+    throw std::runtime_error(
+      "Layer "s + std::to_string(layer + 1) + " is acquired out of order from the layer window"
+    );
+  }
+  _loaded_cv.wait(lock, [&](){ return _num_loaded > _num_released || _error; });
+  if(_error) {
+    std::rethrow_exception(_error);
+  }
+  _acquired = true;
+  return _slots + (_num_released % _num_slots) * _slot_stride;
+}
+
+inline
+void LayerWindow::release() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _acquired = false;
+    ++_num_released;
+  }
+  _free_cv.notify_one();
+}
+
+inline
+size_t LayerWindow::num_slots() const {
+  return _num_slots;
+}
+
+inline
+void LayerWindow::_load_loop() {
+  try {
+    for(size_t n = 0; ; ++n) {
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _free_cv.wait(lock, [&](){ return n < _num_released + _num_slots || _stop; });
+        if(_stop) {
+          return;
+        }
+      }
+
+      //only this thread touches a slot between release and load
+      _load(n % _num_layers, _slots + (n % _num_slots) * _slot_stride);
+
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _num_loaded = n + 1;
+      }
+      _loaded_cv.notify_one();
+    }
+  }
+  catch(...) {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _error = std::current_exception();
+    }
+    _loaded_cv.notify_all();
+  }
+}
+
+}// end of namespace snig ----------------------------------------------
@@ -0,0 +1,108 @@
+#pragma once
+#include <experimental/filesystem>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace std {
+  namespace fs = experimental::filesystem;
+}
+
+namespace snig {
+
+//read-only mapping of a whole file
+//pages are populated at mapping time unless populate is false,
+//so the first pass over weights does not fault
+//also used to parse tsv files in place
+class MappedFile {
+
+  public:
+
+    explicit MappedFile(const std::fs::path& path, const bool populate = true);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile& operator = (const MappedFile&) = delete;
+
+    const char* data() const;
+
+    size_t size() const;
+
+  private:
+
+    int _fd{-1};
+    void* _addr{MAP_FAILED};
+    size_t _size{0};
+
+};
+
+// ----------------------------------------------------------------------------
+// Definition of MappedFile
+// ----------------------------------------------------------------------------
+
+inline
+MappedFile::MappedFile(const std::fs::path& path, const bool populate) {
+  using namespace std::literals::string_literals;
+
+  _fd = ::open(path.c_str(), O_RDONLY);
+  if(_fd < 0) {
+    throw std::runtime_error("cannot open the file"s + path.c_str());
+  }
+
+  struct stat st;
+  if(::fstat(_fd, &st) != 0) {
+    ::close(_fd);
+    throw std::runtime_error("cannot stat the file"s + path.c_str());
+  }
+  _size = st.st_size;
+
+  //empty files cannot be mapped, data() is nullptr
+  if(_size == 0) {
+    return;
+  }
+
+  int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+  if(populate) {
+    flags |= MAP_POPULATE;
+  }
+#endif
+
+  _addr = ::mmap(nullptr, _size, PROT_READ, flags, _fd, 0);
+  if(_addr == MAP_FAILED) {
+    ::close(_fd);
+    throw std::runtime_error("cannot map the file"s + path.c_str());
+  }
+
+  //MAP_POPULATE is only a hint on some kernels
+  if(populate) {
+    ::madvise(_addr, _size, MADV_WILLNEED);
+  }
+}
+
+inline
+MappedFile::~MappedFile() {
+  if(_addr != MAP_FAILED) {
+    ::munmap(_addr, _size);
+  }
+  if(_fd >= 0) {
+    ::close(_fd);
+  }
+}
+
+inline
+const char* MappedFile::data() const {
+  return (_addr == MAP_FAILED) ? nullptr : static_cast<const char*>(_addr);
+}
+
+inline
+size_t MappedFile::size() const {
+  return _size;
+}
+
+}  // end of namespace snig
@@ -1,4 +1,5 @@
 #pragma once
+#include <vector>
 
 namespace snig{
 
@@ -22,6 +23,16 @@ namespace snig{
     T* data_array;
   };
 
+  //rows of a batch holding only their nonzeros,
+  //row r owns entries row_array[r] .. row_array[r + 1] of col_array and data_array,
+  //whose columns are sorted
+  template<typename T>
+  struct SparseRows{
+    std::vector<size_t> row_array;
+    std::vector<int> col_array;
+    std::vector<T> data_array;
+  };
+
   template <typename T>
   struct Triplet{
     int row;
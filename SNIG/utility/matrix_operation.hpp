@@ -184,7 +184,7 @@ Eigen::Matrix<int, Eigen::Dynamic, 1> arr_to_Eigen_int(
 ) {
   Eigen::Matrix<int, Eigen::Dynamic, 1> result(arr_len, 1);
   for(size_t i = 0; i < arr_len; ++i) {
-    result(i, 1) = arr[i];
+    result(i, 0) = arr[i];
   }
   return result;
 };
@@ -0,0 +1,272 @@
+#pragma once
+#include <experimental/filesystem>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+namespace std {
+  namespace fs = experimental::filesystem;
+}
+
+namespace snig {
+
+//placement of the packed weights on machines with several NUMA nodes
+//OFF leaves memory where the loading thread touched it,
+//REPLICATE gives every node its own copy, INTERLEAVE spreads one copy page by page over the nodes
+enum class NumaMode {
+  OFF,
+  REPLICATE,
+  INTERLEAVE
+};
+
+//"off", "replicate", or "interleave"
+inline
+NumaMode to_numa_mode(const std::string& name);
+
+inline
+const char* to_string(const NumaMode mode);
+
+//nodes with cpus, in sysfs order
+//machines without /sys/devices/system/node are one node holding every cpu
+struct NumaTopology {
+  std::vector<int> nodes;
+  std::vector<std::vector<int> > cpus;
+
+  size_t num_nodes() const { return nodes.size(); }
+
+  //node index of worker, workers are spread over nodes in contiguous blocks
+  size_t node_of(const size_t worker, const size_t num_workers) const {
+    return worker * num_nodes() / std::max(num_workers, size_t(1));
+  }
+};
+
+inline
+NumaTopology read_numa_topology();
+
+//counters of /sys/devices/system/node/nodeX/numastat, in pages, for all processes
+//other_node counts pages a process running on this node got from another node,
+//numa_miss counts pages meant for this node which came from another one
+struct NumaStat {
+  size_t numa_hit{0};
+  size_t numa_miss{0};
+  size_t local_node{0};
+  size_t other_node{0};
+};
+
+inline
+NumaStat read_numa_stat(const int node);
+
+//bind the calling thread to cpus, false if the kernel refused
+inline
+bool bind_thread(const std::vector<int>& cpus);
+
+//node index the calling thread was bound to by bind_worker, -1 if none
+inline
+int& this_thread_node();
+
+//bind the calling thread to the node of worker once, and return that node index
+inline
+size_t bind_worker(const NumaTopology& topology, const size_t worker, const size_t num_workers);
+
+//call f() on a thread bound to node index node, so the pages f touches first are local to node
+template <typename F>
+void run_on_node(const NumaTopology& topology, const size_t node, F&& f);
+
+//copy len bytes from src into dst, which is not touched yet,
+//page i of dst is touched first by a thread of node index i % num_nodes
+inline
+void interleave_copy(const NumaTopology& topology, void* dst, const void* src, const size_t len);
+
+// ----------------------------------------------------------------------------
+// Definition of NUMA functions
+// ----------------------------------------------------------------------------
+
+namespace detail {
+
+//sysfs cpu and node lists look like "0-3,8-11"
+inline
+std::vector<int> parse_cpu_list(const std::string& s) {
+  std::vector<int> cpus;
+  std::stringstream ss(s);
+  std::string range;
+  while(std::getline(ss, range, ',')) {
+    if(range.empty()) {
+      continue;
+    }
+    const size_t dash = range.find('-');
+    try {
+      const int beg = std::stoi(range.substr(0, dash));
+      const int end = dash == std::string::npos ? beg : std::stoi(range.substr(dash + 1));
+      for(int cpu = beg; cpu <= end; ++cpu) {
+        cpus.push_back(cpu);
+      }
+    }
+    catch(...) {
+      return {};
+    }
+  }
+  return cpus;
+}
+
+}// end of namespace detail
+
+inline
+NumaMode to_numa_mode(const std::string& name) {
+  using namespace std::literals::string_literals;
+
+  if(name == "off") {
+    return NumaMode::OFF;
+  }
+  if(name == "replicate") {
+    return NumaMode::REPLICATE;
+  }
+  if(name == "interleave") {
+    return NumaMode::INTERLEAVE;
+  }
+  throw std::runtime_error("Unknown NUMA mode "s + name + ", expected off, replicate, or interleave"s);
+}
+
+inline
+const char* to_string(const NumaMode mode) {
+  switch(mode) {
+    case NumaMode::REPLICATE: return "replicate";
+    case NumaMode::INTERLEAVE: return "interleave";
+    default: return "off";
+  }
+}
+
+inline
+NumaTopology read_numa_topology() {
+  NumaTopology topology;
+
+  const std::fs::path dir = "/sys/devices/system/node";
+  std::ifstream online_in(dir / "online");
+  std::string online;
+  online_in >> online;
+  for(const int node : detail::parse_cpu_list(online)) {
+    std::ifstream cpulist_in(dir / ("node" + std::to_string(node)) / "cpulist");
+    std::string cpulist;
+    cpulist_in >> cpulist;
+    std::vector<int> cpus = detail::parse_cpu_list(cpulist);
+    //memory-only nodes get no workers
+    if(cpus.empty()) {
+      continue;
+    }
+    topology.nodes.push_back(node);
+    topology.cpus.push_back(std::move(cpus));
+  }
+
+  if(topology.nodes.empty()) {
+    topology.nodes.push_back(0);
+    topology.cpus.emplace_back();
+    for(int cpu = 0; cpu < static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u)); ++cpu) {
+      topology.cpus.back().push_back(cpu);
+    }
+  }
+  return topology;
+}
+
+inline
+NumaStat read_numa_stat(const int node) {
+  NumaStat stat;
+  std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/numastat");
+  std::string key;
+  size_t value{0};
+  while(in >> key >> value) {
+    if(key == "numa_hit") {
+      stat.numa_hit = value;
+    }
+    else if(key == "numa_miss") {
+      stat.numa_miss = value;
+    }
+    else if(key == "local_node") {
+      stat.local_node = value;
+    }
+    else if(key == "other_node") {
+      stat.other_node = value;
+    }
+  }
+  return stat;
+}
+
+inline
+bool bind_thread(const std::vector<int>& cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for(const int cpu : cpus) {
+    if(cpu >= 0 && cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  return ::pthread_setaffinity_np(::pthread_self(), sizeof(set), &set) == 0;
+}
+
+inline
+int& this_thread_node() {
+  static thread_local int node{-1};
+  return node;
+}
+
+inline
+size_t bind_worker(const NumaTopology& topology, const size_t worker, const size_t num_workers) {
+  int& node = this_thread_node();
+  if(node < 0) {
+    node = static_cast<int>(topology.node_of(worker, num_workers));
+    bind_thread(topology.cpus[node]);
+  }
+  return node;
+}
+
+template <typename F>
+void run_on_node(const NumaTopology& topology, const size_t node, F&& f) {
+  std::thread t([&]() {
+    bind_thread(topology.cpus[node]);
+    f();
+  });
+  t.join();
+}
+
+inline
+void interleave_copy(const NumaTopology& topology, void* dst, const void* src, const size_t len) {
+  const long page = ::sysconf(_SC_PAGESIZE);
+  const uintptr_t page_size = page > 0 ? page : 4096;
+  const size_t num_nodes = topology.num_nodes();
+
+  //one thread per node copies every num_nodes-th page, counted from the first page boundary
+  std::vector<std::thread> threads;
+  threads.reserve(num_nodes);
+  for(size_t node = 0; node < num_nodes; ++node) {
+    threads.emplace_back([&, node]() {
+      bind_thread(topology.cpus[node]);
+      const uintptr_t base = reinterpret_cast<uintptr_t>(dst);
+      const uintptr_t first_page = base & ~(page_size - 1);
+      size_t i{0};
+      for(uintptr_t p = first_page; p < base + len; p += page_size, ++i) {
+        if(i % num_nodes != node) {
+          continue;
+        }
+        const uintptr_t beg = std::max(p, base);
+        const uintptr_t end = std::min(p + page_size, base + len);
+        std::memcpy(
+          reinterpret_cast<char*>(beg),
+          static_cast<const char*>(src) + (beg - base),
+          end - beg
+        );
+      }
+    });
+  }
+  for(auto& t : threads) {
+    t.join();
+  }
+}
+
+}// end of namespace snig ----------------------------------------------
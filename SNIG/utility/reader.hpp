@@ -8,7 +8,13 @@
 #include <Eigen/Dense>
 #include <vector>
 #include <string>
+#include <sstream>
+#include <cstring>
+#include <memory>
+#include <atomic>
 #include <SNIG/utility/matrix_format.h>
+#include <SNIG/utility/binary_format.hpp>
+#include <SNIG/utility/tsv_parser.hpp>
 #include <SNIG/utility/matrix_operation.hpp>
 
 namespace std {
@@ -17,6 +23,15 @@ namespace std {
 
 namespace snig {
 
+//half is only available when compiled by nvcc
+template <typename T>
+struct is_half : std::false_type {};
+
+#ifdef __CUDACC__
+template <>
+struct is_half<half> : std::true_type {};
+#endif
+
 template <typename T>
 std::enable_if_t<std::is_same<T, float>::value, float> 
 to_numeric(const std::string& str) {
@@ -29,11 +44,13 @@ to_numeric(const std::string& str) {
   return std::stod(str);
 }
 
+#ifdef __CUDACC__
 template <typename T>
-std::enable_if_t<std::is_same<T, half>::value, half> 
+std::enable_if_t<is_half<T>::value, half> 
 to_numeric(const std::string& str) {
   return __float2half(std::stof(str));
 }
+#endif
 
 template <typename T>
 Eigen::SparseMatrix<T> tsv_string_to_matrix(
@@ -110,11 +127,42 @@ template <typename T>
 void read_weight_binary(
   const std::fs::path& weight_dir,
   const size_t num_neurons_per_layer,
-  const size_t max_nnz_per_layer,
   const size_t num_layers,
   const size_t N_SLAB,
-  const size_t pad,
-  int* arr
+  const std::vector<PackedLayer>& layers,
+  int* arr,
+  const size_t ell_width = 0,
+  const bool skip_uniform_values = false
+);
+
+//read layer (0-based) of weight_dir into location, the packed layout of layer is from packed_layers<T>
+template <typename T>
+void read_weight_layer_binary(
+  const std::fs::path& weight_dir,
+  const size_t num_neurons_per_layer,
+  const size_t layer,
+  const size_t N_SLAB,
+  const PackedLayer& packed,
+  int* location,
+  const size_t ell_width = 0,
+  const bool skip_uniform_values = false
+);
+
+inline
+std::vector<WeightHeader> read_weight_headers(
+  const std::fs::path& weight_dir,
+  const size_t num_layers,
+  const size_t num_neurons_per_layer
+);
+
+template <typename T>
+void pack_weight_binary(
+  const std::fs::path& weight_dir,
+  const size_t num_neurons_per_layer,
+  const size_t num_layers,
+  const size_t N_SLAB,
+  const std::fs::path& model_path,
+  const bool with_checksum = true
 );
 
 template <typename T>
@@ -183,6 +231,34 @@ void read_input_binary(
   bool* rowsY
 );
 
+template <typename T>
+InputHeader read_input_binary(
+  const std::fs::path& input_path,
+  std::vector<size_t>& row_array,
+  std::vector<int>& col_array,
+  std::vector<T>& data_array
+);
+
+template <typename T>
+void read_input_to_dense(
+  std::istream& in,
+  const InputHeader& header,
+  T* arr
+);
+
+template <typename T>
+void expand_input_rows(
+  const size_t* row_array,
+  const int* col_array,
+  const T* data_array,
+  const size_t beg_row,
+  const size_t num_rows,
+  const size_t num_features,
+  const size_t sec_size,
+  T* arr,
+  bool* is_nonzero_row
+);
+
 inline
 Eigen::Matrix<int, Eigen::Dynamic, 1> read_golden(
   const std::fs::path& golden_path,
@@ -220,9 +296,19 @@ size_t find_max_nnz_binary(
   const size_t num_neurons_per_layer
 );
 
+inline
+size_t find_ell_width_binary(
+  const std::fs::path& weight_dir,
+  const size_t num_layers,
+  const size_t num_neurons_per_layer,
+  const size_t N_SLAB = 0
+);
+
 inline
 size_t count_nnz(const std::string& s);
 
+//layer files are plain CSC, COL_BLK is only recorded as a hint,
+//N_SLAB is the sections of the prepacked model written to model_path
 template <typename T>
 void tsv_file_to_binary_file(
   const std::fs::path& weight_dir,
@@ -231,7 +317,9 @@ void tsv_file_to_binary_file(
   const size_t cols,
   const size_t COL_BLK,
   const size_t N_SLAB,
-  const size_t estimate_nnz
+  const size_t estimate_nnz,
+  const WeightFormat format = WeightFormat::CSR,
+  const std::fs::path& model_path = std::fs::path{}
 );
 
 template <typename T>
@@ -398,37 +486,29 @@ void tsv_string_to_CSR_packed_array(
     std::is_same<T, float>::value || std::is_same<T, double>::value,
     "data type must be either float or double"
   );
-  typedef Eigen::Triplet<T> E;
-  std::string line;
-  std::vector<E> triplet_list;
-  triplet_list.reserve(nnz);
-  std::istringstream read_s(s);
-  std::vector<std::string> tokens;
-
-  while(std::getline(read_s, line)) {
-    std::istringstream lineStream(line);
-    std::string token;
-    tokens.clear();
-    while(std::getline(lineStream, token, '\t')) {
-      tokens.push_back(std::move(token));
-    }
-    triplet_list.emplace_back(
-      std::stoi(tokens[0]) - 1 + 
-      rows * ((std::stoi(tokens[1]) - 1) / COL_BLK),
-      std::stoi(tokens[1]) - 1,
-      to_numeric<T>(tokens[2])
-    );
+  std::vector<int> row_list;
+  std::vector<int> col_list;
+  std::vector<T> value_list;
+  parse_tsv_triplets<T>(s.data(), s.size(), row_list, col_list, value_list);
+  if(row_list.size() != nnz) {
+    throw std::runtime_error("tsv string holds " + std::to_string(row_list.size())
+      + " entries, but nnz is " + std::to_string(nnz));
   }
 
-  Eigen::SparseMatrix<T, Eigen::RowMajor> eigen_mat(rows * N_SLAB, cols);
-  eigen_mat.reserve(triplet_list.size());
-  eigen_mat.setFromTriplets(triplet_list.begin(), triplet_list.end());
-
-  std::copy(eigen_mat.outerIndexPtr(), eigen_mat.outerIndexPtr() + rows * N_SLAB + 1, arr);
-  std::copy(eigen_mat.innerIndexPtr(), eigen_mat.innerIndexPtr() + nnz, arr + rows * N_SLAB + 1);
+  //every section owns its own rows
+  for(size_t k = 0; k < nnz; ++k) {
+    row_list[k] += rows * (col_list[k] / COL_BLK);
+  }
 
-  T* tmp = reinterpret_cast<T*>(arr + rows * N_SLAB + 1 + nnz);
-  std::copy(eigen_mat.valuePtr(), eigen_mat.valuePtr() + nnz, tmp);
+  triplets_to_CSR(
+    row_list,
+    col_list,
+    value_list,
+    rows * N_SLAB,
+    arr,
+    arr + rows * N_SLAB + 1,
+    reinterpret_cast<T*>(arr + rows * N_SLAB + 1 + nnz)
+  );
 }
 
 template <typename T>
@@ -511,44 +591,298 @@ void read_weight(
   }
 }
 
+//ell_width == 0 packs every layer as CSR, ELL files are expanded on the fly
+//ell_width  > 0 packs every layer as ELL with ell_width slots per row, all files must be ELL
+//  with N_SLAB sections
+//files stored with other sections (e.g., plain CSC) are re-sectioned into N_SLAB sections
+//values of uniform layers are filled from the header unless skip_uniform_values is set
+//layer i is packed at arr + layers[i].offset, layers come from packed_layers<T>
+//layers are read in parallel
 template <typename T>
 void read_weight_binary(
   const std::fs::path& weight_dir,
   const size_t num_neurons_per_layer,
-  const size_t max_nnz_per_layer,
   const size_t num_layers,
   const size_t N_SLAB,
-  const size_t pad,
-  int* arr
+  const std::vector<PackedLayer>& layers,
+  int* arr,
+  const size_t ell_width,
+  const bool skip_uniform_values
 ) {
   //T is either float,double, or double type
   static_assert(
-    std::is_same<T, float>::value || std::is_same<T, double>::value || std::is_same<T, half>::value,
+    std::is_same<T, float>::value || std::is_same<T, double>::value || is_half<T>::value,
     "data type must be either float, double, or half"
   );
 
-  size_t _pp_wlen{0};
-  if(std::is_same<T, half>::value) {
-    _pp_wlen = num_neurons_per_layer * N_SLAB + 1 + max_nnz_per_layer + int(0.5 * max_nnz_per_layer) + pad;
+  //layers are disjoint, every thread takes the next unread one
+  const size_t num_threads = std::min(default_parser_threads(), num_layers);
+  std::atomic<size_t> next_layer{0};
+  detail::run_tsv_chunks(num_threads, [&](const size_t) {
+    for(size_t i = next_layer++; i < num_layers; i = next_layer++) {
+      read_weight_layer_binary<T>(
+        weight_dir,
+        num_neurons_per_layer,
+        i,
+        N_SLAB,
+        layers[i],
+        arr + layers[i].offset,
+        ell_width,
+        skip_uniform_values
+      );
+    }
+  });
+}
+
+template <typename T>
+void read_weight_layer_binary(
+  const std::fs::path& weight_dir,
+  const size_t num_neurons_per_layer,
+  const size_t layer,
+  const size_t N_SLAB,
+  const PackedLayer& packed,
+  int* location,
+  const size_t ell_width,
+  const bool skip_uniform_values
+) {
+  //T is either float,double, or double type
+  static_assert(
+    std::is_same<T, float>::value || std::is_same<T, double>::value || is_half<T>::value,
+    "data type must be either float, double, or half"
+  );
+
+  using namespace std::literals::string_literals;
+
+  const size_t COL_BLK = num_neurons_per_layer / N_SLAB;
+
+  std::fs::path p = weight_dir;
+  p /= "n" + std::to_string(num_neurons_per_layer) + "-l"
+    + std::to_string(layer + 1) + ".b";
+  std::ifstream in(p, std::ios::in | std::ios::binary);
+
+  T* val_location = reinterpret_cast<T*>(location + packed.index_len);
+
+  WeightHeader header = read_weight_header(in);
+  size_t rows = header.rows;
+  size_t nnz = header.nnz;
+
+  //read the file with its own sections, then re-section it as CSR
+  if(header.num_secs != 0 && header.num_secs != N_SLAB) {
+    if(ell_width != 0) {
+      throw std::runtime_error(
+        "Cannot pack weight file "s + p.c_str() + " with " + std::to_string(header.num_secs)
+        + " sections as ELL with " + std::to_string(N_SLAB) + " sections"
+      );
+    }
+    const size_t file_ell_width = header.format == WeightFormat::ELL ? header.width : 0;
+    const PackedLayer file_layout = packed_layers<T>(
+      {header},
+      num_neurons_per_layer,
+      header.num_secs,
+      file_ell_width,
+      skip_uniform_values
+    )[0];
+    auto file_layer = std::make_unique<int[]>(file_layout.length);
+    read_weight_layer_binary<T>(
+      weight_dir,
+      num_neurons_per_layer,
+      layer,
+      header.num_secs,
+      file_layout,
+      file_layer.get(),
+      file_ell_width,
+      skip_uniform_values
+    );
+    resection_layer<T>(
+      file_layer.get(),
+      file_layout,
+      num_neurons_per_layer,
+      header.num_secs,
+      file_ell_width,
+      location,
+      packed,
+      N_SLAB,
+      !(header.uniform && skip_uniform_values)
+    );
+    return;
   }
-  else {
-    _pp_wlen = num_neurons_per_layer * N_SLAB + 1 + max_nnz_per_layer + (sizeof(T) / sizeof(int)) * max_nnz_per_layer + pad;
+
+  //values of the file, either stored or expanded from the header
+  auto read_values = [&](T* dst, const size_t len) {
+    if(!header.uniform) {
+      in.read((char*)dst, sizeof(T) * len);
+    }
+    else if(!skip_uniform_values) {
+      std::fill(dst, dst + len, T(header.value));
+    }
+  };
+
+  if(header.format == WeightFormat::CSR) {
+    if(ell_width != 0) {
+      throw std::runtime_error("Cannot pack CSR weight file as ELL : "s + p.c_str());
+    }
+    in.read((char*)location, sizeof(int) * (rows * N_SLAB + 1 + nnz));
+    read_values(val_location, nnz);
+    return;
+  }
+
+  size_t num_slots = rows * N_SLAB * header.width;
+
+  //ELL file into ELL layout with the same width, read in place
+  if(ell_width == header.width) {
+    in.read((char*)location, sizeof(int) * num_slots);
+    read_values(val_location, num_slots);
+    return;
+  }
+
+  auto col_array = std::make_unique<int[]>(num_slots);
+  auto data_array = std::make_unique<T[]>(num_slots);
+  in.read((char*)col_array.get(), sizeof(int) * num_slots);
+  read_values(data_array.get(), num_slots);
+  const bool has_values = !(header.uniform && skip_uniform_values);
+
+  //ELL file into a wider ELL layout, re-pad every row
+  if(ell_width != 0) {
+    for(size_t r = 0; r < rows * N_SLAB; ++r) {
+      int dummy = (r / rows + 1) * COL_BLK;
+      std::copy(
+        col_array.get() + r * header.width,
+        col_array.get() + (r + 1) * header.width,
+        location + r * ell_width
+      );
+      std::fill(location + r * ell_width + header.width, location + (r + 1) * ell_width, dummy);
+      if(has_values) {
+        std::copy(
+          data_array.get() + r * header.width,
+          data_array.get() + (r + 1) * header.width,
+          val_location + r * ell_width
+        );
+        std::fill(val_location + r * ell_width + header.width, val_location + (r + 1) * ell_width, T(0));
+      }
+    }
+    return;
   }
 
+  //ELL file into CSR layout, drop the padded slots
+  int* row_location = location;
+  int* col_location = location + rows * N_SLAB + 1;
+  int k = 0;
+  row_location[0] = 0;
+  for(size_t r = 0; r < rows * N_SLAB; ++r) {
+    int dummy = (r / rows + 1) * COL_BLK;
+    for(size_t w = r * header.width; w < (r + 1) * header.width; ++w) {
+      if(col_array.get()[w] != dummy) {
+        col_location[k] = col_array.get()[w];
+        if(has_values) {
+          val_location[k] = data_array.get()[w];
+        }
+        ++k;
+      }
+    }
+    row_location[r + 1] = k;
+  }
+}
+
+inline
+std::vector<WeightHeader> read_weight_headers(
+  const std::fs::path& weight_dir,
+  const size_t num_layers,
+  const size_t num_neurons_per_layer
+) {
+  std::vector<WeightHeader> headers;
+  headers.reserve(num_layers);
   for(size_t i = 0; i < num_layers; ++i) {
     std::fs::path p = weight_dir;
     p /= "n" + std::to_string(num_neurons_per_layer) + "-l"
       + std::to_string(i + 1) + ".b";
     std::ifstream in(p, std::ios::in | std::ios::binary);
+    headers.push_back(read_weight_header(in));
+  }
+  return headers;
+}
 
-    size_t rows;
-    size_t nnz;
-    int* location = arr + i * _pp_wlen;
+//pack all layer files of weight_dir into one prepacked model file
+//layers are packed as ELL if every file is ELL, otherwise as CSR
+//with_checksum stores a checksum of every packed layer, verified at load time
+template <typename T>
+void pack_weight_binary(
+  const std::fs::path& weight_dir,
+  const size_t num_neurons_per_layer,
+  const size_t num_layers,
+  const size_t N_SLAB,
+  const std::fs::path& model_path,
+  const bool with_checksum
+) {
+  //T is either float or double type
+  static_assert(
+    std::is_same<T, float>::value || std::is_same<T, double>::value,
+    "data type must be either float or double"
+  );
 
-    in.read((char*)&rows, sizeof(size_t));
-    in.read((char*)&nnz, sizeof(size_t));
-    in.read((char*)location, sizeof(int) * (rows * N_SLAB + 1 + nnz) + sizeof(T) * nnz);
+  ModelHeader header;
+  header.value_type = static_cast<int>(value_type_of<T>());
+  header.num_neurons = num_neurons_per_layer;
+  header.num_layers = num_layers;
+  header.sec_size = num_neurons_per_layer / N_SLAB;
+  header.num_secs = N_SLAB;
+  header.ell_width = find_ell_width_binary(weight_dir, num_layers, num_neurons_per_layer, N_SLAB);
+  if(header.ell_width != 0) {
+    header.flags |= MODEL_ELL;
+  }
+  if(with_checksum) {
+    header.flags |= MODEL_CHECKSUM;
   }
+
+  //same layout as Base<T>::_load_weight, values of uniform layers are kept for GPU engines
+  auto weight_headers = read_weight_headers(weight_dir, num_layers, num_neurons_per_layer);
+  auto layers = packed_layers<T>(weight_headers, num_neurons_per_layer, N_SLAB, header.ell_width, false);
+  for(size_t i = 0; i < num_layers; ++i) {
+    header.max_nnz = std::max(header.max_nnz, weight_headers[i].nnz);
+    header.pp_wlen = std::max(header.pp_wlen, layers[i].length);
+  }
+  if(header.ell_width != 0) {
+    header.max_nnz = num_neurons_per_layer * N_SLAB * header.ell_width;
+  }
+  const size_t packed_len = num_layers == 0 ? 0 : layers.back().offset + layers.back().length;
+
+  header.table_offset = (sizeof(ModelHeader) + MODEL_TABLE_ALIGNMENT - 1)
+                      / MODEL_TABLE_ALIGNMENT * MODEL_TABLE_ALIGNMENT;
+  header.data_offset = header.table_offset + sizeof(LayerEntry) * num_layers;
+  header.data_offset = (header.data_offset + MODEL_ALIGNMENT - 1) / MODEL_ALIGNMENT * MODEL_ALIGNMENT;
+
+  std::vector<int> packed(packed_len, 0);
+  read_weight_binary<T>(
+    weight_dir,
+    num_neurons_per_layer,
+    num_layers,
+    N_SLAB,
+    layers,
+    packed.data(),
+    header.ell_width
+  );
+
+  std::vector<LayerEntry> table(num_layers);
+  for(size_t i = 0; i < num_layers; ++i) {
+    table[i].offset = sizeof(int) * layers[i].offset;
+    table[i].length = sizeof(int) * layers[i].length;
+    table[i].nnz = weight_headers[i].nnz;
+    table[i].uniform = weight_headers[i].uniform;
+    table[i].value = weight_headers[i].value;
+    if(with_checksum) {
+      table[i].checksum = layer_checksum(packed.data() + layers[i].offset, table[i].length);
+    }
+  }
+
+  std::ofstream out(model_path, std::ios::out | std::ios::binary);
+  if(!out) {
+    throw std::runtime_error("cannot write the prepacked model " + model_path.string());
+  }
+  std::vector<char> zeros(MODEL_ALIGNMENT, 0);
+  out.write((char*)&header, sizeof(ModelHeader));
+  out.write(zeros.data(), header.table_offset - sizeof(ModelHeader));
+  out.write((char*)table.data(), sizeof(LayerEntry) * num_layers);
+  out.write(zeros.data(), header.data_offset - header.table_offset - sizeof(LayerEntry) * num_layers);
+  out.write((char*)packed.data(), sizeof(int) * packed.size());
 }
 
 template<typename T>
@@ -648,17 +982,16 @@ void read_input_binary(
 ) {
   //T is either float, half, or double type
   static_assert(
-    std::is_same<T, float>::value || std::is_same<T, double>::value || std::is_same<T, half>::value,
+    std::is_same<T, float>::value || std::is_same<T, double>::value || is_half<T>::value,
     "data type must be either float, double, or half"
   );
 
   std::fs::path p = input_path;
   std::ifstream in(p, std::ios::in | std::ios::binary);
-  size_t num_inputs;
-  size_t num_features;
-  in.read((char*)&num_inputs, sizeof(size_t));
-  in.read((char*)&num_features, sizeof(size_t));
-  in.read((char*)arr, sizeof(T) * num_inputs * num_features);
+  InputHeader header = read_input_header(in);
+  size_t num_inputs = header.rows;
+  size_t num_features = header.cols;
+  read_input_to_dense<T>(in, header, arr);
 
   nerowsY = 0;
   for(size_t i = 0; i < num_inputs; ++i) {
@@ -680,17 +1013,13 @@ void read_input_binary(
 ) {
   //T is either float, half, or double type
   static_assert(
-    std::is_same<T, float>::value || std::is_same<T, double>::value || std::is_same<T, half>::value,
+    std::is_same<T, float>::value || std::is_same<T, double>::value || is_half<T>::value,
     "data type must be either float, double, or half"
   );
 
   std::fs::path p = input_path;
   std::ifstream in(p, std::ios::in | std::ios::binary);
-  size_t num_inputs;
-  size_t num_features;
-  in.read((char*)&num_inputs, sizeof(size_t));
-  in.read((char*)&num_features, sizeof(size_t));
-  in.read((char*)arr, sizeof(T) * num_inputs * num_features);
+  read_input_to_dense<T>(in, read_input_header(in), arr);
 }
 
 template <typename T>
@@ -702,17 +1031,15 @@ void read_input_binary(
 ) {
   //T is either float, half, or double type
   static_assert(
-    std::is_same<T, float>::value || std::is_same<T, double>::value || std::is_same<T, half>::value,
+    std::is_same<T, float>::value || std::is_same<T, double>::value || is_half<T>::value,
     "data type must be either float, double, or half"
   );
 
   std::fs::path p = input_path;
   std::ifstream in(p, std::ios::in | std::ios::binary);
-  size_t num_inputs;
-  size_t num_features;
-  in.read((char*)&num_inputs, sizeof(size_t));
-  in.read((char*)&num_features, sizeof(size_t));
-  in.read((char*)arr, sizeof(T) * num_inputs * num_features);
+  InputHeader header = read_input_header(in);
+  size_t num_features = header.cols;
+  read_input_to_dense<T>(in, header, arr);
 
   for(size_t i = 0; i < batch_size; ++i) {
     auto it  = std::find_if(
@@ -724,6 +1051,135 @@ void read_input_binary(
   }
 }
 
+//read an input file as CSR, dense files are compressed row by row
+template <typename T>
+InputHeader read_input_binary(
+  const std::fs::path& input_path,
+  std::vector<size_t>& row_array,
+  std::vector<int>& col_array,
+  std::vector<T>& data_array
+) {
+  //T is either float, half, or double type
+  static_assert(
+    std::is_same<T, float>::value || std::is_same<T, double>::value || is_half<T>::value,
+    "data type must be either float, double, or half"
+  );
+
+  using namespace std::literals::string_literals;
+
+  std::ifstream in(input_path, std::ios::in | std::ios::binary);
+  if(!in) {
+    throw std::runtime_error("cannot open the file"s + input_path.c_str());
+  }
+  InputHeader header = read_input_header(in);
+
+  if(header.is_csr) {
+    if(header.value_type != value_type_of<T>()) {
+      throw std::runtime_error("Value type of "s + input_path.c_str() + " does not match the engine");
+    }
+    row_array.resize(header.rows + 1);
+    col_array.resize(header.nnz);
+    data_array.resize(header.nnz);
+    in.read((char*)row_array.data(), sizeof(size_t) * (header.rows + 1));
+    in.read((char*)col_array.data(), sizeof(int) * header.nnz);
+    in.read((char*)data_array.data(), sizeof(T) * header.nnz);
+    if(!in) {
+      throw std::runtime_error("Truncated input file "s + input_path.c_str());
+    }
+    check_input_row_array(header, row_array.data());
+    for(const int col : col_array) {
+      if(col < 0 || size_t(col) >= header.cols) {
+        throw std::runtime_error("Column "s + std::to_string(col) + " out of range in "s + input_path.c_str());
+      }
+    }
+    return header;
+  }
+
+  row_array.assign(1, 0);
+  row_array.reserve(header.rows + 1);
+  col_array.clear();
+  data_array.clear();
+  std::vector<T> row(header.cols);
+  for(size_t r = 0; r < header.rows; ++r) {
+    in.read((char*)row.data(), sizeof(T) * header.cols);
+    for(size_t c = 0; c < header.cols; ++c) {
+      if(row[c] != T(0)) {
+        col_array.push_back(c);
+        data_array.push_back(row[c]);
+      }
+    }
+    row_array.push_back(col_array.size());
+  }
+  header.nnz = col_array.size();
+  return header;
+}
+
+template <typename T>
+void read_input_to_dense(
+  std::istream& in,
+  const InputHeader& header,
+  T* arr
+) {
+  using namespace std::literals::string_literals;
+
+  if(!header.is_csr) {
+    in.read((char*)arr, sizeof(T) * header.rows * header.cols);
+    return;
+  }
+
+  if(header.value_type != value_type_of<T>()) {
+    throw std::runtime_error("Value type of the input file does not match the engine"s);
+  }
+
+  std::vector<size_t> row_array(header.rows + 1);
+  std::vector<int> col_array(header.nnz);
+  std::vector<T> data_array(header.nnz);
+  in.read((char*)row_array.data(), sizeof(size_t) * (header.rows + 1));
+  in.read((char*)col_array.data(), sizeof(int) * header.nnz);
+  in.read((char*)data_array.data(), sizeof(T) * header.nnz);
+  if(!in) {
+    throw std::runtime_error("Truncated input file"s);
+  }
+  check_input_row_array(header, row_array.data());
+  for(const int col : col_array) {
+    if(col < 0 || size_t(col) >= header.cols) {
+      throw std::runtime_error("Column "s + std::to_string(col) + " out of range in the input file"s);
+    }
+  }
+
+  std::fill(arr, arr + header.rows * header.cols, T(0));
+  for(size_t r = 0; r < header.rows; ++r) {
+    for(size_t k = row_array[r]; k < row_array[r + 1]; ++k) {
+      arr[r * header.cols + col_array[k]] = data_array[k];
+    }
+  }
+}
+
+//expand rows [beg_row, beg_row + num_rows) of a CSR input into a dense batch
+//is_nonzero_row marks sections holding at least one nonzero
+template <typename T>
+void expand_input_rows(
+  const size_t* row_array,
+  const int* col_array,
+  const T* data_array,
+  const size_t beg_row,
+  const size_t num_rows,
+  const size_t num_features,
+  const size_t sec_size,
+  T* arr,
+  bool* is_nonzero_row
+) {
+  const size_t num_secs = num_features / sec_size;
+  std::fill(arr, arr + num_rows * num_features, T(0));
+  std::fill(is_nonzero_row, is_nonzero_row + num_rows * num_secs, false);
+  for(size_t r = 0; r < num_rows; ++r) {
+    for(size_t k = row_array[beg_row + r]; k < row_array[beg_row + r + 1]; ++k) {
+      arr[r * num_features + col_array[k]] = data_array[k];
+      is_nonzero_row[r * num_secs + col_array[k] / sec_size] = true;
+    }
+  }
+}
+
 inline
 Eigen::Matrix<int, Eigen::Dynamic, 1> read_golden(
   const std::fs::path& golden_path,
@@ -833,15 +1289,39 @@ size_t find_max_nnz_binary(
       + std::to_string(i + 1) + ".b";
     std::ifstream in(p, std::ios::in | std::ios::binary);
 
-    size_t nnz;
-    size_t rows;
-    in.read((char*)&rows, sizeof(size_t));
-    in.read((char*)&nnz, sizeof(size_t));
-    max_nnz = std::max(max_nnz, nnz);
+    max_nnz = std::max(max_nnz, read_weight_header(in).nnz);
   }
 
   return max_nnz;
 }
+
+//return the widest ELL row among all layers
+//return 0 if any layer is stored as CSR, or with other sections than N_SLAB (unless N_SLAB is 0),
+//since ELL rows re-sectioned at load time would keep the width of a whole column
+inline
+size_t find_ell_width_binary(
+  const std::fs::path& weight_dir,
+  const size_t num_layers,
+  const size_t num_neurons_per_layer,
+  const size_t N_SLAB
+) {
+  size_t width{0};
+  for(size_t i = 0; i < num_layers; ++i) {
+    std::fs::path p = weight_dir;
+    p /= "n" + std::to_string(num_neurons_per_layer) + "-l"
+      + std::to_string(i + 1) + ".b";
+    std::ifstream in(p, std::ios::in | std::ios::binary);
+
+    WeightHeader header = read_weight_header(in);
+    if(header.format != WeightFormat::ELL || (N_SLAB != 0 && header.num_secs != N_SLAB)) {
+      return 0;
+    }
+    width = std::max(width, header.width);
+  }
+
+  return width;
+}
+
 inline
 size_t count_nnz(const std::string& s) {
   return std::count(s.begin(), s.end(), '\n');
@@ -855,70 +1335,116 @@ void tsv_file_to_binary_file(
   const size_t cols,
   const size_t COL_BLK,
   const size_t N_SLAB,
-  const size_t estimate_nnz
+  const size_t estimate_nnz,
+  const WeightFormat format,
+  const std::fs::path& model_path
 ) {
   //T is either float, half, or double type
   static_assert(
-    std::is_same<T, float>::value || std::is_same<T, double>::value || std::is_same<T, half>::value,
+    std::is_same<T, float>::value || std::is_same<T, double>::value || is_half<T>::value,
     "data type must be either float, double, or half"
   );
 
-  std::vector<Triplet<T> > triplets;
-  triplets.reserve(estimate_nnz);
+  //parsed entries are reused across layers
+  std::vector<int> row_list;
+  std::vector<int> col_list;
+  std::vector<T> value_list;
+  row_list.reserve(estimate_nnz);
+  col_list.reserve(estimate_nnz);
+  value_list.reserve(estimate_nnz);
 
   for(size_t i = 0; i < num_layers; ++i) {
-    triplets.clear();
     std::fs::path p = weight_dir;
     p /= "n" + std::to_string(cols) + "-l"
       + std::to_string(i + 1) + ".tsv";
-    std::stringstream read_s = read_file_to_sstream(p);
-    std::vector<std::string> tokens;
-    std::string line;
-
-    while(std::getline(read_s, line)) {
-      std::istringstream lineStream(line);
-      std::string token;
-      tokens.clear();
-      while(std::getline(lineStream, token, '\t')) {
-        tokens.push_back(std::move(token));
-      }
-      triplets.emplace_back(
-        std::stoi(tokens[0]) - 1 + rows * ((std::stoi(tokens[1]) - 1) / COL_BLK),
-        std::stoi(tokens[1]) - 1,
-        to_numeric<T>(tokens[2])
-      );
-    }
+    parse_tsv_triplets<T>(p, row_list, col_list, value_list);
+    size_t nnz = row_list.size();
 
-    std::sort(triplets.begin(), triplets.end());
-    size_t nnz = triplets.size();
-
-    auto row_array = std::make_unique<int[]>(rows * N_SLAB + 1);
+    auto row_array = std::make_unique<int[]>(rows + 1);
     auto col_array = std::make_unique<int[]>(nnz);
     auto data_array = std::make_unique<T[]>(nnz);
-    
-    std::memset(row_array.get(), 0, sizeof(int) * (rows * N_SLAB + 1));
-    
-    for(size_t j = 0 ; j < nnz; ++j) {
-      ++row_array.get()[triplets[j].row + 1];
-      col_array.get()[j] = triplets[j].col;
-      data_array.get()[j] = triplets[j].value;
-    }
 
-    std::partial_sum(row_array.get(), row_array.get() + rows * N_SLAB + 1, row_array.get());
+    triplets_to_CSR(
+      row_list,
+      col_list,
+      value_list,
+      rows,
+      row_array.get(),
+      col_array.get(),
+      data_array.get()
+    );
 
     std::fs::path output_file = weight_dir;
     output_file /= "n" + std::to_string(cols) + "-l"
       + std::to_string(i + 1) + ".b";
 
+    WeightHeader header;
+    header.format = format;
+    header.rows = rows;
+    header.nnz = nnz;
+    header.num_secs = 1;
+    header.sec_size = COL_BLK;
+
+    //a layer whose weights all equal the same power of two only stores the sparsity pattern
+    header.uniform = nnz > 0 && is_exact_scaling(data_array.get()[0]) && std::all_of(
+      data_array.get(),
+      data_array.get() + nnz,
+      [&](const T v) { return v == data_array.get()[0]; }
+    );
+    if(header.uniform) {
+      header.value = data_array.get()[0];
+    }
+
     std::ofstream out(output_file, std::ios::out | std::ios::binary);
-    out.write((char*)&rows, sizeof(size_t));
-    out.write((char*)&nnz, sizeof(size_t));
-    out.write((char*)row_array.get(), sizeof(int) * (rows * N_SLAB + 1));
-    out.write((char*)col_array.get(), sizeof(int) * (nnz));
-    out.write((char*)data_array.get(), sizeof(T) * (nnz));
+
+    if(format == WeightFormat::CSR) {
+      write_weight_header(out, header);
+      out.write((char*)row_array.get(), sizeof(int) * (rows + 1));
+      out.write((char*)col_array.get(), sizeof(int) * (nnz));
+      if(!header.uniform) {
+        out.write((char*)data_array.get(), sizeof(T) * (nnz));
+      }
+      continue;
+    }
+
+    //ELL width is the longest row rounded up to a power of two,
+    //thus kernels only need a few compile-time widths
+    int max_len{0};
+    for(size_t r = 0; r < rows; ++r) {
+      max_len = std::max(max_len, row_array.get()[r + 1] - row_array.get()[r]);
+    }
+    header.width = 1;
+    while(header.width < size_t(max_len)) {
+      header.width <<= 1;
+    }
+
+    size_t num_slots = rows * header.width;
+    auto ell_col_array = std::make_unique<int[]>(num_slots);
+    auto ell_data_array = std::make_unique<T[]>(num_slots);
+    for(size_t r = 0; r < rows; ++r) {
+      int dummy = cols;
+      size_t w = r * header.width;
+      for(int k = row_array.get()[r]; k < row_array.get()[r + 1]; ++k, ++w) {
+        ell_col_array.get()[w] = col_array.get()[k];
+        ell_data_array.get()[w] = data_array.get()[k];
+      }
+      for(; w < (r + 1) * header.width; ++w) {
+        ell_col_array.get()[w] = dummy;
+        ell_data_array.get()[w] = T(0);
+      }
+    }
+
+    write_weight_header(out, header);
+    out.write((char*)ell_col_array.get(), sizeof(int) * num_slots);
+    if(!header.uniform) {
+      out.write((char*)ell_data_array.get(), sizeof(T) * num_slots);
+    }
   }
 
-  
+  //bundle the converted layers into one model file
+  if(!model_path.empty()) {
+    pack_weight_binary<T>(weight_dir, cols, num_layers, N_SLAB, model_path);
+  }
 }
 
 template <typename T>
@@ -929,36 +1455,46 @@ void tsv_file_to_binary_file(
 ) {
   //T is either float, half, or double type
   static_assert(
-    std::is_same<T, float>::value || std::is_same<T, double>::value || std::is_same<T, half>::value,
+    std::is_same<T, float>::value || std::is_same<T, double>::value || is_half<T>::value,
     "data type must be either float, double, or half"
   );
 
   input_path /= "sparse-images-" + std::to_string(cols) + ".tsv";
 
-  auto data_array = std::make_unique<T[]>(rows * cols);
-  std::memset(data_array.get(), 0, sizeof(T) * rows * cols);
-
-  std::stringstream read_s = read_file_to_sstream(input_path);
-  std::vector<std::string> tokens;
-  std::string line;
-  std::string token;
-
-  while(std::getline(read_s, line)) {
-    std::istringstream lineStream(line);
-    tokens.clear();
-    while(std::getline(lineStream, token, '\t')) {
-      tokens.push_back(std::move(token));
-    }
-    *(data_array.get() + (std::stoi(tokens[0]) - 1) * cols + std::stoi(tokens[1]) - 1) = to_numeric<T>(tokens[2]);
-  }
+  std::vector<int> row_list;
+  std::vector<int> col_list;
+  std::vector<T> value_list;
+  parse_tsv_triplets<T>(input_path, row_list, col_list, value_list);
+
+  //images are stored as CSR, rows are expanded by engines when needed
+  InputHeader header;
+  header.is_csr = true;
+  header.value_type = value_type_of<T>();
+  header.rows = rows;
+  header.cols = cols;
+  header.nnz = row_list.size();
+
+  std::vector<size_t> row_array(rows + 1, 0);
+  std::vector<int> col_array(header.nnz);
+  std::vector<T> data_array(header.nnz);
+  triplets_to_CSR(
+    row_list,
+    col_list,
+    value_list,
+    rows,
+    row_array.data(),
+    col_array.data(),
+    data_array.data()
+  );
 
   std::fs::path p = input_path.parent_path();
   p /= "sparse-images-" + std::to_string(cols) + ".b";
 
   std::ofstream out(p, std::ios::out | std::ios::binary);
-  out.write((char*)&rows, sizeof(size_t));
-  out.write((char*)&cols, sizeof(size_t));
-  out.write((char*)data_array.get(), sizeof(T) * (rows * cols));
+  write_input_header(out, header);
+  out.write((char*)row_array.data(), sizeof(size_t) * (rows + 1));
+  out.write((char*)col_array.data(), sizeof(int) * header.nnz);
+  out.write((char*)data_array.data(), sizeof(T) * header.nnz);
 }
 
 inline
@@ -969,15 +1505,18 @@ void tsv_file_to_binary_file(
   const size_t rows
 ) {
 
-  std::string line;
   golden_path /= "neuron" + std::to_string(num_features) + "-l" + std::to_string(num_layers) + "-categories.tsv";
-  std::stringstream read_s = read_file_to_sstream(golden_path);
+  std::vector<int> categories;
+  parse_tsv_integers(golden_path, categories);
 
   Eigen::Matrix<int, Eigen::Dynamic, 1> golden = Eigen::Matrix<int, Eigen::Dynamic, 1>::Zero(rows, 1);
 
-  while(std::getline(read_s, line)) {
-    golden(std::stoi(line) - 1, 0) = 1;
-  }   
+  for(const int c : categories) {
+    if(c < 1 || size_t(c) > rows) {
+      throw std::runtime_error("Category " + std::to_string(c) + " is out of range in " + golden_path.string());
+    }
+    golden(c - 1, 0) = 1;
+  }
 
   auto p = golden_path.parent_path();
   p /= "neuron" + std::to_string(num_features) + "-l" + std::to_string(num_layers) + "-categories.b";
@@ -1039,7 +1578,7 @@ void diagonal_to_binary_file(
 ) {
   //T is either float, half, or double type
   static_assert(
-    std::is_same<T, float>::value || std::is_same<T, double>::value || std::is_same<T, half>::value,
+    std::is_same<T, float>::value || std::is_same<T, double>::value || is_half<T>::value,
     "data type must be either float, double, or half"
   );
 
@@ -1,11 +1,17 @@
 #pragma once
-#include <thrust/scan.h>
 #include <Eigen/SparseCore>
 #include <Eigen/Dense>
+#include <numeric>
+#include <iostream>
 #include <SNIG/utility/matrix_format.h>
 
+#ifdef __CUDACC__
+#include <thrust/scan.h>
+#endif
+
 namespace snig {
 
+#ifdef __CUDACC__
 template<typename T>
 __global__
 void identify(
@@ -14,6 +20,7 @@ void identify(
   const size_t num_neurons_per_layer,
   int* result_arr
 );
+#endif
 
 template<typename T>
 Eigen::Matrix<int, Eigen::Dynamic, 1> get_score(
@@ -45,6 +52,7 @@ bool is_passed(
 //Definition of scoring function
 //-----------------------------------------------------------------------------
 
+#ifdef __CUDACC__
 template<typename T>
 __global__
 void identify(
@@ -65,6 +73,7 @@ void identify(
     result_arr[i] = sum > 0 ? 1 : 0;
   }
 };
+#endif
 
 
 template<typename T>
@@ -0,0 +1,142 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+namespace snig {
+
+//bounded lock-free ring between one producer thread and one consumer thread
+//indices only grow, each side owns one of them and keeps a copy of the other,
+//which it refreshes only when the ring looks full (producer) or empty (consumer),
+//thus both sides share a cache line only when they are about to meet
+template <typename T>
+class SPSCQueue {
+
+  public:
+
+    //holds at least capacity items
+    explicit SPSCQueue(const size_t capacity);
+
+    SPSCQueue(const SPSCQueue&) = delete;
+    SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+    size_t capacity() const noexcept;
+
+    //producer only, false if full
+    bool try_push(const T& item);
+
+    //consumer only, false if empty
+    bool try_pop(T& item);
+
+    //producer only, yield until there is room
+    void push(const T& item);
+
+    //consumer only, yield until there is an item
+    void pop(T& item);
+
+    //producer only, yield until there is room or abort is set, false if aborted
+    bool push(const T& item, const std::atomic<bool>& abort);
+
+    //consumer only, yield until there is an item or abort is set, false if aborted
+    bool pop(T& item, const std::atomic<bool>& abort);
+
+  private:
+
+    size_t _capacity;
+    size_t _mask;
+    std::unique_ptr<T[]> _items;
+
+    //next item to pop, and the consumer's copy of _tail
+    alignas(64) std::atomic<size_t> _head{0};
+    size_t _cached_tail{0};
+
+    //next item to push, and the producer's copy of _head
+    alignas(64) std::atomic<size_t> _tail{0};
+    size_t _cached_head{0};
+};
+
+// ----------------------------------------------------------------------------
+// Definition of SPSCQueue
+// ----------------------------------------------------------------------------
+
+template <typename T>
+SPSCQueue<T>::SPSCQueue(const size_t capacity) {
+  _capacity = 1;
+  while(_capacity < capacity) {
+    _capacity <<= 1;
+  }
+  _mask = _capacity - 1;
+  _items.reset(new T[_capacity]);
+}
+
+template <typename T>
+size_t SPSCQueue<T>::capacity() const noexcept {
+  return _capacity;
+}
+
+template <typename T>
+bool SPSCQueue<T>::try_push(const T& item) {
+  const size_t tail = _tail.load(std::memory_order_relaxed);
+  if(tail - _cached_head == _capacity) {
+    _cached_head = _head.load(std::memory_order_acquire);
+    if(tail - _cached_head == _capacity) {
+      return false;
+    }
+  }
+  _items[tail & _mask] = item;
+  _tail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+bool SPSCQueue<T>::try_pop(T& item) {
+  const size_t head = _head.load(std::memory_order_relaxed);
+  if(head == _cached_tail) {
+    _cached_tail = _tail.load(std::memory_order_acquire);
+    if(head == _cached_tail) {
+      return false;
+    }
+  }
+  item = _items[head & _mask];
+  _head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+void SPSCQueue<T>::push(const T& item) {
+  while(!try_push(item)) {
+    std::this_thread::yield();
+  }
+}
+
+template <typename T>
+void SPSCQueue<T>::pop(T& item) {
+  while(!try_pop(item)) {
+    std::this_thread::yield();
+  }
+}
+
+template <typename T>
+bool SPSCQueue<T>::push(const T& item, const std::atomic<bool>& abort) {
+  while(!try_push(item)) {
+    if(abort.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    std::this_thread::yield();
+  }
+  return true;
+}
+
+template <typename T>
+bool SPSCQueue<T>::pop(T& item, const std::atomic<bool>& abort) {
+  while(!try_pop(item)) {
+    if(abort.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    std::this_thread::yield();
+  }
+  return true;
+}
+
+}// end of namespace snig ----------------------------------------------
@@ -4,89 +4,591 @@
 #include <thread>
 #include <functional>
 #include <future>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <stdexcept>
+#include <type_traits>
+#include <algorithm>
+#include <iterator>
+#include <new>
+#include <cstddef>
+#include <cstdint>
 
 #include <vector>
-#include <queue>
+#include <deque>
+#include <memory>
 
-class ThreadPool {
+//Chase-Lev deque of pointers
+//the owner pushes and pops at the bottom, other threads steal at the top,
+//only the last item is contended and none of them take a lock
+//arrays outgrown by the owner are kept until destruction since thieves may still read them
+template <typename T>
+class WorkStealingQueue {
+
+  static_assert(std::is_pointer<T>::value, "items must be pointers");
+
+  public:
+
+    explicit WorkStealingQueue(const int64_t capacity = 1024);
+    ~WorkStealingQueue();
+
+    WorkStealingQueue(const WorkStealingQueue&) = delete;
+    WorkStealingQueue& operator=(const WorkStealingQueue&) = delete;
+
+    bool empty() const noexcept;
+
+    //owner only
+    void push(T item);
+
+    //owner only, false if empty
+    bool pop(T& item);
+
+    //any thread, false if empty or lost to another thread
+    bool steal(T& item);
+
+  private:
+
+    struct Array {
+      int64_t capacity;
+      int64_t mask;
+      std::unique_ptr<std::atomic<T>[]> items;
+
+      explicit Array(const int64_t c):
+        capacity{c}, mask{c - 1}, items{new std::atomic<T>[c]} {
+      }
 
+      void put(const int64_t i, T item) noexcept {
+        items[i & mask].store(item, std::memory_order_relaxed);
+      }
+
+      T get(const int64_t i) const noexcept {
+        return items[i & mask].load(std::memory_order_relaxed);
+      }
+    };
+
+    alignas(64) std::atomic<int64_t> _top;
+    alignas(64) std::atomic<int64_t> _bottom;
+    std::atomic<Array*> _array;
+    std::vector<std::unique_ptr<Array> > _garbage;
+};
+
+//work-stealing thread pool
+//every worker owns a WorkStealingQueue, tasks enqueued by a worker go to its own queue,
+//tasks enqueued by other threads go to a shared queue taken under one lock per enqueue call,
+//idle workers steal from the others before they sleep
+//the destructor runs all tasks enqueued before it
+class ThreadPool {
 
   public:
 
     ThreadPool(size_t num_workers);
     ~ThreadPool();
 
+    size_t num_workers() const noexcept;
+
     // study universal/forwarding reference
     template <typename C, typename ...Args>
-    auto enqueue (C&& callable, Args&&... args); 
+    auto enqueue (C&& callable, Args&&... args);
+
+    //enqueue every callable of [first, last) with one lock and one wake-up,
+    //the future is ready once all of them ran, and holds the first exception thrown
+    template <typename I>
+    std::future<void> enqueue_bulk(I first, I last);
+
+    //callable(i) for every i in [beg, end), in chunks of chunk_size indices
+    //(0 splits the range into four chunks per worker)
+    //the calling thread runs tasks until all chunks are done, thus workers may call it as well
+    template <typename C>
+    void parallel_for(size_t beg, size_t end, C&& callable, size_t chunk_size = 0);
 
   private:
 
+    //type-erased callable stored inline if it fits, on the heap otherwise
+    class Task {
+
+      public:
+
+        template <typename C>
+        explicit Task(C&& callable);
+        ~Task();
+
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        void operator()();
+
+      private:
+
+        //a packaged_task or a lambda capturing a few pointers fits
+        static constexpr size_t INLINE_SIZE = 48;
+
+        typename std::aligned_storage<INLINE_SIZE, alignof(std::max_align_t)>::type _storage;
+        void* _callable;
+        void (*_invoke)(void*);
+        void (*_destroy)(void*, bool);
+    };
+
+    struct Worker {
+      ThreadPool* pool;
+      size_t id;
+      uint64_t seed;
+    };
+
+    //rounds of stealing before a worker sleeps
+    static constexpr size_t NUM_SPINS = 64;
+
     std::vector<std::thread> _workers;
-    std::queue<std::function<void()> > _jobs;
+    std::vector<std::unique_ptr<WorkStealingQueue<Task*> > > _queues;
+
+    //tasks enqueued by threads outside the pool, guarded by _jobs_mutex
+    std::deque<Task*> _jobs;
+    std::atomic<size_t> _num_jobs{0};
 
     std::mutex _jobs_mutex;
     std::condition_variable cv;
+    std::atomic<size_t> _num_sleeping{0};
     bool _stop;
+
+    static Worker*& _this_worker();
+
+    void _run(Worker& worker);
+
+    void _push(std::vector<Task*>& tasks);
+
+    Task* _find_task(Worker* worker);
+
+    bool _has_task();
 };
 
+// ----------------------------------------------------------------------------
+// Definition of WorkStealingQueue
+// ----------------------------------------------------------------------------
+
+template <typename T>
+WorkStealingQueue<T>::WorkStealingQueue(const int64_t capacity) {
+  if(capacity <= 0 || (capacity & (capacity - 1)) != 0) {
+    throw std::runtime_error("capacity of WorkStealingQueue must be a power of 2");
+  }
+  _top.store(0, std::memory_order_relaxed);
+  _bottom.store(0, std::memory_order_relaxed);
+  _array.store(new Array{capacity}, std::memory_order_relaxed);
+}
+
+template <typename T>
+WorkStealingQueue<T>::~WorkStealingQueue() {
+  delete _array.load();
+}
+
+template <typename T>
+bool WorkStealingQueue<T>::empty() const noexcept {
+  const int64_t b = _bottom.load(std::memory_order_relaxed);
+  const int64_t t = _top.load(std::memory_order_relaxed);
+  return b <= t;
+}
+
+template <typename T>
+void WorkStealingQueue<T>::push(T item) {
+  const int64_t b = _bottom.load(std::memory_order_relaxed);
+  const int64_t t = _top.load(std::memory_order_acquire);
+  Array* a = _array.load(std::memory_order_relaxed);
+
+  if(a->capacity - 1 < b - t) {
+    Array* grown = new Array{2 * a->capacity};
+    for(int64_t i = t; i != b; ++i) {
+      grown->put(i, a->get(i));
+    }
+    _garbage.emplace_back(a);
+    a = grown;
+    _array.store(a, std::memory_order_release);
+  }
+
+  a->put(b, item);
+  _bottom.store(b + 1, std::memory_order_release);
+}
+
+template <typename T>
+bool WorkStealingQueue<T>::pop(T& item) {
+  const int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+  Array* a = _array.load(std::memory_order_relaxed);
+  _bottom.store(b, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t t = _top.load(std::memory_order_relaxed);
+
+  if(t > b) {
+    _bottom.store(b + 1, std::memory_order_relaxed);
+    return false;
+  }
+
+  item = a->get(b);
+  if(t == b) {
+    //the last item, race against thieves
+    const bool won = _top.compare_exchange_strong(
+      t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed
+    );
+    _bottom.store(b + 1, std::memory_order_relaxed);
+    return won;
+  }
+  return true;
+}
+
+template <typename T>
+bool WorkStealingQueue<T>::steal(T& item) {
+  int64_t t = _top.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  const int64_t b = _bottom.load(std::memory_order_acquire);
+
+  if(t >= b) {
+    return false;
+  }
+
+  Array* a = _array.load(std::memory_order_acquire);
+  item = a->get(t);
+  return _top.compare_exchange_strong(
+    t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed
+  );
+}
+
+// ----------------------------------------------------------------------------
+// Definition of ThreadPool::Task
+// ----------------------------------------------------------------------------
+
+template <typename C>
+ThreadPool::Task::Task(C&& callable) {
+  using F = typename std::decay<C>::type;
+  constexpr bool is_inline = sizeof(F) <= INLINE_SIZE && alignof(F) <= alignof(std::max_align_t);
+
+  if(is_inline) {
+    _callable = new (&_storage) F(std::forward<C>(callable));
+  }
+  else {
+    _callable = new F(std::forward<C>(callable));
+  }
+  _invoke = [](void* f) {
+    (*static_cast<F*>(f))();
+  };
+  _destroy = [](void* f, bool in_place) {
+    if(in_place) {
+      static_cast<F*>(f)->~F();
+    }
+    else {
+      delete static_cast<F*>(f);
+    }
+  };
+}
+
+inline
+ThreadPool::Task::~Task() {
+  _destroy(_callable, _callable == static_cast<void*>(&_storage));
+}
+
+inline
+void ThreadPool::Task::operator()() {
+  _invoke(_callable);
+}
+
+// ----------------------------------------------------------------------------
+// Definition of ThreadPool
+// ----------------------------------------------------------------------------
+
 inline
 ThreadPool::ThreadPool(size_t num_workers)
 : _stop(false)
 {
+  _queues.reserve(num_workers);
+  for(size_t i=0; i<num_workers; ++i){
+    _queues.emplace_back(std::make_unique<WorkStealingQueue<Task*> >());
+  }
+
   _workers.reserve(num_workers);
   for(size_t i=0; i<num_workers; ++i){
     _workers.emplace_back(
-        [this] {
-          while(true){
-            std::function<void()> job;
-            {
-              std::unique_lock<std::mutex> lock(_jobs_mutex);
-              cv.wait(lock, [this]{return this->_stop || (!this->_jobs.empty());});
-              if(_stop && _jobs.empty()){
-                return;
-              }
-              job = std::move(this->_jobs.front());
-              this->_jobs.pop();
-            }
-            job();
-          }
+        [this, i] {
+          Worker worker{this, i, i * 0x9E3779B97F4A7C15ull + 1};
+          _this_worker() = &worker;
+          _run(worker);
+          _this_worker() = nullptr;
         }
     );
   }
 }
 
+inline
+ThreadPool::~ThreadPool(){
+  {
+    std::unique_lock<std::mutex> lock(_jobs_mutex);
+    _stop = true;
+  }
+  cv.notify_all();
+  for(auto &worker:_workers){
+    worker.join();
+  }
+}
+
+inline
+size_t ThreadPool::num_workers() const noexcept {
+  return _workers.size();
+}
+
+inline
+ThreadPool::Worker*& ThreadPool::_this_worker() {
+  static thread_local Worker* worker{nullptr};
+  return worker;
+}
+
 template<typename C, typename ...Args>
 auto ThreadPool::enqueue(C&& callable, Args&&... args){
   using return_type = typename std::result_of<C(Args...)>::type;
 
-  auto task = std::make_shared<std::packaged_task<return_type()> >(
+  //the packaged_task is stored inside the Task, no shared_ptr is needed
+  std::packaged_task<return_type()> task(
       std::bind(std::forward<C>(callable), std::forward<Args>(args)...)
   );
+  auto result = task.get_future();
+
+  std::vector<Task*> tasks{new Task(std::move(task))};
+  _push(tasks);
+
+  return result;
+}
+
+template <typename I>
+std::future<void> ThreadPool::enqueue_bulk(I first, I last) {
+  //shared by the tasks of one call, freed by the last one
+  struct Bulk {
+    std::atomic<size_t> num_left;
+    std::promise<void> done;
+    std::mutex error_mutex;
+    std::exception_ptr error;
+  };
+
+  const size_t num_tasks = std::distance(first, last);
+  if(num_tasks == 0) {
+    std::promise<void> done;
+    done.set_value();
+    return done.get_future();
+  }
+
+  Bulk* bulk = new Bulk;
+  bulk->num_left.store(num_tasks, std::memory_order_relaxed);
+  auto result = bulk->done.get_future();
+
+  std::vector<Task*> tasks;
+  tasks.reserve(num_tasks);
+  for(; first != last; ++first) {
+    tasks.push_back(new Task([bulk, callable = *first]() mutable {
+      try {
+        callable();
+      }
+      catch(...) {
+        std::lock_guard<std::mutex> lock(bulk->error_mutex);
+        if(!bulk->error) {
+          bulk->error = std::current_exception();
+        }
+      }
+      if(bulk->num_left.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        if(bulk->error) {
+          bulk->done.set_exception(bulk->error);
+        }
+        else {
+          bulk->done.set_value();
+        }
+        delete bulk;
+      }
+    }));
+  }
+  _push(tasks);
+
+  return result;
+}
+
+template <typename C>
+void ThreadPool::parallel_for(size_t beg, size_t end, C&& callable, size_t chunk_size) {
+  if(beg >= end) {
+    return;
+  }
+  if(chunk_size == 0) {
+    const size_t num_chunks = 4 * std::max(_workers.size(), size_t(1));
+    chunk_size = std::max((end - beg + num_chunks - 1) / num_chunks, size_t(1));
+  }
+
+  //chunks only refer to the frame of this call, which returns after all of them ran
+  std::atomic<size_t> num_left{(end - beg + chunk_size - 1) / chunk_size};
+  std::mutex error_mutex;
+  std::exception_ptr error;
+
+  std::vector<Task*> tasks;
+  tasks.reserve(num_left.load(std::memory_order_relaxed));
+  for(size_t b = beg; b < end; b += chunk_size) {
+    const size_t e = std::min(b + chunk_size, end);
+    tasks.push_back(new Task([&, b, e]() {
+      try {
+        for(size_t i = b; i < e; ++i) {
+          callable(i);
+        }
+      }
+      catch(...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if(!error) {
+          error = std::current_exception();
+        }
+      }
+      num_left.fetch_sub(1, std::memory_order_release);
+    }));
+  }
+  _push(tasks);
+
+  Worker* worker = _this_worker();
+  if(worker != nullptr && worker->pool != this) {
+    worker = nullptr;
+  }
+  while(num_left.load(std::memory_order_acquire) != 0) {
+    if(Task* task = _find_task(worker)) {
+      (*task)();
+      delete task;
+    }
+    else {
+      std::this_thread::yield();
+    }
+  }
+
+  if(error) {
+    std::rethrow_exception(error);
+  }
+}
+
+inline
+void ThreadPool::_push(std::vector<Task*>& tasks) {
+  Worker* worker = _this_worker();
+
+  if(worker != nullptr && worker->pool == this) {
+    for(Task* task : tasks) {
+      _queues[worker->id]->push(task);
+    }
+    //pairs with the fence of a worker going to sleep, one of them sees the other
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(_num_sleeping.load(std::memory_order_relaxed) != 0) {
+      std::unique_lock<std::mutex> lock(_jobs_mutex);
+      if(tasks.size() == 1) {
+        cv.notify_one();
+      }
+      else {
+        cv.notify_all();
+      }
+    }
+    return;
+  }
 
-  auto result =  (*task).get_future();
   {
     std::unique_lock<std::mutex> lock(_jobs_mutex);
     if(_stop){
+      for(Task* task : tasks) {
+        delete task;
+      }
       throw std::runtime_error("enqueueing to stopped ThreadPool");
     }
-    _jobs.emplace([task]() { (*task)(); });
+    _jobs.insert(_jobs.end(), tasks.begin(), tasks.end());
+    _num_jobs.store(_jobs.size(), std::memory_order_relaxed);
+  }
+  if(tasks.size() == 1) {
+    cv.notify_one();
+  }
+  else {
+    cv.notify_all();
+  }
+}
+
+inline
+ThreadPool::Task* ThreadPool::_find_task(Worker* worker) {
+  Task* task{nullptr};
 
+  if(worker != nullptr && _queues[worker->id]->pop(task)) {
+    return task;
   }
-  cv.notify_one();
 
-  return result;
+  //a worker takes its share of the shared queue at once and lets the others steal from it,
+  //thus a bulk of n tasks costs about one lock per worker instead of n
+  if(_num_jobs.load(std::memory_order_relaxed) != 0) {
+    std::unique_lock<std::mutex> lock(_jobs_mutex);
+    if(!_jobs.empty()) {
+      task = _jobs.front();
+      _jobs.pop_front();
+      if(worker != nullptr) {
+        const size_t share = _jobs.size() / _queues.size();
+        for(size_t i = 0; i < share; ++i) {
+          _queues[worker->id]->push(_jobs.front());
+          _jobs.pop_front();
+        }
+      }
+      _num_jobs.store(_jobs.size(), std::memory_order_relaxed);
+      return task;
+    }
+  }
+
+  //start from a random victim so thieves spread over the workers
+  const size_t num_queues = _queues.size();
+  size_t victim{0};
+  if(worker != nullptr) {
+    worker->seed ^= worker->seed << 13;
+    worker->seed ^= worker->seed >> 7;
+    worker->seed ^= worker->seed << 17;
+    victim = worker->seed % num_queues;
+  }
+  for(size_t i = 0; i < num_queues; ++i) {
+    const size_t q = (victim + i) % num_queues;
+    if(worker != nullptr && q == worker->id) {
+      continue;
+    }
+    if(_queues[q]->steal(task)) {
+      return task;
+    }
+  }
+  return nullptr;
 }
 
 inline
-ThreadPool::~ThreadPool(){
-  {
-    std::unique_lock<std::mutex> lock(_jobs_mutex);
-    _stop = true;
+bool ThreadPool::_has_task() {
+  if(!_jobs.empty()) {
+    return true;
   }
-  cv.notify_all();
-  for(auto &worker:_workers){
-    worker.join();
+  for(auto& queue : _queues) {
+    if(!queue->empty()) {
+      return true;
+    }
   }
+  return false;
+}
 
+inline
+void ThreadPool::_run(Worker& worker) {
+  size_t num_spins{0};
+  while(true){
+    if(Task* task = _find_task(&worker)) {
+      (*task)();
+      delete task;
+      num_spins = 0;
+      continue;
+    }
+
+    if(++num_spins < NUM_SPINS) {
+      std::this_thread::yield();
+      continue;
+    }
+    num_spins = 0;
+
+    std::unique_lock<std::mutex> lock(_jobs_mutex);
+    _num_sleeping.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(_has_task()) {
+      _num_sleeping.fetch_sub(1, std::memory_order_relaxed);
+      continue;
+    }
+    if(_stop){
+      _num_sleeping.fetch_sub(1, std::memory_order_relaxed);
+      return;
+    }
+    //any wake-up rescans all queues
+    cv.wait(lock);
+    _num_sleeping.fetch_sub(1, std::memory_order_relaxed);
+  }
 }
@@ -0,0 +1,395 @@
+#pragma once
+#include <SNIG/utility/mapped_file.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace snig {
+
+//in-place parser of the Graph Challenge tsv files
+//a file is mapped and split at line boundaries into one chunk per thread,
+//every chunk is counted first and then parsed straight into the output arrays,
+//thus nothing is allocated per line and output arrays can be reused across files
+
+inline
+size_t default_parser_threads();
+
+//lines "row \t col \t value" with 1-based indices,
+//rows and cols are returned 0-based, entries keep the order of the file
+template <typename T>
+void parse_tsv_triplets(
+  const char* data,
+  const size_t size,
+  std::vector<int>& rows,
+  std::vector<int>& cols,
+  std::vector<T>& values,
+  const size_t num_threads = default_parser_threads()
+);
+
+template <typename T>
+void parse_tsv_triplets(
+  const std::fs::path& path,
+  std::vector<int>& rows,
+  std::vector<int>& cols,
+  std::vector<T>& values,
+  const size_t num_threads = default_parser_threads()
+);
+
+//lines of a single integer, returned as they are
+inline
+void parse_tsv_integers(
+  const char* data,
+  const size_t size,
+  std::vector<int>& values,
+  const size_t num_threads = default_parser_threads()
+);
+
+inline
+void parse_tsv_integers(
+  const std::fs::path& path,
+  std::vector<int>& values,
+  const size_t num_threads = default_parser_threads()
+);
+
+//counting sort of (row, col, value) entries into CSR,
+//columns are sorted within every row
+//row_array holds num_rows + 1 entries, col_array and data_array hold rows.size() entries
+template <typename I, typename T>
+void triplets_to_CSR(
+  const std::vector<int>& rows,
+  const std::vector<int>& cols,
+  const std::vector<T>& values,
+  const size_t num_rows,
+  I* row_array,
+  int* col_array,
+  T* data_array
+);
+
+//-----------------------------------------------------------------------------
+//Definition of tsv parser function
+//-----------------------------------------------------------------------------
+
+namespace detail {
+
+//files smaller than this are not worth a thread
+constexpr size_t MIN_TSV_CHUNK = 1 << 20;
+
+template <typename T>
+T real_cast(const double v) {
+  return static_cast<T>(v);
+}
+
+#ifdef __CUDACC__
+template <>
+inline half real_cast<half>(const double v) {
+  return __float2half(float(v));
+}
+#endif
+
+//chunk c is [bounds[c], bounds[c + 1]), every chunk starts right after a newline
+inline
+std::vector<size_t> split_tsv_chunks(
+  const char* data,
+  const size_t size,
+  const size_t num_threads
+) {
+  size_t num_chunks = std::max(std::min(num_threads, size / MIN_TSV_CHUNK), size_t(1));
+  std::vector<size_t> bounds(num_chunks + 1, size);
+  bounds[0] = 0;
+  for(size_t c = 1; c < num_chunks; ++c) {
+    size_t b = std::max(size / num_chunks * c, bounds[c - 1]);
+    const char* nl = static_cast<const char*>(std::memchr(data + b, '\n', size - b));
+    bounds[c] = (nl == nullptr) ? size : nl - data + 1;
+  }
+  return bounds;
+}
+
+//run f(c) for every chunk, chunk 0 on the calling thread
+template <typename F>
+void run_tsv_chunks(const size_t num_chunks, F&& f) {
+  std::vector<std::exception_ptr> errors(num_chunks);
+  std::vector<std::thread> threads;
+  threads.reserve(num_chunks);
+  auto guarded = [&](const size_t c) {
+    try {
+      f(c);
+    }
+    catch(...) {
+      errors[c] = std::current_exception();
+    }
+  };
+  for(size_t c = 1; c < num_chunks; ++c) {
+    threads.emplace_back(guarded, c);
+  }
+  guarded(0);
+  for(auto& t : threads) {
+    t.join();
+  }
+  for(auto& e : errors) {
+    if(e) {
+      std::rethrow_exception(e);
+    }
+  }
+}
+
+//call f(line_beg, line_end) for every non-empty line of [beg, end)
+template <typename F>
+void for_each_tsv_line(const char* beg, const char* end, F&& f) {
+  while(beg < end) {
+    const char* nl = static_cast<const char*>(std::memchr(beg, '\n', end - beg));
+    const char* line_end = (nl == nullptr) ? end : nl;
+    const char* e = line_end;
+    if(e > beg && e[-1] == '\r') {
+      --e;
+    }
+    if(e > beg) {
+      f(beg, e);
+    }
+    beg = line_end + 1;
+  }
+}
+
+inline
+const char* parse_tsv_int(const char* p, const char* end, int& v) {
+  while(p < end && (*p == '\t' || *p == ' ')) {
+    ++p;
+  }
+  bool negative = false;
+  if(p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    ++p;
+  }
+  const char* digits = p;
+  long long x = 0;
+  while(p < end && static_cast<unsigned>(*p - '0') < 10) {
+    x = x * 10 + (*p - '0');
+    ++p;
+  }
+  if(p == digits) {
+    throw std::runtime_error("Invalid integer in tsv line : " + std::string(digits, end));
+  }
+  v = static_cast<int>(negative ? -x : x);
+  return p;
+}
+
+//exact for decimals with at most 15 significant digits and small exponents,
+//which covers every value of the challenge dataset
+inline
+const char* parse_tsv_real(const char* p, const char* end, double& v) {
+  static const double pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+
+  while(p < end && (*p == '\t' || *p == ' ')) {
+    ++p;
+  }
+  bool negative = false;
+  if(p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    ++p;
+  }
+
+  const char* start = p;
+  uint64_t mantissa = 0;
+  int num_digits = 0;
+  int exp10 = 0;
+  auto digit = [&](const bool fraction) {
+    if(num_digits < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+      num_digits += (mantissa != 0);
+      exp10 -= fraction;
+    }
+    else {
+      exp10 += !fraction;
+    }
+  };
+  while(p < end && static_cast<unsigned>(*p - '0') < 10) {
+    digit(false);
+    ++p;
+  }
+  if(p < end && *p == '.') {
+    ++p;
+    while(p < end && static_cast<unsigned>(*p - '0') < 10) {
+      digit(true);
+      ++p;
+    }
+  }
+  if(p == start || (p == start + 1 && *start == '.')) {
+    throw std::runtime_error("Invalid number in tsv line : " + std::string(start, end));
+  }
+  if(p < end && (*p == 'e' || *p == 'E')) {
+    int e;
+    p = parse_tsv_int(p + 1, end, e);
+    exp10 += e;
+  }
+
+  double x = static_cast<double>(mantissa);
+  if(exp10 < 0) {
+    x = (exp10 >= -22) ? x / pow10[-exp10] : x * std::pow(10.0, exp10);
+  }
+  else if(exp10 > 0) {
+    x = (exp10 <= 22) ? x * pow10[exp10] : x * std::pow(10.0, exp10);
+  }
+  v = negative ? -x : x;
+  return p;
+}
+
+//number of lines of every chunk, turned into the first output index of every chunk
+inline
+std::vector<size_t> count_tsv_lines(
+  const char* data,
+  const std::vector<size_t>& bounds
+) {
+  const size_t num_chunks = bounds.size() - 1;
+  std::vector<size_t> offsets(num_chunks + 1, 0);
+  run_tsv_chunks(num_chunks, [&](const size_t c) {
+    size_t n{0};
+    for_each_tsv_line(data + bounds[c], data + bounds[c + 1], [&](const char*, const char*) {
+      ++n;
+    });
+    offsets[c + 1] = n;
+  });
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  return offsets;
+}
+
+}// end of namespace detail
+
+inline
+size_t default_parser_threads() {
+  return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+template <typename T>
+void parse_tsv_triplets(
+  const char* data,
+  const size_t size,
+  std::vector<int>& rows,
+  std::vector<int>& cols,
+  std::vector<T>& values,
+  const size_t num_threads
+) {
+  auto bounds = detail::split_tsv_chunks(data, size, num_threads);
+  auto offsets = detail::count_tsv_lines(data, bounds);
+
+  rows.resize(offsets.back());
+  cols.resize(offsets.back());
+  values.resize(offsets.back());
+
+  detail::run_tsv_chunks(bounds.size() - 1, [&](const size_t c) {
+    size_t k = offsets[c];
+    detail::for_each_tsv_line(data + bounds[c], data + bounds[c + 1], [&](const char* p, const char* end) {
+      int row;
+      int col;
+      double value;
+      p = detail::parse_tsv_int(p, end, row);
+      p = detail::parse_tsv_int(p, end, col);
+      detail::parse_tsv_real(p, end, value);
+      rows[k] = row - 1;
+      cols[k] = col - 1;
+      values[k] = detail::real_cast<T>(value);
+      ++k;
+    });
+  });
+}
+
+template <typename T>
+void parse_tsv_triplets(
+  const std::fs::path& path,
+  std::vector<int>& rows,
+  std::vector<int>& cols,
+  std::vector<T>& values,
+  const size_t num_threads
+) {
+  MappedFile file(path);
+  parse_tsv_triplets<T>(file.data(), file.size(), rows, cols, values, num_threads);
+}
+
+inline
+void parse_tsv_integers(
+  const char* data,
+  const size_t size,
+  std::vector<int>& values,
+  const size_t num_threads
+) {
+  auto bounds = detail::split_tsv_chunks(data, size, num_threads);
+  auto offsets = detail::count_tsv_lines(data, bounds);
+
+  values.resize(offsets.back());
+
+  detail::run_tsv_chunks(bounds.size() - 1, [&](const size_t c) {
+    size_t k = offsets[c];
+    detail::for_each_tsv_line(data + bounds[c], data + bounds[c + 1], [&](const char* p, const char* end) {
+      detail::parse_tsv_int(p, end, values[k++]);
+    });
+  });
+}
+
+inline
+void parse_tsv_integers(
+  const std::fs::path& path,
+  std::vector<int>& values,
+  const size_t num_threads
+) {
+  MappedFile file(path);
+  parse_tsv_integers(file.data(), file.size(), values, num_threads);
+}
+
+template <typename I, typename T>
+void triplets_to_CSR(
+  const std::vector<int>& rows,
+  const std::vector<int>& cols,
+  const std::vector<T>& values,
+  const size_t num_rows,
+  I* row_array,
+  int* col_array,
+  T* data_array
+) {
+  using namespace std::literals::string_literals;
+
+  std::fill(row_array, row_array + num_rows + 1, I(0));
+  for(const int r : rows) {
+    if(r < 0 || size_t(r) >= num_rows) {
+      throw std::runtime_error("Row index "s + std::to_string(r + 1) + " is out of range");
+    }
+    ++row_array[r + 1];
+  }
+  std::partial_sum(row_array, row_array + num_rows + 1, row_array);
+
+  //row_array[r] is the cursor of row r, thus it ends up at the beginning of row r + 1
+  for(size_t k = 0; k < rows.size(); ++k) {
+    I& pos = row_array[rows[k]];
+    col_array[pos] = cols[k];
+    data_array[pos] = values[k];
+    ++pos;
+  }
+  for(size_t r = num_rows; r > 0; --r) {
+    row_array[r] = row_array[r - 1];
+  }
+  row_array[0] = 0;
+
+  //rows are short and mostly sorted already
+  for(size_t r = 0; r < num_rows; ++r) {
+    for(I i = row_array[r] + 1; i < row_array[r + 1]; ++i) {
+      int col = col_array[i];
+      T value = data_array[i];
+      I j = i;
+      for(; j > row_array[r] && col_array[j - 1] > col; --j) {
+        col_array[j] = col_array[j - 1];
+        data_array[j] = data_array[j - 1];
+      }
+      col_array[j] = col;
+      data_array[j] = value;
+    }
+  }
+}
+
+}// end of namespace snig ----------------------------------------------
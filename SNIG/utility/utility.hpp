@@ -1,11 +1,21 @@
 #pragma once
 #include <functional>
 #include <algorithm>
+#include <numeric>
+#include <vector>
+#include <iostream>
 
 namespace snig {
 
+//default shared memory per block of NVIDIA GPUs
+//converted weight files and engines must agree on the section size
+constexpr size_t DEFAULT_SEC_BYTES = 48 * 1024;
+
 template<typename T>
-size_t get_sec_size(const size_t num_neurons);
+size_t get_sec_size(
+  const size_t num_neurons,
+  const size_t max_sec_bytes = DEFAULT_SEC_BYTES
+);
 
 inline
 float average_zero_percent_in_non_empty_rows(
@@ -26,18 +36,17 @@ void num_nonzero_row(std::vector<size_t>& nerows);
 //-----------------------------------------------------------------------------
 
 template<typename T>
-size_t get_sec_size(const size_t num_neurons) {
+size_t get_sec_size(
+  const size_t num_neurons,
+  const size_t max_sec_bytes
+) {
 
-  //only for the same GPUs
-  //
   //get tuned shared memory size
   //num_neurons must be divisible by shared memory (a.k.a. sec_size)
   //only for double float
-  cudaDeviceProp props;
-  cudaGetDeviceProperties(&props, 0);
   size_t sec_size{0};
 
-  size_t max_num_per_block = props.sharedMemPerBlock / sizeof(T);
+  size_t max_num_per_block = max_sec_bytes / sizeof(T);
   if(num_neurons <= max_num_per_block) {
     sec_size = num_neurons;
   }
@@ -60,7 +69,7 @@ float average_zero_percent_in_non_empty_rows(
   size_t nerowsY
 ) {
   int total_zero{0};
-  for(int i = 0; i < nerowsY; ++i) {
+  for(size_t i = 0; i < nerowsY; ++i) {
     total_zero += num_features - rlenY[rowsY[i]];
   }
   return (100 * (total_zero / float(num_features * nerowsY)));
@@ -71,7 +80,7 @@ inline
 void num_nonzero_row_percent(std::vector<size_t>& nerows)
 {
   std::cout << "\nPerencetage of number of nonzero rows of each GPU : ";
-  size_t total = std::accumulate(nerows.begin(), nerows.end(), 0);
+  size_t total = std::accumulate(nerows.begin(), nerows.end(), size_t(0));
   for(auto& num : nerows) {
     std::cout << (100 * (float(num) / total)) << "% ";
   }
@@ -81,7 +90,6 @@ inline
 void num_nonzero_row(std::vector<size_t>& nerows)
 {
   std::cout << "\nNumber of nonzero rows of each GPU : ";
-  size_t total = std::accumulate(nerows.begin(), nerows.end(), 0);
   for(auto& num : nerows) {
     std::cout << num << " ";
   }
@@ -0,0 +1,155 @@
+#pragma once
+#include <CLI11/CLI11.hpp>
+#include <SNIG/SNIG.hpp>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+//options and dispatch of the host modes (CPUSNIG, TiledSNIG, SparseSNIG, CPUGPipe),
+//shared by snig and snig_cpu so both take the same flags
+
+struct HostOptions {
+  size_t num_threads = std::thread::hardware_concurrency();
+  size_t min_batch_size = snig::MIN_BATCH_SIZE;
+  size_t resident_layers = 0;
+  bool tune_sec_size = false;
+  size_t compact_interval = snig::COMPACT_INTERVAL;
+  std::string numa = "off";
+  size_t tile_size = 0;
+  double pull_density = snig::PULL_DENSITY;
+  size_t num_stages = 0;
+};
+
+//  host options:
+//        --num_threads                :  number of CPU threads
+//        --min_batch_size             :  smallest input batch
+//        --resident_layers            :  number of layers kept in memory, 0 keeps all layers
+//        --tune_sec_size              :  pick the section size for the caches of this CPU
+//        --compact_interval           :  layers between two compactions of live rows in CPUSNIG, 0 never compacts
+//        --numa                       :  placement of CPUSNIG weights on NUMA nodes (off, replicate, interleave)
+//        --tile_size                  :  rows per tile of TiledSNIG, 0 sizes tiles from L2
+//        --pull_density               :  active-neuron fraction from which TiledSNIG pulls a layer instead of pushing it
+//        --num_stages                 :  pipeline stages of CPUGPipe, 0 gives every thread a stage
+inline
+void add_host_options(CLI::App& app, HostOptions& options) {
+  app.add_option(
+    "--num_threads",
+    options.num_threads,
+    "number of CPU threads for host modes, default is the number of hardware threads"
+  );
+
+  app.add_option(
+    "--min_batch_size",
+    options.min_batch_size,
+    "smallest input batch of host modes, which shrink batches towards the last inputs, default is 16, at least input_batch_size keeps batches fixed"
+  );
+
+  app.add_option(
+    "--resident_layers",
+    options.resident_layers,
+    "number of layers CPUSNIG keeps in memory while others are streamed from disk, default is 0 (all layers)"
+  );
+
+  app.add_option(
+    "--tune_sec_size",
+    options.tune_sec_size,
+    "benchmark section sizes fitting L1/L2 on the loaded model and use the fastest in CPUSNIG, default is false"
+  );
+
+  app.add_option(
+    "--compact_interval",
+    options.compact_interval,
+    "number of layers after which CPUSNIG drops rows left all zero from its batches, default is 8, 0 never drops them"
+  );
+
+  app.add_option(
+    "--numa",
+    options.numa,
+    "NUMA mode of CPUSNIG: off, replicate (weights copied to every node), or interleave (weights spread over nodes), workers are bound to nodes unless off, default is off"
+  );
+
+  app.add_option(
+    "--tile_size",
+    options.tile_size,
+    "number of rows TiledSNIG pushes through all layers at once, default is 0 (sized from L2)"
+  );
+
+  app.add_option(
+    "--pull_density",
+    options.pull_density,
+    "fraction of nonzero activations from which a tile of TiledSNIG gathers a layer instead of scattering it, default is 0.5, above 1 never gathers"
+  );
+
+  app.add_option(
+    "--num_stages",
+    options.num_stages,
+    "number of pipeline stages of CPUGPipe, each run by num_threads / num_stages threads, default is 0 (one stage per thread)"
+  );
+}
+
+inline
+bool is_host_mode(const std::string& mode) {
+  return mode == "CPUSNIG" || mode == "TiledSNIG" || mode == "SparseSNIG" || mode == "CPUGPipe";
+}
+
+template <typename T>
+Eigen::Matrix<int, Eigen::Dynamic, 1> host_infer(
+  const std::string& mode,
+  const std::fs::path& weight_path,
+  const T bias,
+  const size_t num_neurons,
+  const size_t num_layers,
+  const std::fs::path& input_path,
+  const size_t num_inputs,
+  const size_t input_batch_size,
+  const HostOptions& options
+) {
+  if(mode == "CPUSNIG") {
+    snig::CPUSNIG<T> cpu_snig(
+      weight_path,
+      bias,
+      num_neurons,
+      num_layers,
+      options.resident_layers,
+      options.tune_sec_size,
+      snig::to_numa_mode(options.numa)
+    );
+    return cpu_snig.infer(
+      input_path, num_inputs, input_batch_size, options.num_threads, options.compact_interval, options.min_batch_size
+    );
+  }
+  else if(mode == "TiledSNIG") {
+    snig::TiledSNIG<T> tiled_snig(
+      weight_path,
+      bias,
+      num_neurons,
+      num_layers
+    );
+    return tiled_snig.infer(
+      input_path, num_inputs, input_batch_size, options.num_threads,
+      options.tile_size, options.pull_density, options.min_batch_size
+    );
+  }
+  else if(mode == "SparseSNIG") {
+    snig::SparseSNIG<T> sparse_snig(
+      weight_path,
+      bias,
+      num_neurons,
+      num_layers
+    );
+    return sparse_snig.infer(input_path, num_inputs, input_batch_size, options.num_threads, options.min_batch_size);
+  }
+  else if(mode == "CPUGPipe") {
+    snig::CPUGPipe<T> cpu_gpipe(
+      weight_path,
+      bias,
+      num_neurons,
+      num_layers
+    );
+    return cpu_gpipe.infer(input_path, num_inputs, input_batch_size, options.num_threads, options.num_stages);
+  }
+  else {
+    using namespace std::literals::string_literals;
+    throw std::runtime_error("Error mode. Please correct your mode name"s);
+  }
+}
@@ -3,23 +3,25 @@
 #include <SNIG/utility/reader.hpp>
 #include <SNIG/utility/scoring.hpp>
 #include <iostream>
+#include "host_modes.hpp"
 
 int main(int argc, char* argv[]) {
 
   //  ***All files should be converted to binary first***
 
   // usage: 
-  //        --mode(-m)                   :  mode (SNIG, GPipe, BF)
-  //        --weight(-w)                 :  path of weight directory
+  //        --mode(-m)                   :  mode (SNIG, GPipe, BF, CPUSNIG, TiledSNIG, SparseSNIG, CPUGPipe)
+  //        --weight(-w)                 :  path of weight directory or prepacked model file
   //        --input(-i)                  :  path of input file
   //        --golden(-g)                 :  path of golden file
   //        --num_neurons(-n)            :  number of neurons 1024, 4096, 16384, or 65536
   //        --num_layers(-l)             :  number of layers 120, 480, or 1920
   //        --bias(-b)                   :  bias
   //        --num_gpus                   :  number of GPUs 1, 2, 3, 4, ...
-  //        --input_batch_size           :  input batch size, must be a factor of num_inputs (60000)
+  //        --input_batch_size           :  input batch size, GPipe needs a factor of num_inputs (60000)
   //        --num_weight_buffers         :  number of weight buffers, must be an even number
   //        --thread_dimension           :  thread dimsion for inference kernel, constrained by the maximum number of threads (typically 1024)
+  //        host options                 :  options of CPU modes, see host_modes.hpp
 
   //example1:  
   //        ./snig
@@ -33,15 +35,15 @@ int main(int argc, char* argv[]) {
   app.add_option(
     "-m, --mode", 
     mode, 
-    "select mode(SNIG, GPipe, or BF), default is SNIG"
+    "select mode(SNIG, GPipe, BF, CPUSNIG, TiledSNIG, SparseSNIG, or CPUGPipe), default is SNIG"
   );
 
   std::fs::path weight_path("../sample_data/weight/neuron1024/");
   app.add_option(
     "-w, --weight",
     weight_path,
-    "weight directory path"
-  )->check(CLI::ExistingDirectory);
+    "weight directory path or prepacked model file"
+  )->check(CLI::ExistingPath);
 
   std::fs::path input_path("../sample_data/MNIST/sparse-images-1024.b");
   app.add_option(
@@ -97,9 +99,12 @@ int main(int argc, char* argv[]) {
   app.add_option(
     "--input_batch_size", 
     input_batch_size,
-    "number of input bath size, default is 5000, must be a factor of num_input (60000)"
+    "number of input bath size, default is 5000, GPipe needs a factor of num_input (60000), the largest batch of CPU modes"
   );
 
+  HostOptions host_options;
+  add_host_options(app, host_options);
+
   //for kernel dimesion
   //default is (2, 512, 1)
   std::vector<size_t> thread_vector(3);
@@ -152,6 +157,19 @@ int main(int argc, char* argv[]) {
     );
     result = bf.infer(input_path, 60000, num_gpus);
   }
+  else if(is_host_mode(mode)) {
+    result = host_infer<float>(
+      mode,
+      weight_path,
+      bias,
+      num_neurons,
+      num_layers,
+      input_path,
+      60000,
+      input_batch_size,
+      host_options
+    );
+  }
   else {
     using namespace std::literals::string_literals;
     throw std::runtime_error("Error mode. Please correct your mode name"s);
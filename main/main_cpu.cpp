@@ -0,0 +1,117 @@
+#include <CLI11/CLI11.hpp>
+#include <SNIG/SNIG.hpp>
+#include <SNIG/utility/reader.hpp>
+#include <SNIG/utility/scoring.hpp>
+#include <iostream>
+#include "host_modes.hpp"
+
+int main(int argc, char* argv[]) {
+
+  //  ***All files should be converted to binary first***
+  //  host-only build of SNIG, no GPU is required
+
+  // usage:
+  //        --mode(-m)                   :  mode (CPUSNIG, TiledSNIG, SparseSNIG, CPUGPipe)
+  //        --weight(-w)                 :  path of weight directory or prepacked model file
+  //        --input(-i)                  :  path of input file
+  //        --golden(-g)                 :  path of golden file
+  //        --num_neurons(-n)            :  number of neurons 1024, 4096, 16384, or 65536
+  //        --num_layers(-l)             :  number of layers 120, 480, or 1920
+  //        --bias(-b)                   :  bias
+  //        --input_batch_size           :  input batch size, the largest one
+  //        host options                 :  see host_modes.hpp
+
+  //example1:
+  //        ./snig_cpu
+
+  //example2:
+  //        ./snig_cpu  -m CPUSNIG -w ../sample_data/weight/neuron1024/ -i ../sample_data/MNIST/sparse-images-1024.b -g ../sample_data/MNIST/neuron1024-l120-categories.b -n 1024 -l 120 -b -0.3 --num_threads 16 --input_batch_size 500
+
+  CLI::App app{"SNIG CPU"};
+
+  std::string mode = "CPUSNIG";
+  app.add_option(
+    "-m, --mode",
+    mode,
+    "select mode(CPUSNIG, TiledSNIG, SparseSNIG, or CPUGPipe), default is CPUSNIG"
+  );
+
+  std::fs::path weight_path("../sample_data/weight/neuron1024/");
+  app.add_option(
+    "-w, --weight",
+    weight_path,
+    "weight directory path or prepacked model file"
+  )->check(CLI::ExistingPath);
+
+  std::fs::path input_path("../sample_data/MNIST/sparse-images-1024.b");
+  app.add_option(
+      "-i, --input",
+      input_path,
+      "input binary file path, default is ../sample_data/MNIST/sparse-images-1024.b"
+  )->check(CLI::ExistingFile);
+
+  std::fs::path golden_path("../sample_data/MNIST/neuron1024-l120-categories.b");
+  app.add_option(
+      "-g, --golden",
+      golden_path,
+      "golden binary file path, default is ../sample_data/MINIST/neuron1024-l120-categories.b"
+  );
+
+  size_t num_neurons = 1024;
+  app.add_option(
+    "-n, --num_neurons",
+    num_neurons,
+    "total number of neurons, default is 1024"
+  );
+
+  size_t num_layers = 120;
+  app.add_option(
+    "-l, --num_layers",
+    num_layers,
+    "total number of layers, default is 120"
+  );
+
+  float bias = -0.3f;
+  app.add_option(
+    "-b, --bias",
+    bias,
+    "bias, default is -0.3"
+  );
+
+  size_t input_batch_size = 500;
+  app.add_option(
+    "--input_batch_size",
+    input_batch_size,
+    "number of input bath size, default is 500, batches shrink from it towards the last inputs"
+  );
+
+  HostOptions host_options;
+  add_host_options(app, host_options);
+
+  CLI11_PARSE(app, argc, argv);
+
+  Eigen::Matrix<int, Eigen::Dynamic, 1> result;
+
+  std::cout << "Current mode: " << mode << std::endl;
+
+  result = host_infer<float>(
+    mode,
+    weight_path,
+    bias,
+    num_neurons,
+    num_layers,
+    input_path,
+    60000,
+    input_batch_size,
+    host_options
+  );
+
+  auto golden = snig::read_golden_binary(golden_path);
+  if(snig::is_passed(result, golden)) {
+    std::cout << "CHALLENGE PASSED\n";
+  }
+  else{
+    std::cout << "CHALLENGE FAILED\n";
+  }
+  return 0;
+}
@@ -10,6 +10,8 @@ void convert_to_binary(
   const size_t num_neurons,
   const size_t sec_size,
   const size_t num_secs,
+  const snig::WeightFormat format,
+  const bool pack,
   const size_t num_layers=1920
 );
 
@@ -19,6 +21,8 @@ int main(int argc, char* argv[]) {
   //          --neurons(-n) :  1024, 4096, or 16384
   //          --convert_all :  convert all files (true, false)
   //          --sample_data :  use sample_data (true, false)
+  //          --format      :  weight format (CSR, ELL)
+  //          --pack        :  also write a prepacked model n{neurons}-l{layers}.snig (true, false)
 
   // example1:
   //        ./to_binary --sample_data true
@@ -26,8 +30,12 @@ int main(int argc, char* argv[]) {
   //        ./to_binary -n 1024
   // example3:
   //        ./to_binary -convert_all true
+  // example4:
+  //        ./to_binary -n 4096 --format ELL
+  // example5:
+  //        ./to_binary -n 4096 --pack true
 
-  // sec_size, num_secs would be caculated automatically based on GPU architecture.
+  // sec_size, num_secs would be caculated automatically based on the default shared memory per block of GPUs.
 
   CLI::App app{"Converter"};
 
@@ -52,6 +60,20 @@ int main(int argc, char* argv[]) {
     "convert sample data to binary file, default is false"
   );
 
+  std::string format_name = "CSR";
+  app.add_option(
+    "--format",
+    format_name,
+    "weight format (CSR, ELL), default is CSR"
+  )->check(CLI::IsMember({"CSR", "ELL"}));
+
+  bool pack = false;
+  app.add_option(
+    "--pack",
+    pack,
+    "also write a prepacked model which can be mapped in place, default is false"
+  );
+
   std::fs::path weight_path;
 
   std::fs::path input_path;
@@ -60,6 +82,9 @@ int main(int argc, char* argv[]) {
 
   CLI11_PARSE(app, argc, argv);
 
+  snig::WeightFormat format = (format_name == "ELL") ?
+    snig::WeightFormat::ELL : snig::WeightFormat::CSR;
+
   size_t sec_size;
   size_t num_secs;
 
@@ -81,9 +106,11 @@ int main(int argc, char* argv[]) {
       neuron,
       sec_size,
       num_secs,
+      format,
+      pack,
       120
     );
-    return;
+    return 0;
   }
 
   //convert all benchmarks
@@ -101,10 +128,12 @@ int main(int argc, char* argv[]) {
         golden_path,
         neuron,
         sec_size,
-        num_secs
+        num_secs,
+        format,
+        pack
       );
     }
-    return;
+    return 0;
   }
 
   //convert benchmarks with num_neurons neruons
@@ -120,7 +149,9 @@ int main(int argc, char* argv[]) {
     golden_path,
     num_neurons,
     sec_size,
-    num_secs
+    num_secs,
+    format,
+    pack
   );
 
 
@@ -134,12 +165,19 @@ void convert_to_binary(
   const size_t num_neurons,
   const size_t sec_size,
   const size_t num_secs,
+  const snig::WeightFormat format,
+  const bool pack,
   const size_t num_layers
 ) {
 
   std::cout << "num_neurons : " << num_neurons << std::endl;
 
   std::cout << "Transforming weight files... \n";
+  //the prepacked model is written next to the layer files
+  std::fs::path model_path;
+  if(pack) {
+    model_path = weight_path / ("n" + std::to_string(num_neurons) + "-l" + std::to_string(num_layers) + ".snig");
+  }
   snig::tsv_file_to_binary_file<float>(
     weight_path,
     num_layers,
@@ -147,7 +185,9 @@ void convert_to_binary(
     num_neurons,
     sec_size,
     num_secs,
-    num_neurons * 32
+    num_neurons * 32,
+    format,
+    model_path
   ); 
 
   std::cout << "Transforming input files...\n";
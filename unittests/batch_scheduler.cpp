@@ -0,0 +1,133 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <SNIG/utility/batch_scheduler.hpp>
+#include <functional>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+//cost of a batch of rows starting at input beg: live rows and milliseconds
+struct Cost {
+  size_t live_rows;
+  double ms;
+};
+
+//hand out the inputs from first on in order and report each batch as soon as it is handed out,
+//as a single worker would
+std::vector<size_t> schedule(
+  snig::BatchScheduler& scheduler,
+  const size_t num_inputs,
+  const std::function<Cost(size_t, size_t)>& cost,
+  const size_t first = 0
+) {
+  std::vector<size_t> sizes;
+  for(size_t beg = first; beg < num_inputs; ) {
+    const size_t rows = scheduler.next(beg);
+    REQUIRE(rows > 0);
+    sizes.push_back(rows);
+    const Cost c = cost(beg, rows);
+    scheduler.report(rows, c.live_rows, c.ms);
+    beg += rows;
+  }
+  return sizes;
+}
+
+//every row alive and ms_per_row milliseconds
+std::function<Cost(size_t, size_t)> flat_cost(const double ms_per_row) {
+  return [=](size_t, const size_t rows) {
+    return Cost{rows, rows * ms_per_row};
+  };
+}
+
+void check_bounds(
+  const std::vector<size_t>& sizes,
+  const size_t num_inputs,
+  const size_t max_batch_size,
+  const size_t min_batch_size
+) {
+  REQUIRE(!sizes.empty());
+  CHECK(std::accumulate(sizes.begin(), sizes.end(), size_t(0)) == num_inputs);
+  for(size_t b = 0; b < sizes.size(); ++b) {
+    CHECK(sizes[b] <= max_batch_size);
+    //only the remainder may be smaller
+    if(b + 1 < sizes.size()) {
+      CHECK(sizes[b] >= min_batch_size);
+    }
+  }
+}
+
+}
+
+TEST_CASE("scheduler_batch_bounds" * doctest::timeout(60)) {
+  const size_t num_inputs = 60000;
+  for(const double ms_per_row : {1e-6, 1e-3, 0.1, 10.0}) {
+    for(const size_t num_workers : {size_t(1), size_t(4), size_t(16)}) {
+      CAPTURE(ms_per_row);
+      CAPTURE(num_workers);
+      snig::BatchScheduler scheduler(num_inputs, 5000, 64, num_workers);
+      const auto sizes = schedule(scheduler, num_inputs, flat_cost(ms_per_row));
+      check_bounds(sizes, num_inputs, 5000, 64);
+      CHECK(scheduler.num_batches() == sizes.size());
+      CHECK(scheduler.smallest_batch() == *std::min_element(sizes.begin(), sizes.end()));
+      CHECK(scheduler.largest_batch() == *std::max_element(sizes.begin(), sizes.end()));
+    }
+  }
+
+  //rows die halfway through the inputs and become ten times cheaper
+  snig::BatchScheduler scheduler(num_inputs, 5000, 64, 4);
+  const auto sizes = schedule(scheduler, num_inputs, [](const size_t beg, const size_t rows) {
+    const size_t live = beg >= 30000 ? 0 : std::min(rows, 30000 - beg);
+    return Cost{live, live * 0.1 + (rows - live) * 0.01};
+  });
+  check_bounds(sizes, num_inputs, 5000, 64);
+  CHECK(scheduler.live_fraction() == doctest::Approx(0.5));
+
+  //a remainder below min_batch_size is still handed out
+  snig::BatchScheduler tail(1010, 1000, 600, 1);
+  CHECK(tail.next(0) == 600);
+  tail.report(600, 600, 1e-3);
+  CHECK(tail.next(600) == 410);
+}
+
+TEST_CASE("scheduler_shrinks_toward_tail" * doctest::timeout(60)) {
+  const size_t num_inputs = 60000;
+  const size_t num_workers = 4;
+  snig::BatchScheduler scheduler(num_inputs, num_inputs, 16, num_workers);
+
+  //before any report batches take a share of the inputs left
+  const size_t first = scheduler.next(0);
+  CHECK(first == num_inputs / (snig::BatchScheduler::GUIDED_FACTOR * num_workers));
+  scheduler.report(first, first, first * 0.1);
+
+  const auto rest = schedule(scheduler, num_inputs, flat_cost(0.1), first);
+  std::vector<size_t> sizes{first};
+  sizes.insert(sizes.end(), rest.begin(), rest.end());
+  REQUIRE(sizes.size() > 4);
+
+  //constant cost: sizes never grow, and end near the shortest batch worth scheduling
+  for(size_t b = 1; b < sizes.size(); ++b) {
+    CHECK(sizes[b] <= sizes[b - 1]);
+  }
+  const size_t floor = static_cast<size_t>(snig::BatchScheduler::MIN_BATCH_MS / 0.1);
+  CHECK(sizes[sizes.size() - 2] <= floor);
+  CHECK(sizes[sizes.size() - 2] * 10 < sizes.front());
+}
+
+TEST_CASE("scheduler_fixed_batches" * doctest::timeout(60)) {
+  const size_t num_inputs = 60000;
+  for(const size_t min_batch_size : {size_t(1000), size_t(4096)}) {
+    snig::BatchScheduler scheduler(num_inputs, 1000, min_batch_size, 4);
+    //reports do not change fixed batches
+    const auto sizes = schedule(scheduler, num_inputs, flat_cost(10.0));
+    REQUIRE(sizes.size() == 60);
+    for(const size_t rows : sizes) {
+      CHECK(rows == 1000);
+    }
+  }
+
+  snig::BatchScheduler scheduler(2500, 1000, 1000, 4);
+  const auto sizes = schedule(scheduler, 2500, flat_cost(1e-6));
+  CHECK(sizes == std::vector<size_t>{1000, 1000, 500});
+}
@@ -0,0 +1,202 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <SNIG/utility/reader.hpp>
+#include <SNIG/utility/input_stream.hpp>
+#include <experimental/filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+
+namespace std {
+  namespace fs = experimental::filesystem;
+}
+
+namespace {
+
+constexpr size_t ROWS = 7;
+constexpr size_t COLS = 64;
+constexpr size_t SEC_SIZE = 16;
+
+struct CSRInput {
+  std::vector<size_t> row_array;
+  std::vector<int> col_array;
+  std::vector<float> data_array;
+};
+
+//a few empty rows, the others with random columns
+CSRInput make_input() {
+  std::mt19937 gen(7);
+  CSRInput input;
+  input.row_array.push_back(0);
+  for(size_t r = 0; r < ROWS; ++r) {
+    if(r % 3 != 1) {
+      for(size_t c = 0; c < COLS; ++c) {
+        if(gen() % 5 == 0) {
+          input.col_array.push_back(c);
+          input.data_array.push_back(float(gen() % 32 + 1));
+        }
+      }
+    }
+    input.row_array.push_back(input.col_array.size());
+  }
+  return input;
+}
+
+std::vector<float> to_dense(const CSRInput& input) {
+  std::vector<float> dense(ROWS * COLS, 0);
+  for(size_t r = 0; r < ROWS; ++r) {
+    for(size_t k = input.row_array[r]; k < input.row_array[r + 1]; ++k) {
+      dense[r * COLS + input.col_array[k]] = input.data_array[k];
+    }
+  }
+  return dense;
+}
+
+std::fs::path temp_path(const std::string& name) {
+  return std::fs::temp_directory_path() / ("snig_input_format_" + name + ".b");
+}
+
+void write_csr(const std::fs::path& path, const CSRInput& input) {
+  snig::InputHeader header;
+  header.is_csr = true;
+  header.value_type = snig::value_type_of<float>();
+  header.rows = ROWS;
+  header.cols = COLS;
+  header.nnz = input.col_array.size();
+
+  std::ofstream out(path, std::ios::out | std::ios::binary);
+  snig::write_input_header(out, header);
+  out.write((char*)input.row_array.data(), sizeof(size_t) * (ROWS + 1));
+  out.write((char*)input.col_array.data(), sizeof(int) * header.nnz);
+  out.write((char*)input.data_array.data(), sizeof(float) * header.nnz);
+}
+
+void write_dense(const std::fs::path& path, const std::vector<float>& dense) {
+  snig::InputHeader header;
+  header.rows = ROWS;
+  header.cols = COLS;
+
+  std::ofstream out(path, std::ios::out | std::ios::binary);
+  snig::write_input_header(out, header);
+  out.write((char*)dense.data(), sizeof(float) * dense.size());
+}
+
+//stream path through batches of batch_size rows into dense and its section flags
+void stream_input(
+  const std::fs::path& path,
+  const size_t batch_size,
+  std::vector<float>& dense,
+  std::vector<bool>& flags
+) {
+  const size_t num_secs = COLS / SEC_SIZE;
+  std::vector<std::vector<float> > Y(2, std::vector<float>(batch_size * COLS));
+  std::unique_ptr<bool[]> is_nonzero_row[2] = {
+    std::make_unique<bool[]>(batch_size * num_secs),
+    std::make_unique<bool[]>(batch_size * num_secs)
+  };
+
+  dense.assign(ROWS * COLS, -1);
+  flags.assign(ROWS * num_secs, false);
+  snig::InputStream<float> stream(
+    path, ROWS, COLS, SEC_SIZE, batch_size,
+    {Y[0].data(), Y[1].data()},
+    {is_nonzero_row[0].get(), is_nonzero_row[1].get()}
+  );
+  snig::InputStream<float>::Batch batch;
+  while(stream.acquire(batch)) {
+    std::copy(batch.Y, batch.Y + batch.rows * COLS, dense.begin() + batch.beg * COLS);
+    std::copy(
+      batch.is_nonzero_row,
+      batch.is_nonzero_row + batch.rows * num_secs,
+      flags.begin() + batch.beg * num_secs
+    );
+    stream.release(batch);
+  }
+}
+
+}
+
+TEST_CASE("csr_round_trip" * doctest::timeout(60)) {
+  const CSRInput input = make_input();
+  const std::vector<float> expected = to_dense(input);
+  const auto csr_path = temp_path("csr");
+  const auto dense_path = temp_path("dense");
+  write_csr(csr_path, input);
+  write_dense(dense_path, expected);
+
+  //whole-file readers expand both formats to the same matrix
+  std::vector<float> from_csr(ROWS * COLS, -1);
+  std::vector<float> from_dense(ROWS * COLS, -1);
+  snig::read_input_binary<float>(csr_path, from_csr.data());
+  snig::read_input_binary<float>(dense_path, from_dense.data());
+  CHECK(from_csr == expected);
+  CHECK(from_dense == expected);
+
+  //both formats compress to the same CSR
+  std::vector<size_t> row_array;
+  std::vector<int> col_array;
+  std::vector<float> data_array;
+  snig::read_input_binary<float>(dense_path, row_array, col_array, data_array);
+  CHECK(row_array == input.row_array);
+  CHECK(col_array == input.col_array);
+  CHECK(data_array == input.data_array);
+
+  //streamed batches, including a partial last one, match the dense file
+  for(const size_t batch_size : {size_t(1), size_t(3), ROWS}) {
+    std::vector<float> streamed_csr, streamed_dense;
+    std::vector<bool> flags_csr, flags_dense;
+    stream_input(csr_path, batch_size, streamed_csr, flags_csr);
+    stream_input(dense_path, batch_size, streamed_dense, flags_dense);
+    CHECK(streamed_csr == expected);
+    CHECK(streamed_dense == expected);
+    CHECK(flags_csr == flags_dense);
+  }
+
+  std::fs::remove(csr_path);
+  std::fs::remove(dense_path);
+}
+
+TEST_CASE("csr_non_monotone_rows" * doctest::timeout(60)) {
+  CSRInput input = make_input();
+  //row 2 starts after row 3 ends, the total still matches nnz
+  std::swap(input.row_array[2], input.row_array[3]);
+  REQUIRE(input.row_array[2] > input.row_array[3]);
+  const auto path = temp_path("non_monotone");
+  write_csr(path, input);
+
+  std::vector<float> dense(ROWS * COLS);
+  CHECK_THROWS_AS(snig::read_input_binary<float>(path, dense.data()), std::runtime_error);
+
+  std::vector<float> streamed;
+  std::vector<bool> flags;
+  CHECK_THROWS_AS(stream_input(path, 3, streamed, flags), std::runtime_error);
+
+  //offsets ending past nnz are rejected as well
+  input = make_input();
+  input.row_array[ROWS] += 1;
+  write_csr(path, input);
+  CHECK_THROWS_AS(snig::read_input_binary<float>(path, dense.data()), std::runtime_error);
+  CHECK_THROWS_AS(stream_input(path, 3, streamed, flags), std::runtime_error);
+
+  std::fs::remove(path);
+}
+
+TEST_CASE("csr_column_out_of_range" * doctest::timeout(60)) {
+  for(const int col : {int(COLS), int(COLS) * 1000, -1}) {
+    CSRInput input = make_input();
+    REQUIRE(!input.col_array.empty());
+    input.col_array.back() = col;
+    const auto path = temp_path("column");
+    write_csr(path, input);
+
+    std::vector<float> dense(ROWS * COLS);
+    CHECK_THROWS_AS(snig::read_input_binary<float>(path, dense.data()), std::runtime_error);
+
+    std::vector<float> streamed;
+    std::vector<bool> flags;
+    CHECK_THROWS_AS(stream_input(path, 3, streamed, flags), std::runtime_error);
+
+    std::fs::remove(path);
+  }
+}
@@ -0,0 +1,261 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <SNIG/base/base.hpp>
+#include <experimental/filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <vector>
+#include <unistd.h>
+
+namespace std {
+  namespace fs = experimental::filesystem;
+}
+
+namespace {
+
+constexpr size_t NEURONS = 64;
+constexpr size_t LAYERS = 3;
+constexpr size_t SEC_SIZE = 16;
+constexpr size_t NUM_SECS = NEURONS / SEC_SIZE;
+
+//only loads the weights, thus the loaded image can be inspected
+class Loader : public snig::Base<float> {
+
+  public:
+
+    Loader(const std::fs::path& weight_path, const snig::WeightOptions& options = snig::WeightOptions{}) :
+      snig::Base<float>(weight_path, -0.3f, NEURONS, LAYERS, SEC_SIZE, options) {
+    }
+
+    std::vector<int> image() const {
+      return std::vector<int>(_host_weight, _host_weight + _host_wlen);
+    }
+
+    const std::vector<snig::PackedLayer>& layers() const {
+      return _layers;
+    }
+
+    snig::LayerWindow& window() {
+      return *_layer_window;
+    }
+
+  private:
+
+    void _preprocess(const std::fs::path&) override {}
+    void _weight_alloc() override {}
+    void _input_alloc() override {}
+    void _result_alloc() override {}
+    void _infer() override {}
+};
+
+//layer files of random weights, the second layer uniform,
+//converted once and packed into model.snig with checksums,
+//every test process has its own directory so tests may run in parallel
+class Model {
+
+  public:
+
+    Model() : _dir{std::fs::temp_directory_path() / ("snig_model_format_" + std::to_string(::getpid()))} {
+      std::fs::remove_all(_dir);
+      std::fs::create_directories(_dir);
+
+      std::mt19937 gen(11);
+      for(size_t l = 1; l <= LAYERS; ++l) {
+        std::ofstream out(_dir / ("n" + std::to_string(NEURONS) + "-l" + std::to_string(l) + ".tsv"));
+        for(size_t r = 1; r <= NEURONS; ++r) {
+          for(size_t c = 1; c <= NEURONS; ++c) {
+            if(gen() % 8 == 0) {
+              out << r << '\t' << c << '\t' << (l == 2 ? 0.0625 : (gen() % 64) / 32.0 - 1.0) << '\n';
+            }
+          }
+        }
+      }
+
+      snig::tsv_file_to_binary_file<float>(
+        _dir, LAYERS, NEURONS, NEURONS, SEC_SIZE, NUM_SECS, NEURONS * NEURONS,
+        snig::WeightFormat::CSR, model_path()
+      );
+
+      std::ifstream in(model_path(), std::ios::in | std::ios::binary);
+      _bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    ~Model() {
+      std::fs::remove_all(_dir);
+    }
+
+    const std::fs::path& dir() const { return _dir; }
+
+    std::fs::path model_path() const { return _dir / "model.snig"; }
+
+    //a copy of the model to corrupt
+    std::vector<char> bytes() const { return _bytes; }
+
+    snig::ModelHeader header() const {
+      snig::ModelHeader header;
+      std::memcpy(&header, _bytes.data(), sizeof(snig::ModelHeader));
+      return header;
+    }
+
+    std::fs::path write(const std::vector<char>& bytes) const {
+      const auto path = _dir / "corrupted.snig";
+      std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+      out.write(bytes.data(), bytes.size());
+      return path;
+    }
+
+  private:
+
+    std::fs::path _dir;
+    std::vector<char> _bytes;
+};
+
+snig::LayerEntry* entry(std::vector<char>& bytes, const snig::ModelHeader& header, const size_t layer) {
+  return reinterpret_cast<snig::LayerEntry*>(
+    bytes.data() + header.table_offset + sizeof(snig::LayerEntry) * layer
+  );
+}
+
+}
+
+TEST_CASE("model_round_trip" * doctest::timeout(60)) {
+  Model model;
+  const auto header = model.header();
+  CHECK(header.magic == snig::MODEL_MAGIC);
+  CHECK(header.version == snig::MODEL_VERSION);
+  CHECK(header.num_neurons == NEURONS);
+  CHECK(header.num_layers == LAYERS);
+  CHECK(header.sec_size == SEC_SIZE);
+  CHECK((header.flags & snig::MODEL_CHECKSUM));
+  CHECK(header.table_offset % snig::MODEL_TABLE_ALIGNMENT == 0);
+  CHECK(header.data_offset % snig::MODEL_ALIGNMENT == 0);
+
+  auto bytes = model.bytes();
+  CHECK(!entry(bytes, header, 0)->uniform);
+  CHECK(entry(bytes, header, 1)->uniform);
+  CHECK(entry(bytes, header, 1)->value == 0.0625);
+  for(size_t i = 0; i < LAYERS; ++i) {
+    const auto* e = entry(bytes, header, i);
+    CHECK(e->checksum == snig::layer_checksum(bytes.data() + header.data_offset + e->offset, e->length));
+  }
+
+  //the model holds exactly the image built from the layer files
+  Loader from_files(model.dir());
+  Loader from_model(model.model_path());
+  snig::WeightOptions in_place;
+  in_place.map_in_place = true;
+  Loader mapped(model.model_path(), in_place);
+
+  REQUIRE(from_model.layers().size() == LAYERS);
+  for(size_t i = 0; i < LAYERS; ++i) {
+    CHECK(from_model.layers()[i].offset == from_files.layers()[i].offset);
+    CHECK(from_model.layers()[i].length == from_files.layers()[i].length);
+    CHECK(from_model.layers()[i].index_len == from_files.layers()[i].index_len);
+  }
+  CHECK(from_model.image() == from_files.image());
+  CHECK(mapped.image() == from_files.image());
+}
+
+TEST_CASE("model_wrong_magic" * doctest::timeout(60)) {
+  Model model;
+  auto bytes = model.bytes();
+  auto header = model.header();
+  header.magic ^= 1;
+  std::memcpy(bytes.data(), &header, sizeof(header));
+  CHECK_THROWS_AS(Loader{model.write(bytes)}, std::runtime_error);
+
+  //shorter than a header
+  bytes.resize(sizeof(snig::ModelHeader) - 1);
+  CHECK_THROWS_AS(Loader{model.write(bytes)}, std::runtime_error);
+}
+
+TEST_CASE("model_wrong_version" * doctest::timeout(60)) {
+  Model model;
+  for(const int version : {snig::MODEL_VERSION - 1, snig::MODEL_VERSION + 1}) {
+    auto bytes = model.bytes();
+    auto header = model.header();
+    header.version = version;
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    CHECK_THROWS_AS(Loader{model.write(bytes)}, std::runtime_error);
+  }
+}
+
+TEST_CASE("model_truncated_table" * doctest::timeout(60)) {
+  Model model;
+  const auto header = model.header();
+
+  //the table ends inside its last entry
+  auto bytes = model.bytes();
+  bytes.resize(header.table_offset + sizeof(snig::LayerEntry) * LAYERS - 1);
+  CHECK_THROWS_AS(Loader{model.write(bytes)}, std::runtime_error);
+
+  //the table points past the end of the file
+  bytes = model.bytes();
+  auto moved = header;
+  moved.table_offset = bytes.size();
+  std::memcpy(bytes.data(), &moved, sizeof(moved));
+  CHECK_THROWS_AS(Loader{model.write(bytes)}, std::runtime_error);
+
+  //the last layer is cut off
+  bytes = model.bytes();
+  bytes.resize(bytes.size() - 1);
+  CHECK_THROWS_AS(Loader{model.write(bytes)}, std::runtime_error);
+}
+
+TEST_CASE("model_entry_out_of_bounds" * doctest::timeout(60)) {
+  Model model;
+  const auto header = model.header();
+
+  //offset past the end of the file
+  auto bytes = model.bytes();
+  entry(bytes, header, 1)->offset = bytes.size();
+  entry(bytes, header, 1)->offset -= entry(bytes, header, 1)->offset % snig::PACKED_LAYER_ALIGNMENT;
+  CHECK_THROWS_AS(Loader{model.write(bytes)}, std::runtime_error);
+
+  //length past the end of the file
+  bytes = model.bytes();
+  entry(bytes, header, 2)->length += snig::MODEL_ALIGNMENT;
+  CHECK_THROWS_AS(Loader{model.write(bytes)}, std::runtime_error);
+
+  //length shorter than its nnz requires
+  bytes = model.bytes();
+  entry(bytes, header, 0)->length = sizeof(int);
+  CHECK_THROWS_AS(Loader{model.write(bytes)}, std::runtime_error);
+
+  //misaligned offset
+  bytes = model.bytes();
+  entry(bytes, header, 0)->offset += sizeof(int);
+  CHECK_THROWS_AS(Loader{model.write(bytes)}, std::runtime_error);
+}
+
+TEST_CASE("model_checksum_mismatch" * doctest::timeout(60)) {
+  Model model;
+  const auto header = model.header();
+  auto bytes = model.bytes();
+  const auto* e = entry(bytes, header, 1);
+  bytes[header.data_offset + e->offset + e->length / 2] ^= 0x10;
+  const auto path = model.write(bytes);
+
+  CHECK_THROWS_AS(Loader{path}, std::runtime_error);
+
+  //streamed layers are verified as they are read
+  snig::WeightOptions streamed;
+  streamed.max_resident_layers = 1;
+  CHECK_THROWS_AS(
+    [&]() {
+      Loader loader(path, streamed);
+      for(size_t i = 0; i < LAYERS; ++i) {
+        loader.window().acquire(i);
+        loader.window().release();
+      }
+    }(),
+    std::runtime_error
+  );
+
+  //checks can be turned off
+  snig::WeightOptions unchecked;
+  unchecked.verify_checksums = false;
+  CHECK_NOTHROW(Loader(path, unchecked));
+}
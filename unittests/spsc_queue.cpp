@@ -0,0 +1,113 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <SNIG/utility/spsc_queue.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+TEST_CASE("spsc_capacity" * doctest::timeout(60)) {
+  for(const size_t capacity : {1, 2, 3, 8, 100}) {
+    snig::SPSCQueue<int> queue(capacity);
+    CHECK(queue.capacity() >= capacity);
+    CHECK((queue.capacity() & (queue.capacity() - 1)) == 0);
+
+    //exactly capacity() items fit
+    for(size_t i = 0; i < queue.capacity(); ++i) {
+      CHECK(queue.try_push(int(i)));
+    }
+    CHECK(!queue.try_push(-1));
+    int item;
+    for(size_t i = 0; i < queue.capacity(); ++i) {
+      REQUIRE(queue.try_pop(item));
+      CHECK(item == int(i));
+    }
+    CHECK(!queue.try_pop(item));
+  }
+}
+
+TEST_CASE("spsc_two_threads" * doctest::timeout(60)) {
+  //the ring wraps around many times, with blocking and abort-aware calls
+  for(const bool with_abort : {false, true}) {
+    snig::SPSCQueue<size_t> queue(16);
+    const size_t num_items = queue.capacity() * 10000 + 3;
+    std::atomic<bool> abort{false};
+
+    //assertions stay on the main thread
+    bool pushed_all{true};
+    std::thread producer([&]() {
+      for(size_t i = 0; i < num_items; ++i) {
+        if(with_abort) {
+          pushed_all &= queue.push(i, abort);
+        }
+        else {
+          queue.push(i);
+        }
+      }
+    });
+
+    //every item arrives once and in order
+    size_t expected{0};
+    bool popped_all{true};
+    for(size_t n = 0; n < num_items; ++n) {
+      size_t item;
+      if(with_abort) {
+        popped_all &= queue.pop(item, abort);
+      }
+      else {
+        queue.pop(item);
+      }
+      if(item != expected) {
+        FAIL_CHECK("item " << item << " popped where " << expected << " is expected");
+      }
+      expected = item + 1;
+    }
+    producer.join();
+
+    CHECK(pushed_all);
+    CHECK(popped_all);
+    CHECK(expected == num_items);
+    size_t extra;
+    CHECK(!queue.try_pop(extra));
+  }
+}
+
+TEST_CASE("spsc_abort" * doctest::timeout(60)) {
+  snig::SPSCQueue<int> queue(4);
+  std::atomic<bool> abort{false};
+
+  //a full ring blocks the producer until abort is set
+  for(size_t i = 0; i < queue.capacity(); ++i) {
+    REQUIRE(queue.push(int(i), abort));
+  }
+  std::atomic<int> pushed{-1};
+  std::thread producer([&]() {
+    pushed = queue.push(-1, abort);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  CHECK(pushed == -1);
+  abort = true;
+  producer.join();
+  CHECK(pushed == 0);
+  CHECK(!queue.push(-1, abort));
+
+  //an empty ring blocks the consumer until abort is set
+  abort = false;
+  int item;
+  for(size_t i = 0; i < queue.capacity(); ++i) {
+    REQUIRE(queue.pop(item, abort));
+    CHECK(item == int(i));
+  }
+  std::atomic<int> popped{-1};
+  std::thread consumer([&]() {
+    int x;
+    popped = queue.pop(x, abort);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  CHECK(popped == -1);
+  abort = true;
+  consumer.join();
+  CHECK(popped == 0);
+  CHECK(!queue.pop(item, abort));
+}
@@ -0,0 +1,304 @@
+//compares the work-stealing ThreadPool with the previous pool
+//(one std::queue of std::function guarded by one mutex)
+//on the workloads of thread_pool.cpp, plus a parallel loop and nested enqueues
+//
+//usage: thread_pool_benchmark [max_workers] [num_reps]
+
+#include <SNIG/utility/thread_pool.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <queue>
+#include <string>
+#include <vector>
+
+//the previous ThreadPool of SNIG/utility/thread_pool.hpp
+class LegacyThreadPool {
+
+  public:
+
+    LegacyThreadPool(size_t num_workers);
+    ~LegacyThreadPool();
+
+    template <typename C, typename ...Args>
+    auto enqueue (C&& callable, Args&&... args);
+
+  private:
+
+    std::vector<std::thread> _workers;
+    std::queue<std::function<void()> > _jobs;
+
+    std::mutex _jobs_mutex;
+    std::condition_variable cv;
+    bool _stop;
+};
+
+inline
+LegacyThreadPool::LegacyThreadPool(size_t num_workers)
+: _stop(false)
+{
+  _workers.reserve(num_workers);
+  for(size_t i=0; i<num_workers; ++i){
+    _workers.emplace_back(
+        [this] {
+          while(true){
+            std::function<void()> job;
+            {
+              std::unique_lock<std::mutex> lock(_jobs_mutex);
+              cv.wait(lock, [this]{return this->_stop || (!this->_jobs.empty());});
+              if(_stop && _jobs.empty()){
+                return;
+              }
+              job = std::move(this->_jobs.front());
+              this->_jobs.pop();
+            }
+            job();
+          }
+        }
+    );
+  }
+}
+
+template<typename C, typename ...Args>
+auto LegacyThreadPool::enqueue(C&& callable, Args&&... args){
+  using return_type = typename std::result_of<C(Args...)>::type;
+
+  auto task = std::make_shared<std::packaged_task<return_type()> >(
+      std::bind(std::forward<C>(callable), std::forward<Args>(args)...)
+  );
+
+  auto result =  (*task).get_future();
+  {
+    std::unique_lock<std::mutex> lock(_jobs_mutex);
+    if(_stop){
+      throw std::runtime_error("enqueueing to stopped ThreadPool");
+    }
+    _jobs.emplace([task]() { (*task)(); });
+
+  }
+  cv.notify_one();
+
+  return result;
+}
+
+inline
+LegacyThreadPool::~LegacyThreadPool(){
+  {
+    std::unique_lock<std::mutex> lock(_jobs_mutex);
+    _stop = true;
+  }
+  cv.notify_all();
+  for(auto &worker:_workers){
+    worker.join();
+  }
+}
+
+// ----------------------------------------------------------------------------
+// workloads, each returns a checksum so both pools are also checked against each other
+// ----------------------------------------------------------------------------
+
+//thread_pool.cpp "sum": five small tasks with futures, repeated
+template <typename P>
+long sum_workload(P& pool) {
+  long total{0};
+  for(size_t rep = 0; rep < 1000; ++rep) {
+    std::vector<std::future<int> > futures;
+    for(int j=1; j<=5; ++j){
+      futures.push_back(pool.enqueue([j](){return (2*j-1)+(2*j);}));
+    }
+    for(auto& result:futures){
+      total += result.get();
+    }
+  }
+  return total;
+}
+
+//thread_pool.cpp "enqueue large size": 65536 empty tasks
+template <typename P>
+long large_size_workload(P& pool) {
+  std::vector<std::future<void> > futures;
+  futures.reserve(65536);
+  for(size_t i=0; i<65536; ++i){
+    futures.push_back(pool.enqueue([]{}));
+  }
+  for(auto& result:futures){
+    result.wait();
+  }
+  return futures.size();
+}
+
+//the same 65536 empty tasks through one enqueue_bulk
+long large_size_bulk_workload(ThreadPool& pool) {
+  std::vector<std::function<void()> > jobs(65536, []{});
+  pool.enqueue_bulk(jobs.begin(), jobs.end()).get();
+  return jobs.size();
+}
+
+//a loop of 1M cheap iterations, the previous pool gets one task per chunk as parallel_for
+constexpr size_t LOOP_SIZE = 1 << 20;
+
+inline
+long loop_body(const size_t i) {
+  return static_cast<long>((i * 2654435761u) % 1024);
+}
+
+long parallel_for_workload(ThreadPool& pool) {
+  std::vector<long> partial(LOOP_SIZE);
+  pool.parallel_for(0, LOOP_SIZE, [&](const size_t i) {
+    partial[i] = loop_body(i);
+  });
+  long total{0};
+  for(const long v : partial) {
+    total += v;
+  }
+  return total;
+}
+
+long parallel_for_workload(LegacyThreadPool& pool, const size_t num_workers) {
+  std::vector<long> partial(LOOP_SIZE);
+  const size_t num_chunks = 4 * num_workers;
+  const size_t chunk_size = (LOOP_SIZE + num_chunks - 1) / num_chunks;
+  std::vector<std::future<void> > futures;
+  for(size_t b = 0; b < LOOP_SIZE; b += chunk_size) {
+    const size_t e = std::min(b + chunk_size, LOOP_SIZE);
+    futures.push_back(pool.enqueue([&partial, b, e]() {
+      for(size_t i = b; i < e; ++i) {
+        partial[i] = loop_body(i);
+      }
+    }));
+  }
+  for(auto& result:futures){
+    result.wait();
+  }
+  long total{0};
+  for(const long v : partial) {
+    total += v;
+  }
+  return total;
+}
+
+//per-batch, per-layer tasks: every batch task enqueues one task per layer
+//the previous pool can not wait inside a worker, thus batches wait from outside
+constexpr size_t NUM_BATCHES = 256;
+constexpr size_t NUM_LAYERS = 120;
+
+long nested_workload(ThreadPool& pool) {
+  std::atomic<long> total{0};
+  pool.parallel_for(0, NUM_BATCHES, [&](const size_t batch) {
+    pool.parallel_for(0, NUM_LAYERS, [&](const size_t layer) {
+      total.fetch_add(static_cast<long>(batch + layer), std::memory_order_relaxed);
+    }, 1);
+  }, 1);
+  return total.load();
+}
+
+long nested_workload(LegacyThreadPool& pool) {
+  std::atomic<long> total{0};
+  std::vector<std::future<void> > futures;
+  futures.reserve(NUM_BATCHES * NUM_LAYERS);
+  for(size_t batch = 0; batch < NUM_BATCHES; ++batch) {
+    for(size_t layer = 0; layer < NUM_LAYERS; ++layer) {
+      futures.push_back(pool.enqueue([&total, batch, layer]() {
+        total.fetch_add(static_cast<long>(batch + layer), std::memory_order_relaxed);
+      }));
+    }
+  }
+  for(auto& result:futures){
+    result.wait();
+  }
+  return total.load();
+}
+
+// ----------------------------------------------------------------------------
+// driver
+// ----------------------------------------------------------------------------
+
+//fastest of num_reps runs in milliseconds, the checksum of the last run is kept
+template <typename F>
+double time_ms(const size_t num_reps, F&& workload, long& checksum) {
+  double best = 1e30;
+  for(size_t rep = 0; rep < num_reps; ++rep) {
+    const auto beg = std::chrono::steady_clock::now();
+    checksum = workload();
+    const auto end = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double, std::milli>(end - beg).count());
+  }
+  return best;
+}
+
+void report(
+  const std::string& workload,
+  const size_t num_workers,
+  const double legacy_ms,
+  const double stealing_ms,
+  const bool matches
+) {
+  std::printf(
+    "%-20s %8zu %12.3f %14.3f %8.2fx %s\n",
+    workload.c_str(), num_workers, legacy_ms, stealing_ms, legacy_ms / stealing_ms,
+    matches ? "" : "CHECKSUM MISMATCH"
+  );
+}
+
+int main(int argc, char* argv[]) {
+  const size_t max_workers = argc > 1 ?
+    std::strtoul(argv[1], nullptr, 10) : std::max(std::thread::hardware_concurrency(), 1u);
+  const size_t num_reps = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 5;
+
+  std::printf(
+    "%-20s %8s %12s %14s %9s\n", "workload", "workers", "legacy (ms)", "stealing (ms)", "speedup"
+  );
+
+  bool all_match = true;
+  for(size_t num_workers = 1; num_workers <= max_workers; num_workers *= 2) {
+    long legacy_sum{0};
+    long stealing_sum{0};
+
+    //thread_pool.cpp "create pool"
+    const double legacy_create = time_ms(num_reps, [&]() {
+      LegacyThreadPool pool(num_workers);
+      return 0l;
+    }, legacy_sum);
+    const double stealing_create = time_ms(num_reps, [&]() {
+      ThreadPool pool(num_workers);
+      return 0l;
+    }, stealing_sum);
+    report("create pool", num_workers, legacy_create, stealing_create, true);
+
+    LegacyThreadPool legacy(num_workers);
+    ThreadPool stealing(num_workers);
+
+    auto run = [&](const std::string& name, auto&& legacy_workload, auto&& stealing_workload) {
+      const double legacy_ms = time_ms(num_reps, legacy_workload, legacy_sum);
+      const double stealing_ms = time_ms(num_reps, stealing_workload, stealing_sum);
+      report(name, num_workers, legacy_ms, stealing_ms, legacy_sum == stealing_sum);
+      all_match &= (legacy_sum == stealing_sum);
+    };
+
+    run("sum",
+      [&]() { return sum_workload(legacy); },
+      [&]() { return sum_workload(stealing); }
+    );
+    run("enqueue large size",
+      [&]() { return large_size_workload(legacy); },
+      [&]() { return large_size_workload(stealing); }
+    );
+    run("enqueue bulk",
+      [&]() { return large_size_workload(legacy); },
+      [&]() { return large_size_bulk_workload(stealing); }
+    );
+    run("parallel for",
+      [&]() { return parallel_for_workload(legacy, num_workers); },
+      [&]() { return parallel_for_workload(stealing); }
+    );
+    run("nested",
+      [&]() { return nested_workload(legacy); },
+      [&]() { return nested_workload(stealing); }
+    );
+  }
+
+  return all_match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
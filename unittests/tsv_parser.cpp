@@ -0,0 +1,161 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <doctest.h>
+
+#include <SNIG/utility/tsv_parser.hpp>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Triplets {
+  std::vector<int> rows;
+  std::vector<int> cols;
+  std::vector<float> values;
+};
+
+//enough lines to give every thread a chunk of its own
+std::string make_tsv(const size_t num_lines) {
+  std::mt19937 gen(5);
+  std::ostringstream out;
+  for(size_t k = 0; k < num_lines; ++k) {
+    out << gen() % 16384 + 1 << '\t' << gen() % 16384 + 1 << '\t';
+    switch(gen() % 4) {
+      case 0: out << "0.0625"; break;
+      case 1: out << "-" << gen() % 1000 << "." << gen() % 1000; break;
+      case 2: out << gen() % 100 << "e-" << gen() % 5; break;
+      default: out << gen() % 32; break;
+    }
+    out << '\n';
+  }
+  return out.str();
+}
+
+Triplets parse(const std::string& tsv, const size_t num_threads) {
+  Triplets t;
+  snig::parse_tsv_triplets<float>(tsv.data(), tsv.size(), t.rows, t.cols, t.values, num_threads);
+  return t;
+}
+
+//line by line with the standard library
+Triplets parse_reference(const std::string& tsv) {
+  Triplets t;
+  std::istringstream in(tsv);
+  std::string line;
+  while(std::getline(in, line)) {
+    if(line.empty() || line == "\r") {
+      continue;
+    }
+    std::istringstream fields(line);
+    int row, col;
+    std::string value;
+    fields >> row >> col >> value;
+    t.rows.push_back(row - 1);
+    t.cols.push_back(col - 1);
+    t.values.push_back(float(std::strtod(value.c_str(), nullptr)));
+  }
+  return t;
+}
+
+void check_equal(const Triplets& a, const Triplets& b) {
+  CHECK(a.rows == b.rows);
+  CHECK(a.cols == b.cols);
+  CHECK(a.values == b.values);
+}
+
+}
+
+TEST_CASE("tsv_matches_serial" * doctest::timeout(60)) {
+  const std::string tsv = make_tsv(400000);
+  REQUIRE(tsv.size() > 4 * snig::detail::MIN_TSV_CHUNK);
+
+  const Triplets serial = parse(tsv, 1);
+  REQUIRE(serial.rows.size() == 400000);
+  check_equal(serial, parse_reference(tsv));
+  for(const size_t num_threads : {2, 3, 4, 7}) {
+    check_equal(parse(tsv, num_threads), serial);
+  }
+
+  //output arrays are reused across files
+  Triplets reused = parse(tsv, 4);
+  const std::string small = make_tsv(10);
+  snig::parse_tsv_triplets<float>(small.data(), small.size(), reused.rows, reused.cols, reused.values, 4);
+  check_equal(reused, parse_reference(small));
+}
+
+TEST_CASE("tsv_chunk_boundaries" * doctest::timeout(60)) {
+  const std::string tsv = make_tsv(400000);
+  for(const size_t num_threads : {2, 3, 4, 7}) {
+    const auto bounds = snig::detail::split_tsv_chunks(tsv.data(), tsv.size(), num_threads);
+    CHECK(bounds.size() > 2);
+    CHECK(bounds.front() == 0);
+    CHECK(bounds.back() == tsv.size());
+    for(size_t c = 1; c + 1 < bounds.size(); ++c) {
+      CHECK(bounds[c - 1] <= bounds[c]);
+      //every chunk starts right after a newline
+      CHECK(tsv[bounds[c] - 1] == '\n');
+    }
+  }
+
+  //a line longer than a chunk spans several split points,
+  //those chunks end up empty instead of splitting the line
+  std::string wide = "3\t4\t0.5\n1\t2\t" + std::string(3 * snig::detail::MIN_TSV_CHUNK, ' ') + "-1.25\n";
+  wide += make_tsv(1000);
+  const auto bounds = snig::detail::split_tsv_chunks(wide.data(), wide.size(), 4);
+  for(size_t c = 1; c + 1 < bounds.size(); ++c) {
+    CHECK(bounds[c - 1] <= bounds[c]);
+    CHECK((bounds[c] == wide.size() || wide[bounds[c] - 1] == '\n'));
+  }
+  const Triplets parsed = parse(wide, 4);
+  check_equal(parsed, parse(wide, 1));
+  REQUIRE(parsed.rows.size() == 1002);
+  CHECK(parsed.rows[1] == 0);
+  CHECK(parsed.cols[1] == 1);
+  CHECK(parsed.values[1] == -1.25f);
+}
+
+TEST_CASE("tsv_missing_trailing_newline" * doctest::timeout(60)) {
+  const std::string small = "1\t2\t0.5\n3\t4\t-2";
+  const Triplets t = parse(small, 4);
+  REQUIRE(t.rows.size() == 2);
+  CHECK(t.rows[1] == 2);
+  CHECK(t.cols[1] == 3);
+  CHECK(t.values[1] == -2.0f);
+
+  //the last chunk of a large file ends without a newline,
+  //windows line endings and blank lines are skipped as well
+  std::string large = make_tsv(400000);
+  large.pop_back();
+  const Triplets serial = parse(large, 1);
+  CHECK(serial.rows.size() == 400000);
+  check_equal(parse(large, 4), serial);
+  check_equal(serial, parse_reference(large));
+
+  const std::string crlf = "1\t2\t0.5\r\n\n3\t4\t1\r\n\r\n5\t6\t7\r";
+  const Triplets parsed = parse(crlf, 1);
+  check_equal(parsed, parse_reference(crlf));
+  CHECK(parsed.rows.size() == 3);
+
+  Triplets empty = parse("", 4);
+  CHECK(empty.rows.empty());
+}
+
+TEST_CASE("tsv_malformed_numbers" * doctest::timeout(60)) {
+  for(const std::string line : {
+    "1\tx\t0.5", "a\t2\t0.5", "1\t2\t", "1\t2\t.", "1\t2\t-", "1\t2\tnan", "1\t2\t1e", "1"
+  }) {
+    CAPTURE(line);
+    CHECK_THROWS_AS(parse(line + "\n", 1), std::runtime_error);
+    //errors of other threads reach the caller too
+    CHECK_THROWS_AS(parse(make_tsv(400000) + line + "\n" + make_tsv(10), 4), std::runtime_error);
+  }
+
+  std::vector<int> values;
+  const std::string integers = "1\n2\nthree\n";
+  CHECK_THROWS_AS(
+    snig::parse_tsv_integers(integers.data(), integers.size(), values, 1),
+    std::runtime_error
+  );
+}